@@ -1,42 +1,79 @@
 #include <iostream>
-#include <chrono>
 #include <vector>
 #include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
-struct MarketData {
-    uint64_t timestamp;
-    double price;
-    uint32_t volume;
-};
-
-// Parsing function (works on raw bytes, no extra allocations)
-inline MarketData parse(const char* buffer) {
-    MarketData data;
-    std::memcpy(&data, buffer, sizeof(MarketData));
-    return data;
-}
+#include "../../feed/feed_reader.cpp"
+#include "../../feed/timestamps.cpp"
+#include "../../feed/wire_format.cpp"
+
+// MarketDataMessage (feed/wire_format.cpp) replaces the padded MarketData
+// struct: fields are packed little-endian at fixed offsets, so decoding is
+// a pointer cast into the receive buffer.
+//
+// Run against feed/market_data_server: it stamps timestamp_ns with
+// CLOCK_MONOTONIC at send time, so the report splits wire-to-decode
+// latency into sent -> rx (kernel receive timestamp) and rx -> decoded.
+// (dummy_market_server.py stamps wall-clock time, so its sent stage is
+// meaningless.) feed/pipeline_latency continues the breakdown through the
+// queue and the book.
 
 int main() {
-    char buffer[sizeof(MarketData)];
     int sock = socket(AF_INET, SOCK_STREAM, 0);
-    // Assume already connected...
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(5555);
+    inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&server), sizeof(server)) != 0) {
+        std::perror("connect");
+        return 1;
+    }
 
-    auto start = std::chrono::high_resolution_clock::now();
+    // One recv per chunk of kilobytes instead of one read() per message
+    FeedReader<WireFraming> reader(SocketTransport(sock), WireFraming{});
+    reader.transport().set_busy_poll(50);
+    reader.transport().enable_rx_timestamps();
 
-    for (int i = 0; i < 1000000; i++) {
-        read(sock, buffer, sizeof(buffer));
-        MarketData md = parse(buffer);
-        // Decision logic here (fast math, no heap allocation)
+    uint64_t start = TscClock::now();
+
+    int received = 0, rejected = 0;
+    StageLatencyReport report;
+    while (received < 1000000) {
+        std::span<const char> batch;
+        ReadStatus status = reader.poll(batch);
+        uint64_t rx = reader.transport().last_rx_ticks();
+        rx = rx ? rx : TscClock::now(); // No kernel timestamp: when recv returned
+        for (size_t offset = 0; offset < batch.size();) {
+            auto rest = batch.subspan(offset);
+            size_t length = WireFraming{}.frame(rest.data(), rest.size());
+            if (const auto* md = view_message<MarketDataMessage>(rest.first(length))) {
+                (void)md->price_value();
+                StageStamps stamps;
+                stamps.stamp(Stage::Sent, TscClock::from_monotonic_ns(md->timestamp_ns));
+                stamps.stamp(Stage::Rx, rx);
+                stamps.stamp(Stage::Decoded);
+                report.record(stamps);
+                ++received;
+                // Decision logic here (fast math, no heap allocation)
+            } else {
+                ++rejected;
+            }
+            offset += length;
+        }
+        if (status == ReadStatus::Closed || status == ReadStatus::Error) {
+            break;
+        }
     }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::cout << "Elapsed: "
-              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
-              << " us\n";
+    std::cout << "Elapsed: " << static_cast<uint64_t>(TscClock::to_ns(TscClock::now() - start) / 1000)
+              << " us for " << received << " messages (" << rejected << " rejected), "
+              << reader.stats().syscalls << " syscalls\n"
+              << "stage latency (ns):" << std::endl;
+    report.print();
 
     close(sock);
     return 0;
 }
-
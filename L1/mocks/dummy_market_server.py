@@ -1,4 +1,6 @@
 # market_data_server.py
+# Reference only: it tops out far below what the client needs testing at.
+# Load-test with feed/market_data_server.cpp, which speaks the same format.
 import socket
 import struct
 import time
@@ -6,12 +8,21 @@ import time
 HOST = 'localhost'
 PORT = 5555
 
-def generate_market_data():
+# Wire layout of MarketDataMessage in feed/wire_format.cpp, explicitly
+# little-endian and unpadded: header (length, type, version, sequence),
+# timestamp_ns, price in 1/10000 units, volume, instrument = 32 bytes
+MARKET_DATA = struct.Struct('<HBBIQqII')
+TRADE = 1
+WIRE_VERSION = 1
+PRICE_SCALE = 10000
+
+def generate_market_data(sequence):
     """Generates infinite market data packets"""
     timestamp = int(time.time() * 1e9)  # nanosecond precision
     price = 100.0 + (time.time() % 10)  # oscillating price
     volume = 100
-    return struct.pack('QdI', timestamp, price, volume)  # 8+8+4 = 20 bytes
+    return MARKET_DATA.pack(MARKET_DATA.size, TRADE, WIRE_VERSION, sequence & 0xFFFFFFFF,
+                            timestamp, round(price * PRICE_SCALE), volume, 0)
 
 def main():
     with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
@@ -23,9 +34,11 @@ def main():
         with conn:
             print(f"Connected by {addr}")
             try:
+                sequence = 1
                 while True:
-                    data = generate_market_data()
+                    data = generate_market_data(sequence)
                     conn.sendall(data)
+                    sequence += 1
             except (ConnectionResetError, BrokenPipeError):
                 print("Client disconnected")
 
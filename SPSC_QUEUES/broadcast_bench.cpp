@@ -0,0 +1,170 @@
+// Fan-out benchmark: one producer handing every message to N consumers.
+//
+// Compares N separate Fifo4 queues (one push per consumer per message)
+// with one BroadcastRing read by N gating readers, then repeats the ring
+// run with an extra lossy reader that dawdles, to show overrun detection.
+// Every consumer checks that it saw the sequence in order.
+//
+//   broadcast_bench [messages] [consumers] [capacity]
+//
+// Defaults: 5000000 messages, 3 consumers, capacity 4096
+
+#include "broadcast_q.cpp"
+#include "spsc_q4.cpp"
+#include "../orderbook/threading.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// A cache line of decoded market data
+struct Message {
+    std::uint64_t sequence;
+    std::uint64_t instrument;
+    std::int64_t price;
+    std::uint64_t quantity;
+    std::uint64_t padding[4];
+};
+
+// Spin on a failed poll, backing off to the scheduler now and then so an
+// oversubscribed machine still makes progress
+inline void backoff(unsigned& spins) {
+    if (++spins % 1024 == 0) {
+        std::this_thread::yield();
+    } else {
+        cpu_relax();
+    }
+}
+
+Message make(std::uint64_t sequence) { return {sequence, sequence % 100, 100, 1, {}}; }
+
+void report(char const* name, std::uint64_t messages, std::chrono::steady_clock::time_point start, bool ordered) {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-22s %12.0f msg/s  (%.3f s%s)\n", name, static_cast<double>(messages) / elapsed, elapsed,
+                ordered ? "" : ", OUT OF ORDER");
+}
+
+void run_queues(std::uint64_t messages, unsigned consumers, std::size_t capacity) {
+    std::vector<std::unique_ptr<Fifo4<Message>>> queues;
+    for (unsigned c = 0; c < consumers; ++c) {
+        queues.push_back(std::make_unique<Fifo4<Message>>(capacity));
+    }
+    std::atomic<bool> ordered{true};
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (auto& queue : queues) {
+        threads.emplace_back([&, q = queue.get()] {
+            unsigned spins = 0;
+            Message message;
+            for (std::uint64_t expected = 0; expected < messages; ++expected) {
+                while (not q->pop(message)) {
+                    backoff(spins);
+                }
+                if (message.sequence != expected) {
+                    ordered = false;
+                }
+            }
+        });
+    }
+    unsigned spins = 0;
+    for (std::uint64_t i = 0; i < messages; ++i) {
+        Message message = make(i);
+        for (auto& queue : queues) {
+            while (not queue->push(message)) {
+                backoff(spins);
+            }
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    report("Fifo4 per consumer", messages, start, ordered);
+}
+
+void run_broadcast(std::uint64_t messages, unsigned consumers, std::size_t capacity, bool with_lossy) {
+    BroadcastRing<Message> ring(capacity);
+    std::vector<BroadcastRing<Message>::Reader*> readers;
+    for (unsigned c = 0; c < consumers; ++c) {
+        readers.push_back(&ring.add_reader());
+    }
+    auto& lossy = ring.add_reader(true);
+    std::atomic<bool> ordered{true}, done{false};
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (auto* reader : readers) {
+        threads.emplace_back([&, reader] {
+            unsigned spins = 0;
+            Message message;
+            for (std::uint64_t expected = 0; expected < messages; ++expected) {
+                while (not reader->try_read(message)) {
+                    backoff(spins);
+                }
+                if (message.sequence != expected) {
+                    ordered = false;
+                }
+            }
+        });
+    }
+    std::uint64_t lossy_read = 0;
+    if (with_lossy) {
+        // Reads a message, then sleeps a little: sure to be overrun
+        threads.emplace_back([&] {
+            Message message;
+            std::uint64_t last = 0;
+            while (not done.load(std::memory_order_relaxed)) {
+                if (lossy.try_read(message)) {
+                    if (lossy_read++ && message.sequence <= last) {
+                        ordered = false;
+                    }
+                    last = message.sequence;
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            }
+        });
+    }
+
+    unsigned spins = 0;
+    for (std::uint64_t i = 0; i < messages; ++i) {
+        while (not ring.try_publish(make(i))) {
+            backoff(spins);
+        }
+    }
+    for (unsigned c = 0; c < consumers; ++c) {
+        threads[c].join();
+    }
+    done = true;
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    report(with_lossy ? "BroadcastRing + lossy" : "BroadcastRing", messages, start, ordered);
+    if (with_lossy) {
+        std::printf("%22s lossy reader read %lu, detected %lu lost\n", "", static_cast<unsigned long>(lossy_read),
+                    static_cast<unsigned long>(lossy.lost()));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::uint64_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    unsigned consumers = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 3;
+    std::size_t capacity = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 4096;
+
+    std::printf("%lu messages of %zu bytes to %u consumers, capacity %zu\n", static_cast<unsigned long>(messages),
+                sizeof(Message), consumers, capacity);
+    run_queues(messages, consumers, capacity);
+    run_broadcast(messages, consumers, capacity, false);
+    run_broadcast(messages, consumers, capacity, true);
+    return 0;
+}
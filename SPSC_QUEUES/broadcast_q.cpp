@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "spsc_q3.cpp"
+#include "../orderbook/seqlock.cpp"
+
+/// Single-producer ring that every reader sees in full (disruptor style)
+///
+/// The producer writes each message once into a Seqlock slot; each reader
+/// keeps its own cursor and copies messages out, so fanning out to N
+/// readers costs one write instead of N queue pushes. A slot's store count
+/// says which lap it holds, so a reader can tell "not yet written" from
+/// "already overwritten".
+///
+/// Gating readers hold the producer back: it never laps the slowest of
+/// them, so they see every message. Lossy readers (e.g. analytics) do not
+/// gate; if the producer laps one, its next read notices the overrun, skips
+/// to the oldest message still in the ring and adds the skipped count to
+/// lost(). Readers are added before publishing starts. The capacity is a
+/// power of two.
+template<typename T, typename Alloc = std::allocator<T>>
+class BroadcastRing : private std::allocator_traits<Alloc>::template rebind_alloc<Seqlock<T>>
+{
+    static_assert(std::is_trivially_copyable_v<T>, "broadcast messages are copied bytewise");
+
+public:
+    using value_type = T;
+    using slot_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<Seqlock<T>>;
+    using allocator_traits = std::allocator_traits<slot_allocator>;
+    using size_type = std::uint64_t;
+
+    /// One consumer's view of the ring; used only by that consumer's thread
+    class Reader
+    {
+    public:
+        /// Copy the next message out.
+        /// @return `true` if a message was read; `false` if none is ready.
+        bool try_read(T& value) {
+            while (true) {
+                auto cursor = cursor_.load(std::memory_order_relaxed);
+                std::uint64_t version;
+                if (not ring_.slot(cursor).try_load(value, version)) {
+                    // The producer is writing this slot right now
+                    return false;
+                }
+                auto lap = (cursor >> ring_.shift_) + 1;
+                if (version < lap) {
+                    return false;
+                }
+                if (version == lap) {
+                    // Release so the producer reuses the slot only after our copy
+                    cursor_.store(cursor + 1, std::memory_order_release);
+                    return true;
+                }
+
+                // Lapped: only possible for a lossy reader
+                auto head = ring_.head_.load(std::memory_order_acquire);
+                auto oldest = head > ring_.capacity() ? head - ring_.capacity() + 1 : 0;
+                oldest = oldest > cursor ? oldest : cursor + 1;
+                lost_ += oldest - cursor;
+                cursor_.store(oldest, std::memory_order_relaxed);
+            }
+        }
+
+        /// Messages skipped because the producer overran this reader
+        std::uint64_t lost() const noexcept { return lost_; }
+
+        /// Sequence number of the next message to read
+        std::uint64_t position() const noexcept { return cursor_.load(std::memory_order_relaxed); }
+
+        bool lossy() const noexcept { return lossy_; }
+
+    private:
+        friend class BroadcastRing;
+
+        Reader(BroadcastRing& ring, bool lossy, std::uint64_t start)
+            : ring_{ring}, lossy_{lossy}, cursor_{start} {}
+
+        BroadcastRing& ring_;
+        bool lossy_;
+        std::uint64_t lost_ = 0;
+
+        /// Advanced by this reader; loaded by the producer if gating
+        alignas(cache_line_size) std::atomic<std::uint64_t> cursor_;
+
+        // Padding to avoid false sharing with adjacent objects
+        char padding_[cache_line_size - sizeof(std::uint64_t)];
+    };
+
+    /// capacity is rounded up to the next power of two
+    explicit BroadcastRing(size_type capacity, Alloc const& alloc = Alloc{})
+        : slot_allocator{alloc}
+        , mask_{std::bit_ceil(capacity) - 1}
+        , shift_{static_cast<unsigned>(std::countr_zero(mask_ + 1))}
+        , ring_{allocator_traits::allocate(*this, mask_ + 1)}
+    {
+        for (size_type i = 0; i <= mask_; ++i) {
+            new (&ring_[i]) Seqlock<T>;
+        }
+    }
+
+    ~BroadcastRing() { allocator_traits::deallocate(*this, ring_, capacity()); }
+
+    BroadcastRing(BroadcastRing const&) = delete;
+    BroadcastRing& operator=(BroadcastRing const&) = delete;
+
+    /// Returns the number of messages a gating reader may fall behind by
+    auto capacity() const noexcept { return mask_ + 1; }
+
+    /// Register a reader starting at the next message; not thread safe, so
+    /// add every reader before the producer starts
+    Reader& add_reader(bool lossy = false) {
+        readers_.push_back(std::unique_ptr<Reader>(new Reader(*this, lossy, next_)));
+        if (not lossy) {
+            gating_.push_back(readers_.back().get());
+        }
+        gateCached_ = next_;
+        return *readers_.back();
+    }
+
+    /// Publish one message to every reader; the producer thread only.
+    /// @return `true` if published; `false` if a gating reader is a full ring behind.
+    bool try_publish(T const& value) {
+        if (next_ - gateCached_ >= capacity()) {
+            gateCached_ = slowest_gate();
+            if (next_ - gateCached_ >= capacity()) {
+                return false;
+            }
+        }
+        slot(next_).store(value);
+        head_.store(++next_, std::memory_order_release);
+        return true;
+    }
+
+    /// Messages published so far
+    std::uint64_t published() const noexcept { return head_.load(std::memory_order_relaxed); }
+
+private:
+    Seqlock<T>& slot(std::uint64_t sequence) noexcept { return ring_[sequence & mask_]; }
+
+    std::uint64_t slowest_gate() const noexcept {
+        auto slowest = next_;
+        for (Reader* reader : gating_) {
+            auto cursor = reader->cursor_.load(std::memory_order_acquire);
+            slowest = cursor < slowest ? cursor : slowest;
+        }
+        return slowest;
+    }
+
+    size_type mask_;
+    unsigned shift_;
+    Seqlock<T>* ring_;
+    std::vector<std::unique_ptr<Reader>> readers_;
+    std::vector<Reader*> gating_;
+
+    /// Exclusive to the producer
+    std::uint64_t next_ = 0;
+    std::uint64_t gateCached_ = 0; // Slowest gating cursor when last checked
+
+    /// Stored by the producer; loaded by lossy readers that were lapped
+    alignas(cache_line_size) std::atomic<std::uint64_t> head_{0};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[cache_line_size - sizeof(std::uint64_t)];
+};
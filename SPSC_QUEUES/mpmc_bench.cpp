@@ -0,0 +1,128 @@
+// Contention benchmark for the multi-producer fifos.
+//
+// For 1 to N producer threads, each producer pushes its share of the
+// messages into one queue while consumers pop them and sum the payloads:
+// MpscFifo with one consumer, MpmcFifo with as many consumers as producers,
+// and a mutex-guarded std::deque as the baseline for both shapes. Threads
+// are left unpinned; the sums check that nothing was lost or duplicated.
+//
+//   mpmc_bench [messages] [max producers] [capacity]
+//
+// Defaults: 10000000 messages, 4 producers, capacity 65536
+
+#include "mpmc_q.cpp"
+#include "../orderbook/threading.cpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// Bounded queue behind one lock, for comparison
+template<typename T>
+class MutexFifo {
+public:
+    explicit MutexFifo(std::size_t capacity) : capacity_{capacity} {}
+
+    bool push(T const& value) {
+        std::lock_guard lock{mutex_};
+        if (items_.size() == capacity_) {
+            return false;
+        }
+        items_.push_back(value);
+        return true;
+    }
+
+    bool pop(T& value) {
+        std::lock_guard lock{mutex_};
+        if (items_.empty()) {
+            return false;
+        }
+        value = items_.front();
+        items_.pop_front();
+        return true;
+    }
+
+private:
+    std::size_t capacity_;
+    std::mutex mutex_;
+    std::deque<T> items_;
+};
+
+// Spin on a failed poll, backing off to the scheduler now and then so an
+// oversubscribed machine still makes progress
+inline void backoff(unsigned& spins) {
+    if (++spins % 1024 == 0) {
+        std::this_thread::yield();
+    } else {
+        cpu_relax();
+    }
+}
+
+template<typename Queue>
+void run(char const* name, std::uint64_t messages, unsigned producers, unsigned consumers, std::size_t capacity) {
+    Queue queue(capacity);
+    std::uint64_t per_producer = messages / producers;
+    std::uint64_t total = per_producer * producers;
+    std::atomic<std::uint64_t> popped{0}, sum{0};
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            unsigned spins = 0;
+            std::uint64_t value, local = 0;
+            while (popped.load(std::memory_order_relaxed) < total) {
+                if (not queue.pop(value)) {
+                    backoff(spins);
+                    continue;
+                }
+                local += value;
+                popped.fetch_add(1, std::memory_order_relaxed);
+            }
+            sum.fetch_add(local);
+        });
+    }
+    for (unsigned p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            unsigned spins = 0;
+            for (std::uint64_t i = 1; i <= per_producer; ++i) {
+                while (not queue.push(i)) {
+                    backoff(spins);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool intact = sum.load() == producers * (per_producer * (per_producer + 1) / 2);
+    std::printf("  %-12s %up/%uc %12.0f msg/s%s\n", name, producers, consumers, static_cast<double>(total) / elapsed,
+                intact ? "" : "  LOST OR DUPLICATED");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::uint64_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    unsigned max_producers = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 4;
+    std::size_t capacity = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 65536;
+
+    std::printf("%lu messages, capacity %zu\n", static_cast<unsigned long>(messages), capacity);
+    for (unsigned producers = 1; producers <= max_producers; ++producers) {
+        std::printf("%u producer%s\n", producers, producers == 1 ? "" : "s");
+        run<MpscFifo<std::uint64_t>>("MpscFifo", messages, producers, 1, capacity);
+        run<MutexFifo<std::uint64_t>>("mutex", messages, producers, 1, capacity);
+        run<MpmcFifo<std::uint64_t>>("MpmcFifo", messages, producers, producers, capacity);
+        run<MutexFifo<std::uint64_t>>("mutex", messages, producers, producers, capacity);
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "spsc_q3.cpp"
+
+/// One ring slot: a turn counter and room for a T, padded to whole cache
+/// lines so threads working on neighbouring slots do not false-share
+template<typename T>
+struct alignas(cache_line_size) FifoSlot
+{
+    std::atomic<std::size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+};
+
+/// Threadsafe bounded circular FIFO for any number of producers and consumers
+///
+/// Vyukov's design: every slot carries a sequence number saying whose turn
+/// it is. A producer may fill the slot under the push cursor once its
+/// sequence equals the cursor; it claims it by advancing the cursor with a
+/// CAS and hands it to consumers by storing cursor + 1. A consumer claims it
+/// at cursor + 1 the same way and hands it back to producers for the next
+/// lap. Threads only contend on their own side's cursor, and each slot is
+/// owned by one thread at a time. The capacity is a power of two, at least 2.
+template<typename T, typename Alloc = std::allocator<T>>
+class MpmcFifo : private std::allocator_traits<Alloc>::template rebind_alloc<FifoSlot<T>>
+{
+public:
+    using value_type = T;
+    using slot_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<FifoSlot<T>>;
+    using allocator_traits = std::allocator_traits<slot_allocator>;
+    using size_type = typename allocator_traits::size_type;
+
+    /// capacity is rounded up to the next power of two
+    explicit MpmcFifo(size_type capacity, Alloc const& alloc = Alloc{})
+        : slot_allocator{alloc}
+        , mask_{std::bit_ceil(capacity < 2 ? size_type{2} : capacity) - 1}
+        , ring_{allocator_traits::allocate(*this, mask_ + 1)}
+    {
+        for (size_type i = 0; i <= mask_; ++i) {
+            new (&ring_[i]) FifoSlot<T>;
+            ring_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpmcFifo() {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        for (auto cursor = popCursor_.load(std::memory_order_relaxed); cursor != pushCursor; ++cursor) {
+            element(cursor).value()->~T();
+        }
+        allocator_traits::deallocate(*this, ring_, capacity());
+    }
+
+    MpmcFifo(MpmcFifo const&) = delete;
+    MpmcFifo& operator=(MpmcFifo const&) = delete;
+
+
+    /// Returns the number of elements in the fifo; only a snapshot while
+    /// other threads are pushing or popping
+    auto size() const noexcept {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        return pushCursor > popCursor ? pushCursor - popCursor : size_type{0};
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return mask_ + 1; }
+
+
+    /// Push one object onto the fifo; any thread.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) { return emplace(value); }
+
+    /// Move one object onto the fifo; any thread.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T&& value) { return emplace(std::move(value)); }
+
+    /// Construct one object in place at the back of the fifo; any thread.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    template<typename... Args>
+    auto emplace(Args&&... args) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        FifoSlot<T>* slot;
+        while (true) {
+            slot = &element(pushCursor);
+            auto sequence = slot->sequence.load(std::memory_order_acquire);
+            auto lag = static_cast<std::make_signed_t<size_type>>(sequence - pushCursor);
+            if (lag == 0) {
+                if (pushCursor_.compare_exchange_weak(pushCursor, pushCursor + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                // The slot still holds last lap's element
+                return false;
+            } else {
+                pushCursor = pushCursor_.load(std::memory_order_relaxed);
+            }
+        }
+        new (slot->storage) T(std::forward<Args>(args)...);
+        slot->sequence.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop one object from the fifo; any thread.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        FifoSlot<T>* slot;
+        while (true) {
+            slot = &element(popCursor);
+            auto sequence = slot->sequence.load(std::memory_order_acquire);
+            auto lag = static_cast<std::make_signed_t<size_type>>(sequence - (popCursor + 1));
+            if (lag == 0) {
+                if (popCursor_.compare_exchange_weak(popCursor, popCursor + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                // Not yet published for this lap
+                return false;
+            } else {
+                popCursor = popCursor_.load(std::memory_order_relaxed);
+            }
+        }
+        release(*slot, popCursor, value);
+        return true;
+    }
+
+protected:
+    FifoSlot<T>& element(size_type cursor) noexcept { return ring_[cursor & mask_]; }
+
+    // Move the value out of a claimed slot and hand it to the next lap's producer
+    void release(FifoSlot<T>& slot, size_type popCursor, T& value) {
+        value = std::move(*slot.value());
+        slot.value()->~T();
+        slot.sequence.store(popCursor + capacity(), std::memory_order_release);
+    }
+
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free);
+
+    size_type mask_;
+    FifoSlot<T>* ring_;
+
+    /// Advanced by every push thread
+    alignas(cache_line_size) CursorType pushCursor_{0};
+
+    /// Advanced by every pop thread
+    alignas(cache_line_size) CursorType popCursor_{0};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[cache_line_size - sizeof(size_type)];
+};
+
+/// Threadsafe bounded circular FIFO for many producers and one consumer
+///
+/// MpmcFifo's push side unchanged. The consumer owns the pop cursor, so pop
+/// just checks the head slot's sequence and needs no CAS.
+template<typename T, typename Alloc = std::allocator<T>>
+class MpscFifo : public MpmcFifo<T, Alloc>
+{
+    using Base = MpmcFifo<T, Alloc>;
+
+public:
+    using typename Base::size_type;
+    using Base::Base;
+
+    /// Pop one object from the fifo; the consumer thread only.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = this->popCursor_.load(std::memory_order_relaxed);
+        auto& slot = this->element(popCursor);
+        if (slot.sequence.load(std::memory_order_acquire) != popCursor + 1) {
+            return false;
+        }
+        this->popCursor_.store(popCursor + 1, std::memory_order_relaxed);
+        this->release(slot, popCursor, value);
+        return true;
+    }
+};
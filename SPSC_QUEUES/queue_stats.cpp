@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+
+#include "spsc_q3.cpp"
+#include "../orderbook/tsc_clock.cpp"
+
+/// Telemetry policies for Fifo4's Stats parameter. The queue calls the
+/// hooks below from the thread that owns each side; NoQueueStats leaves
+/// them empty so they compile away.
+///
+///   on_push_refresh / on_pop_refresh(occupancy)  after reloading the other
+///           side's cursor, when occupancy is exact
+///   on_full / on_empty()                         a push or pop failed
+///   stamp / sample(cursor)                       element cursor was
+///           published / is being consumed
+struct NoQueueStats
+{
+    explicit NoQueueStats(std::size_t) noexcept {}
+
+    void on_push_refresh(std::size_t) noexcept {}
+    void on_full() noexcept {}
+    void stamp(std::size_t) noexcept {}
+
+    void on_pop_refresh(std::size_t) noexcept {}
+    void on_empty() noexcept {}
+    void sample(std::size_t) noexcept {}
+};
+
+/// Counters as seen at one moment by a monitoring thread
+struct QueueStatsSnapshot
+{
+    std::uint64_t high_water;      // Most elements seen queued at once
+    std::uint64_t full_pushes;     // Pushes refused because the queue was full
+    std::uint64_t empty_polls;     // Pops that found the queue empty
+    std::uint64_t latency_samples; // Elements timed from push to pop
+    double mean_latency_ns;
+    double max_latency_ns;
+};
+
+/// Occupancy and failure counters, plus push-to-pop latency of every
+/// SampleEvery-th element, stamped with the TSC into a side table indexed
+/// like the ring. Each counter has a single writer and is published with a
+/// relaxed store, so the hooks cost no read-modify-write, and producer and
+/// consumer counters sit on separate cache lines. Any thread may read().
+///
+/// The high-water mark is updated only when a side reloads the other's
+/// cursor, which is when Fifo4 knows occupancy exactly: a consumer that
+/// catches up sees the backlog built while it was busy, and a producer
+/// that finds the queue full sees the full depth.
+template<std::size_t SampleEvery = 64>
+class SampledQueueStats
+{
+    static_assert(std::has_single_bit(SampleEvery), "sample interval must be a power of two");
+
+public:
+    explicit SampledQueueStats(std::size_t capacity)
+        : stampMask_{(capacity / SampleEvery ? capacity / SampleEvery : 1) - 1}
+        , stamps_{std::make_unique<std::uint64_t[]>(stampMask_ + 1)}
+    {}
+
+    void on_push_refresh(std::size_t occupancy) noexcept { raise(producer_.highWater, occupancy); }
+    void on_full() noexcept { bump(producer_.fullPushes); }
+    void stamp(std::size_t cursor) noexcept {
+        if ((cursor & (SampleEvery - 1)) == 0) {
+            stamps_[(cursor / SampleEvery) & stampMask_] = TscClock::now();
+        }
+    }
+
+    void on_pop_refresh(std::size_t occupancy) noexcept { raise(consumer_.highWater, occupancy); }
+    void on_empty() noexcept { bump(consumer_.emptyPolls); }
+    void sample(std::size_t cursor) noexcept {
+        if ((cursor & (SampleEvery - 1)) == 0) {
+            // Ordered after the stamp by the push cursor's release/acquire
+            auto ticks = TscClock::now() - stamps_[(cursor / SampleEvery) & stampMask_];
+            bump(consumer_.samples);
+            consumer_.ticksTotal.store(consumer_.ticksTotal.load(std::memory_order_relaxed) + ticks,
+                                       std::memory_order_relaxed);
+            raise(consumer_.ticksMax, ticks);
+        }
+    }
+
+    /// Any thread; the fields are read individually, so they may be from
+    /// slightly different moments
+    QueueStatsSnapshot read() const noexcept {
+        auto load = [](Counter const& counter) { return counter.load(std::memory_order_relaxed); };
+        auto samples = load(consumer_.samples);
+        auto highWater = load(producer_.highWater) > load(consumer_.highWater) ? load(producer_.highWater)
+                                                                              : load(consumer_.highWater);
+        return {highWater,
+                load(producer_.fullPushes),
+                load(consumer_.emptyPolls),
+                samples,
+                samples ? TscClock::to_ns(load(consumer_.ticksTotal)) / static_cast<double>(samples) : 0.0,
+                TscClock::to_ns(load(consumer_.ticksMax))};
+    }
+
+private:
+    using Counter = std::atomic<std::uint64_t>;
+
+    static void bump(Counter& counter) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    static void raise(Counter& counter, std::uint64_t value) noexcept {
+        if (value > counter.load(std::memory_order_relaxed)) {
+            counter.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t stampMask_;
+    std::unique_ptr<std::uint64_t[]> stamps_;
+
+    /// Written by the push thread
+    struct alignas(cache_line_size) {
+        Counter highWater{0};
+        Counter fullPushes{0};
+    } producer_;
+
+    /// Written by the pop thread
+    struct alignas(cache_line_size) {
+        Counter highWater{0};
+        Counter emptyPolls{0};
+        Counter samples{0};
+        Counter ticksTotal{0};
+        Counter ticksMax{0};
+    } consumer_;
+};
@@ -0,0 +1,121 @@
+// Process-to-process latency benchmark for ShmFifo.
+//
+// The parent creates a ping and a pong fifo and forks; the child attaches
+// to both by name and echoes every message back. The parent times each
+// round trip and reports half of it as the one-way latency. Pin the two
+// processes to different cores for meaningful numbers; a core that does
+// not exist leaves that process unpinned.
+//
+//   shm_bench [round trips] [parent core] [child core]
+//
+// Defaults: 1000000 round trips, cores 1 and 2
+
+#include "shm_q.cpp"
+#include "../orderbook/threading.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+
+namespace {
+
+struct Ping {
+    std::uint64_t sequence;
+    std::int64_t sent_ns;
+};
+
+// Spin on a failed poll, backing off to the scheduler now and then so an
+// oversubscribed machine still makes progress
+inline void backoff(unsigned& spins) {
+    if (++spins % 1024 == 0) {
+        std::this_thread::yield();
+    } else {
+        cpu_relax();
+    }
+}
+
+std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+char const ping_name[] = "/shm_bench.ping";
+char const pong_name[] = "/shm_bench.pong";
+
+// Child: echo round_trips messages, then leave without running the
+// parent's destructors, which would unlink the names
+[[noreturn]] void echo(std::uint64_t round_trips, int core) {
+    pin_current_thread(core);
+    ShmFifo<Ping> ping, pong;
+    if (not ping.attach(ping_name) || not pong.attach(pong_name)) {
+        std::_Exit(1);
+    }
+    unsigned spins = 0;
+    Ping message;
+    for (std::uint64_t i = 0; i < round_trips; ++i) {
+        while (not ping.pop(message)) {
+            backoff(spins);
+        }
+        while (not pong.push(message)) {
+            backoff(spins);
+        }
+    }
+    std::_Exit(0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::uint64_t round_trips = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int parent_core = argc > 2 ? std::atoi(argv[2]) : 1;
+    int child_core = argc > 3 ? std::atoi(argv[3]) : 2;
+
+    ShmFifo<Ping> ping, pong;
+    if (not ping.create(ping_name, 1024) || not pong.create(pong_name, 1024)) {
+        return 1;
+    }
+
+    pid_t child = fork();
+    if (child < 0) {
+        std::perror("fork");
+        return 1;
+    }
+    if (child == 0) {
+        echo(round_trips, child_core);
+    }
+
+    pin_current_thread(parent_core);
+    std::vector<std::int64_t> one_way;
+    one_way.reserve(round_trips);
+    unsigned spins = 0;
+    Ping message;
+    for (std::uint64_t i = 0; i < round_trips; ++i) {
+        while (not ping.push({i, now_ns()})) {
+            backoff(spins);
+        }
+        while (not pong.pop(message)) {
+            backoff(spins);
+        }
+        one_way.push_back((now_ns() - message.sent_ns) / 2);
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (not WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "echo process failed\n");
+        return 1;
+    }
+
+    std::sort(one_way.begin(), one_way.end());
+    auto at = [&](double q) { return one_way[static_cast<std::size_t>(q * static_cast<double>(one_way.size() - 1))]; };
+    std::printf("%lu round trips, one-way latency ns: p50 %ld  p99 %ld  p99.9 %ld  max %ld\n",
+                static_cast<unsigned long>(round_trips), static_cast<long>(at(0.5)), static_cast<long>(at(0.99)),
+                static_cast<long>(at(0.999)), static_cast<long>(one_way.back()));
+    return 0;
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "spsc_q3.cpp"
+
+/// Layout header at the start of a shared fifo segment. Everything is
+/// addressed by offset from the segment base, since each process maps it
+/// at its own address.
+struct ShmFifoHeader
+{
+    static constexpr char magic_value[8] = "SHMFIFO";
+    static constexpr std::uint32_t current_version = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t value_size;  // sizeof(T) of the creator
+    std::uint32_t value_align; // alignof(T) of the creator
+    std::uint32_t reserved;
+    std::uint64_t capacity;    // Slots, a power of two
+    std::uint64_t ring_offset; // Bytes from the segment base to slot 0
+    std::uint64_t segment_size;
+    std::atomic<std::uint32_t> ready; // Set last by the creator
+};
+
+/// Threadsafe circular FIFO between two processes over named shared memory
+///
+/// The creator lays out the header, both cursors and the ring in a POSIX
+/// shared-memory segment; the other process attaches by name and checks
+/// the header against its own idea of T before using it. Pushes and pops
+/// follow Fifo4: acquire/release on the shared cursors, with each side's
+/// cached copy of the other cursor kept in its own process. T must be
+/// trivially copyable because it crosses address spaces bytewise.
+///
+/// Errors print the reason and return false, as the book snapshot helpers
+/// do. Either process may close; the creator also unlinks the name.
+template<typename T>
+class ShmFifo
+{
+    static_assert(std::is_trivially_copyable_v<T>, "shared fifo elements are copied bytewise");
+
+public:
+    using value_type = T;
+    using size_type = std::uint64_t;
+
+    ShmFifo() = default;
+    ShmFifo(ShmFifo const&) = delete;
+    ShmFifo& operator=(ShmFifo const&) = delete;
+
+    ~ShmFifo() { close(); }
+
+    /// Create (replacing any stale segment) the fifo called name, e.g.
+    /// "/feed.book", with capacity rounded up to a power of two. huge_pages
+    /// rounds the segment to 2 MiB and asks for transparent huge pages,
+    /// which shmem honours when enabled.
+    bool create(char const* name, size_type capacity, bool huge_pages = false) {
+        close();
+        capacity = std::bit_ceil(capacity);
+        std::uint64_t ring_offset = (sizeof(Control) + alignof(T) - 1) / alignof(T) * alignof(T);
+        std::uint64_t granule = huge_pages ? std::uint64_t{2} << 20 : std::uint64_t{4096};
+        std::uint64_t size = (ring_offset + capacity * sizeof(T) + granule - 1) / granule * granule;
+
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) {
+            std::perror(name);
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            std::perror("ftruncate");
+            ::close(fd);
+            shm_unlink(name);
+            return false;
+        }
+        if (not map(fd, size)) {
+            shm_unlink(name);
+            return false;
+        }
+        if (huge_pages) {
+            madvise(base_, size, MADV_HUGEPAGE);
+        }
+
+        auto* control = new (base_) Control{};
+        ShmFifoHeader& header = control->header;
+        std::memcpy(header.magic, ShmFifoHeader::magic_value, sizeof(header.magic));
+        header.version = ShmFifoHeader::current_version;
+        header.value_size = sizeof(T);
+        header.value_align = alignof(T);
+        header.capacity = capacity;
+        header.ring_offset = ring_offset;
+        header.segment_size = size;
+        header.ready.store(1, std::memory_order_release);
+
+        std::snprintf(name_, sizeof(name_), "%s", name);
+        bind(control);
+        return true;
+    }
+
+    /// Attach to a fifo another process created
+    bool attach(char const* name) {
+        close();
+        int fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0) {
+            std::perror(name);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<std::uint64_t>(st.st_size) < sizeof(Control)) {
+            std::fprintf(stderr, "%s: not a shared fifo\n", name);
+            ::close(fd);
+            return false;
+        }
+        if (not map(fd, static_cast<std::uint64_t>(st.st_size))) {
+            return false;
+        }
+
+        auto* control = static_cast<Control*>(base_);
+        ShmFifoHeader const& header = control->header;
+        bool valid = header.ready.load(std::memory_order_acquire) == 1 &&
+                     std::memcmp(header.magic, ShmFifoHeader::magic_value, sizeof(header.magic)) == 0 &&
+                     header.version == ShmFifoHeader::current_version;
+        if (not valid) {
+            std::fprintf(stderr, "%s: not a shared fifo or not yet initialised\n", name);
+            close();
+            return false;
+        }
+        bool layout = header.value_size == sizeof(T) && header.value_align == alignof(T) &&
+                      std::has_single_bit(header.capacity) && header.ring_offset >= sizeof(Control) &&
+                      header.ring_offset % alignof(T) == 0 && header.segment_size == size_ &&
+                      header.ring_offset + header.capacity * sizeof(T) <= size_;
+        if (not layout) {
+            std::fprintf(stderr, "%s: shared fifo layout does not match this element type\n", name);
+            close();
+            return false;
+        }
+        bind(control);
+        return true;
+    }
+
+    /// Unmap; the creator also removes the name
+    void close() {
+        if (base_) {
+            munmap(base_, size_);
+            base_ = nullptr;
+        }
+        if (name_[0]) {
+            shm_unlink(name_);
+            name_[0] = '\0';
+        }
+        control_ = nullptr;
+        ring_ = nullptr;
+    }
+
+    bool is_open() const noexcept { return control_ != nullptr; }
+
+
+    /// Returns the number of elements in the fifo
+    auto size() const noexcept {
+        auto pushCursor = control_->pushCursor.load(std::memory_order_relaxed);
+        auto popCursor = control_->popCursor.load(std::memory_order_relaxed);
+        return pushCursor - popCursor;
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return mask_ + 1; }
+
+
+    /// Push one object onto the fifo; the producing process only.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        auto pushCursor = control_->pushCursor.load(std::memory_order_relaxed);
+        if (pushCursor - popCursorCached_ == capacity()) {
+            popCursorCached_ = control_->popCursor.load(std::memory_order_acquire);
+            if (pushCursor - popCursorCached_ == capacity()) {
+                return false;
+            }
+        }
+        std::memcpy(&ring_[pushCursor & mask_], &value, sizeof(T));
+        control_->pushCursor.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop one object from the fifo; the consuming process only.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = control_->popCursor.load(std::memory_order_relaxed);
+        if (pushCursorCached_ == popCursor) {
+            pushCursorCached_ = control_->pushCursor.load(std::memory_order_acquire);
+            if (pushCursorCached_ == popCursor) {
+                return false;
+            }
+        }
+        std::memcpy(&value, &ring_[popCursor & mask_], sizeof(T));
+        control_->popCursor.store(popCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free, "cursors must be address-free to share across processes");
+
+    /// Start of the segment; the ring follows at header.ring_offset
+    struct Control
+    {
+        ShmFifoHeader header;
+
+        /// Stored by the producer; loaded by the consumer
+        alignas(cache_line_size) CursorType pushCursor{0};
+
+        /// Stored by the consumer; loaded by the producer
+        alignas(cache_line_size) CursorType popCursor{0};
+    };
+
+    bool map(int fd, std::uint64_t size) {
+        void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            std::perror("mmap");
+            return false;
+        }
+        base_ = base;
+        size_ = size;
+        return true;
+    }
+
+    void bind(Control* control) {
+        control_ = control;
+        mask_ = control->header.capacity - 1;
+        ring_ = reinterpret_cast<T*>(static_cast<char*>(base_) + control->header.ring_offset);
+        popCursorCached_ = control->popCursor.load(std::memory_order_relaxed);
+        pushCursorCached_ = control->pushCursor.load(std::memory_order_relaxed);
+    }
+
+    void* base_ = nullptr;
+    std::uint64_t size_ = 0;
+    Control* control_ = nullptr;
+    T* ring_ = nullptr;
+    size_type mask_ = 0;
+    char name_[256] = {}; // Set only in the creating process
+
+    /// This process's copies of the other side's cursor
+    size_type popCursorCached_ = 0;
+    size_type pushCursorCached_ = 0;
+};
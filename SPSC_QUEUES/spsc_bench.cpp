@@ -0,0 +1,144 @@
+// Core-to-core throughput benchmark for the SPSC fifos.
+//
+// One producer thread pushes a sequence of integers and one consumer pops
+// and checks them; each queue is timed over the same count and reported in
+// messages per second. Pin the two threads to cores on different physical
+// cores (or the same core's hyperthreads) to see the cache-line traffic the
+// queues differ in. A core that does not exist leaves that thread unpinned.
+// Fifo4 is also run reading in place with front/pop_front, and moving
+// batches with push_batch/pop_batch, and with its consumer blocking in
+// WaitingFifo::pop_wait under each wait strategy, and with telemetry on.
+//
+//   spsc_bench [messages] [producer core] [consumer core] [capacity] [batch]
+//
+// Defaults: 100000000 messages, cores 1 and 2, capacity 65536, batch 64
+
+#include "spsc_q3.cpp"
+#include "spsc_q4.cpp"
+#include "wait_strategy.cpp"
+#include "../orderbook/threading.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+struct BenchConfig {
+    std::uint64_t messages = 100000000;
+    int producer_core = 1;
+    int consumer_core = 2;
+    std::size_t capacity = 65536;
+    std::size_t batch = 64;
+};
+
+// How the two threads move messages through the queue
+enum class Mode { Copy, InPlace, Batch, Wait };
+
+// Spin on a failed poll, backing off to the scheduler now and then so an
+// oversubscribed machine still makes progress
+inline void backoff(unsigned& spins) {
+    if (++spins % 1024 == 0) {
+        std::this_thread::yield();
+    } else {
+        cpu_relax();
+    }
+}
+
+template<typename Queue, Mode mode = Mode::Copy>
+void run(char const* name, BenchConfig const& config) {
+    Queue queue(config.capacity);
+    bool ordered = true;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        pin_current_thread(config.consumer_core);
+        unsigned spins = 0;
+        std::uint64_t value;
+        for (std::uint64_t expected = 0; expected < config.messages;) {
+            if constexpr (mode == Mode::Copy) {
+                while (not queue.pop(value)) {
+                    backoff(spins);
+                }
+                ordered = ordered && value == expected++;
+            } else if constexpr (mode == Mode::InPlace) {
+                std::uint64_t* head;
+                while (not (head = queue.front())) {
+                    backoff(spins);
+                }
+                ordered = ordered && *head == expected++;
+                queue.pop_front();
+            } else if constexpr (mode == Mode::Wait) {
+                queue.pop_wait(value);
+                ordered = ordered && value == expected++;
+            } else {
+                auto check = [&](std::uint64_t& v) { ordered = ordered && v == expected++; };
+                while (not queue.pop_batch(config.batch, check)) {
+                    backoff(spins);
+                }
+            }
+        }
+    });
+
+    pin_current_thread(config.producer_core);
+    unsigned spins = 0;
+    for (std::uint64_t i = 0; i < config.messages;) {
+        if constexpr (mode == Mode::Batch) {
+            auto n = std::min<std::uint64_t>(config.batch, config.messages - i);
+            auto pushed = queue.push_batch(n, [i](std::size_t k) { return i + k; });
+            if (pushed == 0) {
+                backoff(spins);
+            }
+            i += pushed;
+        } else if constexpr (mode == Mode::InPlace) {
+            while (not queue.emplace(i)) {
+                backoff(spins);
+            }
+            ++i;
+        } else {
+            while (not queue.push(i)) {
+                backoff(spins);
+            }
+            ++i;
+        }
+    }
+    consumer.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-14s %12.0f msg/s  (%.3f s%s)\n", name, static_cast<double>(config.messages) / elapsed, elapsed,
+                ordered ? "" : ", OUT OF ORDER");
+    if constexpr (requires { queue.stats().read(); }) {
+        auto stats = queue.stats().read();
+        std::printf("%14s high water %lu, %lu full pushes, %lu empty polls, latency mean %.0f ns max %.0f ns (%lu samples)\n",
+                    "", static_cast<unsigned long>(stats.high_water), static_cast<unsigned long>(stats.full_pushes),
+                    static_cast<unsigned long>(stats.empty_polls), stats.mean_latency_ns, stats.max_latency_ns,
+                    static_cast<unsigned long>(stats.latency_samples));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (argc > 1) config.messages = std::strtoull(argv[1], nullptr, 10);
+    if (argc > 2) config.producer_core = std::atoi(argv[2]);
+    if (argc > 3) config.consumer_core = std::atoi(argv[3]);
+    if (argc > 4) config.capacity = std::strtoul(argv[4], nullptr, 10);
+    if (argc > 5) config.batch = std::strtoul(argv[5], nullptr, 10);
+
+    std::printf("%lu messages, capacity %zu, cores %d -> %d\n", static_cast<unsigned long>(config.messages),
+                config.capacity, config.producer_core, config.consumer_core);
+    run<Fifo3<std::uint64_t>>("Fifo3", config);
+    run<Fifo4<std::uint64_t>>("Fifo4", config);
+    run<Fifo4<std::uint64_t>, Mode::InPlace>("Fifo4 in place", config);
+    run<Fifo4<std::uint64_t>, Mode::Batch>("Fifo4 batch", config);
+    run<Fifo4<std::uint64_t, std::allocator<std::uint64_t>, SampledQueueStats<>>>("Fifo4 stats", config);
+    run<WaitingFifo<Fifo4<std::uint64_t>, BusySpinWait>, Mode::Wait>("busy spin", config);
+    run<WaitingFifo<Fifo4<std::uint64_t>, PauseBackoffWait>, Mode::Wait>("pause backoff", config);
+    run<WaitingFifo<Fifo4<std::uint64_t>, SpinYieldWait>, Mode::Wait>("spin yield", config);
+    run<WaitingFifo<Fifo4<std::uint64_t>, ParkingWait>, Mode::Wait>("parking", config);
+    return 0;
+}
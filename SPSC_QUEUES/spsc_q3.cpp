@@ -5,6 +5,11 @@
 #include <memory>
 #include <new>
 
+#include "../orderbook/branch_hints.cpp"
+
+/// Destructive interference size used for padding here and by other
+/// shared-state types; see the note on Fifo3's use of it below
+inline constexpr std::size_t cache_line_size = 64;
 
 /// Threadsafe, efficient circular FIFO
 template<typename T, typename Alloc = std::allocator<T>>
@@ -54,7 +59,7 @@ public:
     auto push(T const& value) {
         auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
         auto popCursor = popCursor_.load(std::memory_order_acquire);
-        if (full(pushCursor, popCursor)) {
+        if (full(pushCursor, popCursor)) HFT_UNLIKELY {
             return false;
         }
         new (element(pushCursor)) T(value);
@@ -100,7 +105,7 @@ private:
     // note: if this use is part of a public ABI, change it to instead use a constant variable you define
     // note: the default value for the current CPU tuning is 64 bytes
     // note: you can stabilize this value with ‘--param hardware_destructive_interference_size=64’, or disable this warning with ‘-Wno-interference-size’
-    static constexpr auto hardware_destructive_interference_size = size_type{64};
+    static constexpr auto hardware_destructive_interference_size = size_type{cache_line_size};
 
     /// Loaded and stored by the push thread; loaded by the pop thread
     alignas(hardware_destructive_interference_size) CursorType pushCursor_;
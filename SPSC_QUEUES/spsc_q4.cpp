@@ -0,0 +1,239 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "spsc_q3.cpp"
+#include "queue_stats.cpp"
+
+/// Threadsafe, efficient circular FIFO with cached cursors
+///
+/// Same protocol as Fifo3 with two changes. The capacity is a power of two,
+/// so a cursor maps to its slot with a mask instead of a divide. And each
+/// side keeps a private copy of the other side's cursor, refreshing it only
+/// when the queue looks full (producer) or empty (consumer), so the opposing
+/// cursor's cache line moves between cores once per batch of operations
+/// rather than on every push and pop.
+///
+/// Beyond push and pop it can construct in place (emplace), let the consumer
+/// read the head slot without copying it out (front/pop_front), and move a
+/// whole batch with one release store of the cursor (push_batch/pop_batch).
+///
+/// Stats selects telemetry (see queue_stats.cpp); the default records
+/// nothing and adds no code to the hot path.
+template<typename T, typename Alloc = std::allocator<T>, typename Stats = NoQueueStats>
+class Fifo4 : private Alloc
+{
+public:
+    using value_type = T;
+    using allocator_traits = std::allocator_traits<Alloc>;
+    using size_type = typename allocator_traits::size_type;
+
+    /// capacity is rounded up to the next power of two
+    explicit Fifo4(size_type capacity, Alloc const& alloc = Alloc{})
+        : Alloc{alloc}
+        , mask_{std::bit_ceil(capacity) - 1}
+        , ring_{allocator_traits::allocate(*this, mask_ + 1)}
+        , stats_{mask_ + 1}
+    {}
+
+    ~Fifo4() {
+        while(not empty()) {
+            element(popCursor_)->~T();
+            ++popCursor_;
+        }
+        allocator_traits::deallocate(*this, ring_, capacity());
+    }
+
+
+    /// Returns the number of elements in the fifo
+    auto size() const noexcept {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+
+        assert(popCursor <= pushCursor);
+        return pushCursor - popCursor;
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns whether the container has capacity_() elements
+    auto full() const noexcept { return size() == capacity(); }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return mask_ + 1; }
+
+    /// Telemetry; SampledQueueStats::read() is safe from any thread
+    Stats const& stats() const noexcept { return stats_; }
+
+
+    /// Push one object onto the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        return emplace(value);
+    }
+
+    /// Move one object onto the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T&& value) {
+        return emplace(std::move(value));
+    }
+
+    /// Construct one object in place at the back of the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    template<typename... Args>
+    auto emplace(Args&&... args) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        if (full(pushCursor, popCursorCached_)) HFT_UNLIKELY {
+            popCursorCached_ = popCursor_.load(std::memory_order_acquire);
+            stats_.on_push_refresh(pushCursor - popCursorCached_);
+            if (full(pushCursor, popCursorCached_)) {
+                stats_.on_full();
+                return false;
+            }
+        }
+        new (element(pushCursor)) T(std::forward<Args>(args)...);
+        stats_.stamp(pushCursor);
+        pushCursor_.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Push up to n objects, the i-th constructed from make(i), publishing
+    /// them all with one store.
+    /// @return the number pushed; less than n if the fifo filled up.
+    template<typename Make>
+    auto push_batch(size_type n, Make&& make) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto room = capacity() - (pushCursor - popCursorCached_);
+        if (room < n) HFT_UNLIKELY {
+            popCursorCached_ = popCursor_.load(std::memory_order_acquire);
+            room = capacity() - (pushCursor - popCursorCached_);
+            stats_.on_push_refresh(capacity() - room);
+            if (room == 0) {
+                stats_.on_full();
+            }
+        }
+        auto count = n < room ? n : room;
+        for (size_type i = 0; i < count; ++i) {
+            new (element(pushCursor + i)) T(make(i));
+            stats_.stamp(pushCursor + i);
+        }
+        if (count) {
+            pushCursor_.store(pushCursor + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /// Pop one object from the fifo.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        if (empty(pushCursorCached_, popCursor)) {
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            stats_.on_pop_refresh(pushCursorCached_ - popCursor);
+            if (empty(pushCursorCached_, popCursor)) {
+                stats_.on_empty();
+                return false;
+            }
+        }
+        value = std::move(*element(popCursor));
+        element(popCursor)->~T();
+        stats_.sample(popCursor);
+        popCursor_.store(popCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// The object at the head of the fifo, left in place; consumer only.
+    /// @return `nullptr` if fifo is empty.
+    T* front() {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        if (empty(pushCursorCached_, popCursor)) {
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            stats_.on_pop_refresh(pushCursorCached_ - popCursor);
+            if (empty(pushCursorCached_, popCursor)) {
+                stats_.on_empty();
+                return nullptr;
+            }
+        }
+        return element(popCursor);
+    }
+
+    /// Destroy the object returned by front() and release its slot.
+    void pop_front() {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        assert(not empty(pushCursorCached_, popCursor));
+        element(popCursor)->~T();
+        stats_.sample(popCursor);
+        popCursor_.store(popCursor + 1, std::memory_order_release);
+    }
+
+    /// Hand up to max objects to consume(T&) in place, then destroy them
+    /// and release their slots with one store.
+    /// @return the number consumed; `0` if fifo is empty.
+    template<typename Consume>
+    auto pop_batch(size_type max, Consume&& consume) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        if (empty(pushCursorCached_, popCursor)) {
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            stats_.on_pop_refresh(pushCursorCached_ - popCursor);
+            if (empty(pushCursorCached_, popCursor)) {
+                stats_.on_empty();
+            }
+        }
+        auto available = pushCursorCached_ - popCursor;
+        auto count = max < available ? max : available;
+        for (size_type i = 0; i < count; ++i) {
+            auto slot = element(popCursor + i);
+            consume(*slot);
+            slot->~T();
+            stats_.sample(popCursor + i);
+        }
+        if (count) {
+            popCursor_.store(popCursor + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+private:
+    auto full(size_type pushCursor, size_type popCursor) const noexcept {
+        return (pushCursor - popCursor) == capacity();
+    }
+    static auto empty(size_type pushCursor, size_type popCursor) noexcept {
+        return pushCursor == popCursor;
+    }
+    auto element(size_type cursor) noexcept {
+        return &ring_[cursor & mask_];
+    }
+
+private:
+    size_type mask_;
+    T* ring_;
+
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free);
+
+    // See the note in Fifo3
+    static constexpr auto hardware_destructive_interference_size = size_type{cache_line_size};
+
+    /// Loaded and stored by the push thread; loaded by the pop thread
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_;
+
+    /// Exclusive to the push thread
+    size_type popCursorCached_{};
+
+    /// Loaded and stored by the pop thread; loaded by the push thread
+    alignas(hardware_destructive_interference_size) CursorType popCursor_;
+
+    /// Exclusive to the pop thread
+    size_type pushCursorCached_{};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[hardware_destructive_interference_size - 2 * sizeof(size_type)];
+
+    [[no_unique_address]] Stats stats_;
+};
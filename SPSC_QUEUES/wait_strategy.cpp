@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include "spsc_q3.cpp"
+#include "../orderbook/threading.cpp"
+
+/// Wait strategies for a consumer whose queue is empty, from lowest latency
+/// to lowest CPU use. Each has wait(ready), returning once ready() is true,
+/// and notify(), which the producer calls after every push; only
+/// ParkingWait does anything there.
+
+/// Poll with no pause at all; owns its core outright
+struct BusySpinWait
+{
+    template<typename Ready>
+    void wait(Ready&& ready) {
+        while (not ready()) {
+        }
+    }
+    void notify() noexcept {}
+};
+
+/// Poll with exponentially more pause instructions between attempts, which
+/// frees the sibling hyperthread and cuts power while staying on the core
+struct PauseBackoffWait
+{
+    static constexpr unsigned max_pauses = 64;
+
+    template<typename Ready>
+    void wait(Ready&& ready) {
+        for (unsigned pauses = 1; not ready(); pauses = std::min(pauses * 2, max_pauses)) {
+            for (unsigned i = 0; i < pauses; ++i) {
+                cpu_relax();
+            }
+        }
+    }
+    void notify() noexcept {}
+};
+
+/// Poll briefly, then yield the core to the scheduler between attempts
+struct SpinYieldWait
+{
+    static constexpr unsigned spins = 128;
+
+    template<typename Ready>
+    void wait(Ready&& ready) {
+        for (unsigned n = 0; not ready(); ++n) {
+            if (n < spins) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+    void notify() noexcept {}
+};
+
+/// Poll briefly, then sleep in the kernel (futex via std::atomic::wait)
+/// until the producer wakes us.
+///
+/// The consumer announces itself as parked and re-checks before sleeping;
+/// the producer checks the flag after publishing and only then makes the
+/// wake-up call. A fence on each side orders the publish against the flag,
+/// so a wake-up cannot be missed. The cost to the producer when nobody is
+/// parked is that fence and one load of a line it shares with no writer.
+class ParkingWait
+{
+public:
+    static constexpr unsigned spins = 1024;
+
+    template<typename Ready>
+    void wait(Ready&& ready) {
+        for (unsigned n = 0; n < spins; ++n) {
+            if (ready()) {
+                return;
+            }
+            cpu_relax();
+        }
+        // ready() may consume (pop_wait pops), so return on the first call
+        // that succeeds and never call it again after that
+        for (;;) {
+            auto epoch = epoch_.load(std::memory_order_relaxed);
+            parked_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready()) {
+                parked_.store(false, std::memory_order_relaxed);
+                return;
+            }
+            epoch_.wait(epoch, std::memory_order_relaxed);
+            parked_.store(false, std::memory_order_relaxed);
+            if (ready()) {
+                return;
+            }
+        }
+    }
+
+    void notify() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_relaxed)) {
+            epoch_.fetch_add(1, std::memory_order_relaxed);
+            epoch_.notify_one();
+        }
+    }
+
+private:
+    /// Written by the consumer, read by the producer on every push
+    alignas(cache_line_size) std::atomic<bool> parked_{false};
+
+    /// Bumped by the producer to release a parked consumer
+    std::atomic<std::uint32_t> epoch_{0};
+
+    char padding_[cache_line_size - sizeof(std::atomic<bool>) - sizeof(std::atomic<std::uint32_t>)];
+};
+
+/// A Fifo3 or Fifo4 whose consumer can block in pop_wait under the Wait
+/// policy. Producers must push through this wrapper so the policy is told;
+/// the non-blocking pop is still there for consumers that poll.
+template<typename Queue, typename Wait = SpinYieldWait>
+class WaitingFifo
+{
+public:
+    using value_type = typename Queue::value_type;
+    using size_type = typename Queue::size_type;
+
+    template<typename... Args>
+    explicit WaitingFifo(Args&&... args) : queue_{std::forward<Args>(args)...} {}
+
+    auto size() const noexcept { return queue_.size(); }
+    auto empty() const noexcept { return queue_.empty(); }
+    auto capacity() const noexcept { return queue_.capacity(); }
+
+    /// Push one object and wake the consumer if it is parked.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(value_type const& value) {
+        if (not queue_.push(value)) {
+            return false;
+        }
+        wait_.notify();
+        return true;
+    }
+
+    /// Pop one object without waiting.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(value_type& value) { return queue_.pop(value); }
+
+    /// Pop one object, waiting under the policy while the fifo is empty
+    void pop_wait(value_type& value) {
+        wait_.wait([&] { return queue_.pop(value); });
+    }
+
+    /// As pop_wait, but give up once stop() is true; call wake() after
+    /// setting whatever stop() reads so a parked consumer sees it.
+    /// @return `true` if an object was popped; `false` if stopped.
+    template<typename Stop>
+    bool pop_wait(value_type& value, Stop&& stop) {
+        bool popped = false;
+        wait_.wait([&] { return (popped = queue_.pop(value)) or stop(); });
+        return popped;
+    }
+
+    /// Wake a parked consumer without pushing, e.g. to let it see a stop flag
+    void wake() noexcept { wait_.notify(); }
+
+private:
+    Queue queue_;
+    Wait wait_;
+};
+
+#ifdef WAIT_STRATEGY_MAIN
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Self-checks for ParkingWait; exits non-zero on the first failure
+int main()
+{
+    // A ready() that succeeds right after a park must end the wait; a
+    // second call would pop a second element over the first. ready() fails
+    // through the spin phase and the first re-check, so the consumer parks,
+    // and a waker thread keeps releasing it.
+    {
+        ParkingWait wait;
+        Fifo3<std::uint64_t> queue(8);
+        queue.push(1);
+        queue.push(2);
+        std::atomic<bool> done{false};
+        std::thread waker([&] {
+            while (not done.load()) {
+                wait.notify();
+                std::this_thread::yield();
+            }
+        });
+        unsigned calls = 0;
+        std::uint64_t value = 0;
+        wait.wait([&] { return ++calls > ParkingWait::spins + 1 and queue.pop(value); });
+        done.store(true);
+        waker.join();
+        if (value != 1 or queue.size() != 1) {
+            std::printf("FAIL: re-check after parking popped %lu with %zu left\n",
+                        static_cast<unsigned long>(value), static_cast<std::size_t>(queue.size()));
+            return 1;
+        }
+    }
+
+    // A consumer that really parks: the producer pauses far longer than
+    // the spin phase between bursts, and every value must arrive exactly
+    // once and in order
+    {
+        constexpr std::uint64_t count = 2000;
+        WaitingFifo<Fifo3<std::uint64_t>, ParkingWait> queue(std::size_t{64});
+        std::vector<std::uint64_t> received;
+        received.reserve(count);
+        std::thread consumer([&] {
+            for (std::uint64_t i = 0; i < count; ++i) {
+                std::uint64_t value;
+                queue.pop_wait(value);
+                received.push_back(value);
+            }
+        });
+        for (std::uint64_t i = 1; i <= count; ++i) {
+            if (i % 16 == 1) {
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+            while (not queue.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+        consumer.join();
+        for (std::uint64_t i = 0; i < count; ++i) {
+            if (received[i] != i + 1) {
+                std::printf("FAIL: parked consumer got %lu at position %lu\n",
+                            static_cast<unsigned long>(received[i]), static_cast<unsigned long>(i));
+                return 1;
+            }
+        }
+    }
+
+    std::printf("ParkingWait: all checks passed\n");
+    return 0;
+}
+#endif
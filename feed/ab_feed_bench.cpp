@@ -0,0 +1,193 @@
+// End-to-end check of the A/B multicast feed handler over loopback.
+//
+// A publisher thread sends identical sequenced packets to two groups,
+// dropping packets independently on each line, occasionally on both, and
+// sending line B a few packets behind A with local reordering. The handler
+// thread arbitrates them into a Fifo3 and the main thread plays the book
+// thread: it checks every message arrives exactly once, in order, and that
+// every packet was either delivered or reported lost.
+//
+//   ab_feed_bench [packets] [drop per mille per line] [both-lines drop per mille]
+//
+// Defaults: 200000 packets, 20 per mille, 2 per mille
+
+#include "multicast_feed.cpp"
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct TickMessage
+{
+    uint64_t packet;   // Sequence of the packet carrying it
+    uint32_t index;    // Position within that packet
+    uint32_t quantity;
+    int64_t price;
+};
+
+constexpr uint16_t messages_per_packet = 16;
+constexpr MulticastLine line_a{"239.255.0.1", 30001, "127.0.0.1"};
+constexpr MulticastLine line_b{"239.255.0.2", 30001, "127.0.0.1"};
+
+struct Publisher
+{
+    int fd = -1;
+    sockaddr_in groups[2] = {};
+
+    Publisher()
+    {
+        fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        in_addr interface{};
+        ::inet_pton(AF_INET, "127.0.0.1", &interface);
+        ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface));
+        int loop = 1;
+        ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        const MulticastLine *lines[2] = {&line_a, &line_b};
+        for (int i = 0; i < 2; ++i)
+        {
+            groups[i].sin_family = AF_INET;
+            groups[i].sin_port = htons(lines[i]->port);
+            ::inet_pton(AF_INET, lines[i]->group, &groups[i].sin_addr);
+        }
+    }
+
+    ~Publisher() { ::close(fd); }
+
+    void send(int line, uint64_t sequence)
+    {
+        char packet[sizeof(PacketHeader) + messages_per_packet * sizeof(TickMessage)];
+        PacketHeader header{sequence, messages_per_packet, sizeof(TickMessage)};
+        std::memcpy(packet, &header, sizeof(header));
+        for (uint32_t i = 0; i < messages_per_packet; ++i)
+        {
+            TickMessage message{sequence, i, 100, static_cast<int64_t>(1000000 + sequence % 100)};
+            std::memcpy(packet + sizeof(header) + i * sizeof(message), &message, sizeof(message));
+        }
+        ::sendto(fd, packet, sizeof(packet), 0, reinterpret_cast<sockaddr *>(&groups[line]), sizeof(groups[line]));
+    }
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint64_t packets = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    unsigned drop = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 20;
+    unsigned both_drop = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 2;
+
+    Fifo3<TickMessage> queue(1 << 16);
+    MulticastFeedHandler<TickMessage> handler(queue, line_a, line_b, 50000000);
+    if (!handler.open())
+    {
+        return 1;
+    }
+    std::atomic<bool> running{true};
+    std::thread feed([&] { handler.run(running); });
+
+    uint64_t both_dropped = 0;
+    std::atomic<bool> published{false};
+    std::thread publisher(
+        [&]
+        {
+            Publisher out;
+            uint64_t seed = 3;
+            auto roll = [&seed]()
+            {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                return static_cast<unsigned>((seed >> 33) % 1000);
+            };
+            constexpr uint64_t b_lag = 3;
+            std::vector<bool> send_b(packets + 1, true);
+            for (uint64_t sequence = 1; sequence <= packets + b_lag; ++sequence)
+            {
+                // The tail always goes out so no gap is left undetectable
+                bool tail = sequence + 64 > packets;
+                if (sequence <= packets)
+                {
+                    bool lost_both = !tail && roll() < both_drop;
+                    both_dropped += lost_both;
+                    send_b[sequence] = !lost_both && (tail || roll() >= drop);
+                    if (!lost_both && (tail || roll() >= drop))
+                    {
+                        out.send(0, sequence);
+                    }
+                }
+                // B runs behind A, occasionally swapping neighbours
+                uint64_t behind = sequence - b_lag;
+                if (sequence > b_lag && behind <= packets)
+                {
+                    if (behind + 1 <= packets && !tail && roll() < 10)
+                    {
+                        if (send_b[behind + 1])
+                        {
+                            out.send(1, behind + 1);
+                        }
+                        send_b[behind + 1] = send_b[behind];
+                        send_b[behind] = false;
+                    }
+                    if (send_b[behind])
+                    {
+                        out.send(1, behind);
+                    }
+                }
+                if (sequence % 16 == 0)
+                {
+                    std::this_thread::yield(); // Let the receive side keep up with loopback
+                }
+            }
+            published.store(true);
+        });
+
+    uint64_t expected_messages = packets * messages_per_packet;
+    uint64_t received = 0, last_packet = 0, misordered = 0;
+    uint32_t next_index = 0;
+    // Stop once the publisher is done and the queue has stayed empty for a
+    // while; the handler's counters are only read after it has stopped
+    auto last_message = std::chrono::steady_clock::now();
+    TickMessage message;
+    while (true)
+    {
+        if (!queue.pop(message))
+        {
+            if (published.load() && std::chrono::steady_clock::now() - last_message > std::chrono::milliseconds(200))
+            {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        last_message = std::chrono::steady_clock::now();
+        bool in_order = message.packet > last_packet ? message.index == 0
+                                                     : message.packet == last_packet && message.index == next_index;
+        misordered += !in_order;
+        last_packet = message.packet;
+        next_index = message.index + 1;
+        ++received;
+    }
+    publisher.join();
+    running.store(false);
+    feed.join();
+
+    const auto &arbitration = handler.arbitration();
+    const auto &stats = handler.stats();
+    std::printf("packets sent %lu, received A %lu B %lu, malformed %lu\n", static_cast<unsigned long>(packets),
+                static_cast<unsigned long>(stats.packets[0]), static_cast<unsigned long>(stats.packets[1]),
+                static_cast<unsigned long>(stats.malformed));
+    std::printf("delivered %lu, duplicates %lu, buffered out of order %lu\n",
+                static_cast<unsigned long>(arbitration.delivered), static_cast<unsigned long>(arbitration.duplicates),
+                static_cast<unsigned long>(arbitration.out_of_order));
+    std::printf("gaps %lu covering %lu packets (%lu dropped on both lines by the publisher)\n",
+                static_cast<unsigned long>(arbitration.gaps), static_cast<unsigned long>(arbitration.lost),
+                static_cast<unsigned long>(both_dropped));
+    std::printf("book thread got %lu of %lu messages, %lu out of order, queue full waits %lu\n",
+                static_cast<unsigned long>(received), static_cast<unsigned long>(expected_messages),
+                static_cast<unsigned long>(misordered), static_cast<unsigned long>(stats.queue_full));
+
+    bool consistent = misordered == 0 && arbitration.delivered + arbitration.lost == packets &&
+                      received == arbitration.delivered * messages_per_packet && arbitration.lost >= both_dropped;
+    std::printf("%s\n", consistent ? "consistent" : "INCONSISTENT");
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,336 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "wire_format.cpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FEED_X86_DECODERS 1
+#endif
+
+// Struct-of-arrays view of decoded MarketDataMessages, for analytics that
+// scan one field across many messages. Columns carry a few slots of slack
+// past capacity so vector decoders can store whole registers.
+struct MarketDataColumns
+{
+    static constexpr size_t slack = 8;
+
+    size_t size = 0;
+    std::vector<uint64_t> timestamp_ns;
+    std::vector<int64_t> price; // Raw Price units
+    std::vector<uint32_t> volume;
+    std::vector<uint32_t> instrument;
+    std::vector<uint8_t> type; // MessageType
+
+    explicit MarketDataColumns(size_t capacity)
+        : timestamp_ns(capacity + slack), price(capacity + slack), volume(capacity + slack),
+          instrument(capacity + slack), type(capacity + slack), max_size(capacity)
+    {
+    }
+
+    size_t capacity() const { return max_size; }
+    void clear() { size = 0; }
+
+private:
+    size_t max_size;
+};
+
+// Bit set of MessageTypes to keep
+inline constexpr uint32_t type_bit(MessageType type) { return uint32_t{1} << static_cast<uint8_t>(type); }
+
+struct DecodeResult
+{
+    size_t consumed = 0; // Bytes of well-formed records scanned
+    size_t decoded = 0;  // Records appended to the columns
+    size_t filtered = 0; // Well-formed records whose type was not wanted
+};
+
+enum class DecodeIsa
+{
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+namespace bulk_decode
+{
+
+// Header bytes 0..3 (length, type, version) with the type masked out, as
+// the valid MarketDataMessage has them
+inline constexpr uint64_t header_check_mask = 0xFF00FFFF;
+inline constexpr uint64_t header_expected = (uint64_t{wire_version} << 24) | sizeof(MarketDataMessage);
+
+template <typename Header>
+inline bool well_formed(const Header &header)
+{
+    return header.length == sizeof(MarketDataMessage) && header.version == wire_version;
+}
+
+// Decode records [0, count) one at a time, stopping at the first malformed one
+inline void decode_scalar(const char *bytes, size_t count, uint32_t type_mask, MarketDataColumns &out,
+                          DecodeResult &result)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto *message = reinterpret_cast<const MarketDataMessage *>(bytes + i * sizeof(MarketDataMessage));
+        if (!well_formed(message->header))
+        {
+            return;
+        }
+        result.consumed += sizeof(MarketDataMessage);
+        auto type = static_cast<uint8_t>(message->header.type);
+        if (type >= 32 || !(type_mask >> type & 1))
+        {
+            ++result.filtered;
+            continue;
+        }
+        size_t n = out.size++;
+        out.timestamp_ns[n] = message->timestamp_ns;
+        out.price[n] = message->price;
+        out.volume[n] = message->volume;
+        out.instrument[n] = message->instrument;
+        out.type[n] = type;
+        ++result.decoded;
+    }
+}
+
+#ifdef FEED_X86_DECODERS
+
+// Raw column pointers for the vector loops
+struct ColumnWriter
+{
+    uint64_t *timestamp_ns;
+    int64_t *price;
+    uint32_t *volume;
+    uint32_t *instrument;
+    uint8_t *type;
+
+    explicit ColumnWriter(MarketDataColumns &out)
+        : timestamp_ns(out.timestamp_ns.data()), price(out.price.data()), volume(out.volume.data()),
+          instrument(out.instrument.data()), type(out.type.data())
+    {
+    }
+
+    // Account for the first `records` records, whose kept ones fill the columns up to n
+    static void finish(MarketDataColumns &out, size_t n, size_t records, DecodeResult &result)
+    {
+        result.consumed += records * sizeof(MarketDataMessage);
+        result.decoded += n - out.size;
+        result.filtered += records - (n - out.size);
+        out.size = n;
+    }
+};
+
+// permutevar8x32 indices that move the 64-bit lanes selected by a 4-bit
+// mask to the front, for compressing without AVX-512
+constexpr std::array<std::array<int32_t, 8>, 16> make_compress_table()
+{
+    std::array<std::array<int32_t, 8>, 16> table{};
+    for (unsigned mask = 0; mask < 16; ++mask)
+    {
+        unsigned out = 0;
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            if (mask >> lane & 1)
+            {
+                table[mask][out++] = 2 * lane;
+                table[mask][out++] = 2 * lane + 1;
+            }
+        }
+    }
+    return table;
+}
+
+alignas(32) inline constexpr auto compress_table = make_compress_table();
+
+// Four records per step: load them as four 256-bit rows of 64-bit
+// (header, timestamp, price, volume|instrument) and transpose to columns
+__attribute__((target("avx2"))) inline void decode_avx2(const char *bytes, size_t count, uint32_t type_mask,
+                                                         MarketDataColumns &out, DecodeResult &result)
+{
+    const __m256i check_mask = _mm256_set1_epi64x(header_check_mask);
+    const __m256i expected = _mm256_set1_epi64x(header_expected);
+    const __m256i type_bits = _mm256_set1_epi64x(type_mask);
+    const __m256i byte_mask = _mm256_set1_epi64x(0xFF);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i split_halves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i type_bytes = _mm256_setr_epi8(0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 8,
+                                                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    // Locals, so stores to the byte-wide type column can't force reloads
+    ColumnWriter column(out);
+    size_t i = 0, n = out.size;
+    for (; i + 4 <= count; i += 4)
+    {
+        const char *base = bytes + i * sizeof(MarketDataMessage);
+        __m256i r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base));
+        __m256i r1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + 32));
+        __m256i r2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + 64));
+        __m256i r3 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + 96));
+        __m256i even01 = _mm256_unpacklo_epi64(r0, r1), odd01 = _mm256_unpackhi_epi64(r0, r1);
+        __m256i even23 = _mm256_unpacklo_epi64(r2, r3), odd23 = _mm256_unpackhi_epi64(r2, r3);
+        __m256i headers = _mm256_permute2x128_si256(even01, even23, 0x20);
+        __m256i prices = _mm256_permute2x128_si256(even01, even23, 0x31);
+        __m256i timestamps = _mm256_permute2x128_si256(odd01, odd23, 0x20);
+        __m256i tails = _mm256_permute2x128_si256(odd01, odd23, 0x31);
+
+        __m256i valid = _mm256_cmpeq_epi64(_mm256_and_si256(headers, check_mask), expected);
+        auto valid_mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(valid)));
+        if (valid_mask != 0xF)
+        {
+            break; // The scalar tail stops precisely at the bad record
+        }
+
+        __m256i types = _mm256_and_si256(_mm256_srli_epi64(headers, 16), byte_mask);
+        // sllv yields 0 for shift counts of 64 and above, like the scalar type >= 32 check
+        __m256i wanted = _mm256_and_si256(_mm256_sllv_epi64(one, types), type_bits);
+        __m256i unwanted = _mm256_cmpeq_epi64(wanted, _mm256_setzero_si256());
+        auto keep = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(unwanted))) & 0xF;
+
+        if (keep != 0xF)
+        {
+            __m256i compress = _mm256_load_si256(reinterpret_cast<const __m256i *>(compress_table[keep].data()));
+            timestamps = _mm256_permutevar8x32_epi32(timestamps, compress);
+            prices = _mm256_permutevar8x32_epi32(prices, compress);
+            tails = _mm256_permutevar8x32_epi32(tails, compress);
+            types = _mm256_permutevar8x32_epi32(types, compress);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(column.timestamp_ns + n), timestamps);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(column.price + n), prices);
+        __m256i split = _mm256_permutevar8x32_epi32(tails, split_halves);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(column.volume + n), _mm256_castsi256_si128(split));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(column.instrument + n), _mm256_extracti128_si256(split, 1));
+        __m256i packed = _mm256_shuffle_epi8(types, type_bytes);
+        uint32_t four = static_cast<uint16_t>(_mm256_extract_epi16(packed, 0)) |
+                        static_cast<uint32_t>(static_cast<uint16_t>(_mm256_extract_epi16(packed, 8))) << 16;
+        std::memcpy(column.type + n, &four, sizeof(four));
+        n += static_cast<size_t>(std::popcount(keep));
+    }
+    column.finish(out, n, i, result);
+    decode_scalar(bytes + i * sizeof(MarketDataMessage), count - i, type_mask, out, result);
+}
+
+// Eight records per step: four 512-bit rows, transposed with two rounds of
+// cross-register permutes, then compressed by the type mask. GCC 12 warns
+// spuriously about the undefined passthrough operands of these intrinsics
+// (GCC bug 105593).
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f"))) inline void decode_avx512(const char *bytes, size_t count, uint32_t type_mask,
+                                                               MarketDataColumns &out, DecodeResult &result)
+{
+    const __m512i check_mask = _mm512_set1_epi64(header_check_mask);
+    const __m512i expected = _mm512_set1_epi64(header_expected);
+    const __m512i type_bits = _mm512_set1_epi64(type_mask);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i first_halves = _mm512_setr_epi64(0, 4, 8, 12, 1, 5, 9, 13);
+    const __m512i second_halves = _mm512_setr_epi64(2, 6, 10, 14, 3, 7, 11, 15);
+    const __m512i split_halves = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+    ColumnWriter column(out);
+    size_t i = 0, n = out.size;
+    for (; i + 8 <= count; i += 8)
+    {
+        const char *base = bytes + i * sizeof(MarketDataMessage);
+        __m512i z0 = _mm512_loadu_si512(base);
+        __m512i z1 = _mm512_loadu_si512(base + 64);
+        __m512i z2 = _mm512_loadu_si512(base + 128);
+        __m512i z3 = _mm512_loadu_si512(base + 192);
+        // [h0..h3 t0..t3], [p0..p3 v0..v3] and the same for records 4..7
+        __m512i ht_low = _mm512_permutex2var_epi64(z0, first_halves, z1);
+        __m512i pv_low = _mm512_permutex2var_epi64(z0, second_halves, z1);
+        __m512i ht_high = _mm512_permutex2var_epi64(z2, first_halves, z3);
+        __m512i pv_high = _mm512_permutex2var_epi64(z2, second_halves, z3);
+        __m512i headers = _mm512_shuffle_i64x2(ht_low, ht_high, 0x44);
+        __m512i timestamps = _mm512_shuffle_i64x2(ht_low, ht_high, 0xEE);
+        __m512i prices = _mm512_shuffle_i64x2(pv_low, pv_high, 0x44);
+        __m512i tails = _mm512_shuffle_i64x2(pv_low, pv_high, 0xEE);
+
+        __mmask8 valid = _mm512_cmpeq_epi64_mask(_mm512_and_si512(headers, check_mask), expected);
+        if (valid != 0xFF)
+        {
+            break;
+        }
+        __m512i types = _mm512_and_si512(_mm512_srli_epi64(headers, 16), _mm512_set1_epi64(0xFF));
+        __mmask8 keep = _mm512_test_epi64_mask(_mm512_sllv_epi64(one, types), type_bits);
+
+        if (keep != 0xFF)
+        {
+            // Compress in registers and store whole vectors into the slack:
+            // compress straight to memory is microcoded on some cores
+            timestamps = _mm512_maskz_compress_epi64(keep, timestamps);
+            prices = _mm512_maskz_compress_epi64(keep, prices);
+            tails = _mm512_maskz_compress_epi64(keep, tails);
+            types = _mm512_maskz_compress_epi64(keep, types);
+        }
+        _mm512_storeu_si512(column.timestamp_ns + n, timestamps);
+        _mm512_storeu_si512(column.price + n, prices);
+        __m512i split = _mm512_permutexvar_epi32(split_halves, tails);
+        // One store; the upper (instrument) half lands past n + 8, where later
+        // records or the slack overwrite it
+        _mm512_storeu_si512(column.volume + n, split);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(column.instrument + n), _mm512_extracti64x4_epi64(split, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(column.type + n), _mm512_cvtepi64_epi8(types));
+        n += static_cast<size_t>(std::popcount(static_cast<unsigned>(keep)));
+    }
+    column.finish(out, n, i, result);
+    decode_scalar(bytes + i * sizeof(MarketDataMessage), count - i, type_mask, out, result);
+}
+#pragma GCC diagnostic pop
+
+#endif
+
+} // namespace bulk_decode
+
+// Widest decoder this CPU runs
+inline DecodeIsa best_decode_isa()
+{
+#ifdef FEED_X86_DECODERS
+    static const DecodeIsa best = []
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return DecodeIsa::Avx512;
+        }
+        return __builtin_cpu_supports("avx2") ? DecodeIsa::Avx2 : DecodeIsa::Scalar;
+    }();
+    return best;
+#else
+    return DecodeIsa::Scalar;
+#endif
+}
+
+// Decode back-to-back MarketDataMessages from bytes into out, keeping the
+// types in type_mask. Stops at the first record that is not a
+// well-formed MarketDataMessage (e.g. a heartbeat), which the caller then
+// frames and handles on the per-message path, and when out is full.
+// result.consumed says where it stopped. isa must be one this CPU runs;
+// see best_decode_isa().
+inline DecodeResult decode_market_data(std::span<const char> bytes, uint32_t type_mask, MarketDataColumns &out,
+                                       DecodeIsa isa = best_decode_isa())
+{
+    DecodeResult result;
+    size_t count = std::min(bytes.size() / sizeof(MarketDataMessage), out.capacity() - out.size);
+    switch (isa)
+    {
+#ifdef FEED_X86_DECODERS
+    case DecodeIsa::Avx512:
+        bulk_decode::decode_avx512(bytes.data(), count, type_mask, out, result);
+        break;
+    case DecodeIsa::Avx2:
+        bulk_decode::decode_avx2(bytes.data(), count, type_mask, out, result);
+        break;
+#endif
+    default:
+        bulk_decode::decode_scalar(bytes.data(), count, type_mask, out, result);
+        break;
+    }
+    return result;
+}
@@ -0,0 +1,117 @@
+// Throughput of the bulk MarketDataMessage decoder per instruction set.
+//
+// Fills a buffer with back-to-back trades and quotes, then decodes it into
+// columns with every decoder this CPU runs, keeping all types and then
+// trades only. Each vector decoder's columns are checked against the
+// scalar decoder's, as is where every decoder stops at a heartbeat
+// spliced into the stream.
+//
+//   decode_bench [messages] [repetitions]
+//
+// Defaults: 100000 messages, 200 repetitions
+
+#include "bulk_decoder.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+
+const char *isa_name(DecodeIsa isa)
+{
+    switch (isa)
+    {
+    case DecodeIsa::Avx512:
+        return "avx-512";
+    case DecodeIsa::Avx2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+bool same_columns(const MarketDataColumns &a, const MarketDataColumns &b)
+{
+    auto equal = [n = a.size](const auto &x, const auto &y) { return std::equal(x.begin(), x.begin() + n, y.begin()); };
+    return a.size == b.size && equal(a.timestamp_ns, b.timestamp_ns) && equal(a.price, b.price) &&
+           equal(a.volume, b.volume) && equal(a.instrument, b.instrument) && equal(a.type, b.type);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t messages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::vector<MarketDataMessage> stream(messages);
+    uint64_t seed = 11;
+    for (size_t i = 0; i < messages; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        auto &message = stream[i];
+        init_header(message, static_cast<uint32_t>(i + 1), (seed >> 40) % 10 < 6 ? MessageType::Trade : MessageType::Quote);
+        message.timestamp_ns = 1'700'000'000'000'000'000ULL + i * 250;
+        message.price = static_cast<int64_t>(1'000'000 + (seed >> 33) % 5000);
+        message.volume = static_cast<uint32_t>(1 + (seed >> 20) % 1000);
+        message.instrument = static_cast<uint32_t>((seed >> 50) % 4096);
+    }
+    std::span<const char> bytes(reinterpret_cast<const char *>(stream.data()), messages * sizeof(MarketDataMessage));
+
+    std::vector<DecodeIsa> isas = {DecodeIsa::Scalar};
+    if (best_decode_isa() >= DecodeIsa::Avx2)
+    {
+        isas.push_back(DecodeIsa::Avx2);
+    }
+    if (best_decode_isa() >= DecodeIsa::Avx512)
+    {
+        isas.push_back(DecodeIsa::Avx512);
+    }
+
+    bool consistent = true;
+    struct Filter
+    {
+        const char *name;
+        uint32_t mask;
+    };
+    for (Filter filter : {Filter{"all types", type_bit(MessageType::Trade) | type_bit(MessageType::Quote)},
+                          Filter{"trades only", type_bit(MessageType::Trade)}})
+    {
+        MarketDataColumns reference(messages);
+        decode_market_data(bytes, filter.mask, reference, DecodeIsa::Scalar);
+        for (DecodeIsa isa : isas)
+        {
+            MarketDataColumns columns(messages);
+            auto start = std::chrono::steady_clock::now();
+            DecodeResult result;
+            for (int r = 0; r < repetitions; ++r)
+            {
+                columns.clear();
+                result = decode_market_data(bytes, filter.mask, columns, isa);
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            bool same = same_columns(columns, reference) && result.consumed == bytes.size();
+            consistent = consistent && same;
+            std::printf("%-12s %-8s %6.3f ns/msg  kept %zu of %zu%s\n", filter.name, isa_name(isa),
+                        ns / static_cast<double>(messages * static_cast<size_t>(repetitions)), result.decoded,
+                        messages, same ? "" : "  MISMATCH");
+        }
+    }
+
+    // A heartbeat mid-stream must stop every decoder exactly in front of it
+    size_t splice = messages / 2 + 3;
+    std::memset(&stream[splice], 0, sizeof(MarketDataMessage));
+    init_header(*reinterpret_cast<HeartbeatMessage *>(&stream[splice]), 0);
+    for (DecodeIsa isa : isas)
+    {
+        MarketDataColumns columns(messages);
+        DecodeResult result = decode_market_data(bytes, ~uint32_t{0}, columns, isa);
+        bool stopped = result.consumed == splice * sizeof(MarketDataMessage) && columns.size == splice;
+        consistent = consistent && stopped;
+        std::printf("heartbeat at %zu: %-8s stopped at %zu%s\n", splice, isa_name(isa),
+                    result.consumed / sizeof(MarketDataMessage), stopped ? "" : "  WRONG");
+    }
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+// Receive-path benchmark: one read() per message against FeedReader.
+//
+// A writer thread streams 20-byte records (the dummy_market_server.py
+// layout) over a stream socketpair in randomly sized chunks, so messages
+// regularly straddle send boundaries. The consumer either loops read() for
+// exactly one record at a time, as L1/mocks/MarketFeed.cpp did (fixed to
+// handle short reads), or drains FeedReader spans over each transport:
+// recv(), io_uring, and the same bytes replayed from memory. Every record
+// carries its sequence number, and the consumer checks none were lost or
+// torn.
+//
+//   feed_bench [messages] [largest send]
+//
+// Defaults: 2000000 messages, 4096-byte sends
+
+#include "feed_reader.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t record_size = 20; // 'QdI': sequence, price, volume
+
+struct Result
+{
+    double seconds;
+    uint64_t syscalls;
+    bool in_order;
+};
+
+void write_all(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t sent = ::send(fd, data, length, 0);
+        if (sent <= 0)
+        {
+            return;
+        }
+        data += sent;
+        length -= static_cast<size_t>(sent);
+    }
+}
+
+// Checks the sequence number at the front of one record
+struct SequenceCheck
+{
+    uint64_t expected = 0;
+    bool in_order = true;
+
+    void operator()(const char *record)
+    {
+        uint64_t sequence;
+        std::memcpy(&sequence, record, sizeof(sequence));
+        in_order = in_order && sequence == expected;
+        ++expected;
+    }
+};
+
+std::vector<char> build_stream(uint64_t messages)
+{
+    std::vector<char> stream(messages * record_size);
+    for (uint64_t i = 0; i < messages; ++i)
+    {
+        double price = 100.0 + static_cast<double>(i % 1000) / 100;
+        uint32_t volume = 100;
+        std::memcpy(&stream[i * record_size], &i, 8);
+        std::memcpy(&stream[i * record_size + 8], &price, 8);
+        std::memcpy(&stream[i * record_size + 16], &volume, 4);
+    }
+    return stream;
+}
+
+void run_writer(int fd, uint64_t messages, size_t largest_send)
+{
+    std::vector<char> stream = build_stream(messages);
+    uint64_t seed = 7;
+    for (size_t offset = 0; offset < stream.size();)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        size_t chunk = std::min(stream.size() - offset, 1 + (seed >> 33) % largest_send);
+        write_all(fd, stream.data() + offset, chunk);
+        offset += chunk;
+    }
+    ::shutdown(fd, SHUT_WR);
+}
+
+Result per_message_read(int fd)
+{
+    SequenceCheck check;
+    uint64_t syscalls = 0;
+    char record[record_size];
+    auto start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        size_t have = 0;
+        while (have < record_size)
+        {
+            ++syscalls;
+            ssize_t got = ::read(fd, record + have, record_size - have);
+            if (got <= 0)
+            {
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                return {seconds, syscalls, check.in_order && have == 0};
+            }
+            have += static_cast<size_t>(got);
+        }
+        check(record);
+    }
+}
+
+template <typename Transport>
+Result batched_read(Transport transport, uint64_t messages)
+{
+    SequenceCheck check;
+    FeedReader<FixedFraming, Transport> reader(std::move(transport), FixedFraming{record_size});
+    auto start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        std::span<const char> batch;
+        ReadStatus status = reader.poll(batch);
+        for (size_t offset = 0; offset < batch.size(); offset += record_size)
+        {
+            check(batch.data() + offset);
+        }
+        if (status == ReadStatus::Closed || status == ReadStatus::Error)
+        {
+            break;
+        }
+        if (status == ReadStatus::WouldBlock)
+        {
+            std::this_thread::yield();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return {seconds, reader.stats().syscalls, check.in_order && check.expected == messages};
+}
+
+template <typename Consume>
+Result run(uint64_t messages, size_t largest_send, Consume consume)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        std::perror("socketpair");
+        std::exit(1);
+    }
+    std::thread writer(run_writer, fds[0], messages, largest_send);
+    Result result = consume(fds[1]);
+    writer.join();
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return result;
+}
+
+void report(const char *name, uint64_t messages, const Result &result)
+{
+    std::printf("%-20s %8.1f M msg/s %10.4f syscalls/msg  %s\n", name,
+                static_cast<double>(messages) / result.seconds / 1e6,
+                static_cast<double>(result.syscalls) / static_cast<double>(messages),
+                result.in_order ? "in order" : "OUT OF ORDER");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint64_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    size_t largest_send = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4096;
+
+    Result naive = run(messages, largest_send, [](int fd) { return per_message_read(fd); });
+    Result batched =
+        run(messages, largest_send, [messages](int fd) { return batched_read(SocketTransport(fd), messages); });
+    report("read() per message", messages, naive);
+    report("FeedReader recv", messages, batched);
+    bool in_order = naive.in_order && batched.in_order;
+#ifdef FEED_HAS_IO_URING
+    if (IoUringTransport(-1).ok())
+    {
+        Result uring = run(messages, largest_send,
+                           [messages](int fd) { return batched_read(IoUringTransport(fd), messages); });
+        report("FeedReader uring", messages, uring);
+        in_order = in_order && uring.in_order;
+    }
+#endif
+    std::vector<char> stream = build_stream(messages);
+    Result memory = batched_read(MemoryTransport(stream, largest_send), messages);
+    report("FeedReader memory", messages, memory);
+    return in_order && memory.in_order ? 0 : 1;
+}
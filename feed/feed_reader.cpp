@@ -0,0 +1,128 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <utility>
+
+#include "transport.cpp"
+
+// Framing for streams of back-to-back fixed-size records, such as the
+// 20-byte packets of L1/mocks/dummy_market_server.py
+struct FixedFraming
+{
+    size_t message_size;
+
+    // Length of the message starting at data, or 0 if fewer than that many
+    // bytes have arrived
+    size_t frame(const char *, size_t available) const
+    {
+        return available >= message_size ? message_size : 0;
+    }
+
+    size_t max_message_size() const { return message_size; }
+};
+
+struct FeedReaderStats
+{
+    uint64_t syscalls = 0;
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+};
+
+// Reads a byte stream in large non-blocking chunks and hands out spans of
+// complete messages, several kilobytes per receive instead of one read()
+// per message. Where the bytes come from is the Transport policy (see
+// transport.cpp); sockets by default.
+//
+// A message cut by a segment boundary stays in the buffer until the rest
+// arrives: each poll() first moves that partial tail (less than one
+// message) back to the front, then fills the free space with one receive.
+// Handed-out spans therefore stay contiguous with no wrap-around, and stay
+// valid until the next poll().
+template <typename Framing = FixedFraming, FeedTransport Transport = SocketTransport>
+class FeedReader
+{
+private:
+    Framing framing;
+    size_t capacity;
+    std::unique_ptr<char[]> buffer;
+    size_t head = 0; // Start of the first message not yet handed out
+    size_t tail = 0; // End of the received bytes
+    FeedReaderStats counters;
+    Transport source; // Declared last: an in-flight receive must end before buffer goes
+
+public:
+    // capacity must hold several messages
+    FeedReader(Transport transport, Framing framing_policy, size_t buffer_bytes = 64 * 1024)
+        : framing(framing_policy), capacity(buffer_bytes), buffer(new char[buffer_bytes]),
+          source(std::move(transport))
+    {
+    }
+
+    FeedReader(const FeedReader &) = delete;
+    FeedReader &operator=(const FeedReader &) = delete;
+
+    // Discard the previous span, make one non-blocking receive, and set
+    // messages to every complete message now buffered
+    ReadStatus poll(std::span<const char> &messages)
+    {
+        compact();
+        ReadStatus status = receive();
+        messages = complete_messages();
+        return status;
+    }
+
+    FeedReaderStats stats() const
+    {
+        FeedReaderStats stats = counters;
+        stats.syscalls = source.syscalls();
+        return stats;
+    }
+
+    Transport &transport() { return source; }
+
+private:
+    void compact()
+    {
+        // A receive still in flight is writing at tail, so leave it alone;
+        // the spans handed out are already done with either way
+        if (head == 0 || source.busy())
+        {
+            return;
+        }
+        std::memmove(buffer.get(), buffer.get() + head, tail - head);
+        tail -= head;
+        head = 0;
+    }
+
+    ReadStatus receive()
+    {
+        if (tail == capacity)
+        {
+            // Only reachable if a message is larger than the buffer
+            errno = EMSGSIZE;
+            return ReadStatus::Error;
+        }
+        size_t received = 0;
+        ReadStatus status = source.receive(buffer.get() + tail, capacity - tail, received);
+        tail += received;
+        counters.bytes += received;
+        return status;
+    }
+
+    std::span<const char> complete_messages()
+    {
+        size_t end = head;
+        while (size_t length = framing.frame(buffer.get() + end, tail - end))
+        {
+            end += length;
+            ++counters.messages;
+        }
+        std::span<const char> messages(buffer.get() + head, end - head);
+        head = end;
+        return messages;
+    }
+};
@@ -0,0 +1,414 @@
+// Native market-data generator, replacing L1/mocks/dummy_market_server.py
+// for load testing.
+//
+// Messages are MarketDataMessages (feed/wire_format.cpp) built up front in
+// a per-client ring; sending only patches each message's sequence number
+// and send timestamp (CLOCK_MONOTONIC ns, so a client on the same host can
+// measure wire-to-decode latency) and hands whole slices of the ring to
+// one writev. In multicast mode the same messages go out as A/B packets
+// (feed/multicast_feed.cpp) with sendmmsg.
+//
+// The rate is paced against a schedule, so a slow writev is caught up on
+// rather than lowering the rate. A burst profile multiplies the rate for
+// the first part of every period, like an open or a news spike.
+//
+//   market_data_server [--port N] [--clients N] [--rate MSG/S] [--messages N]
+//                      [--batch N] [--burst PERIOD_MS,BURST_MS,FACTOR]
+//                      [--multicast GROUP_A,GROUP_B:PORT] [--interface ADDR]
+//
+// Defaults: --port 5555 --clients 1 --rate 1000000 --messages 0 (until the
+//           client leaves) --batch 256, no bursts, TCP. --rate 0 sends as
+//           fast as the socket takes it. Rates and message counts are per
+//           client. Multicast sends 32 full packets per sendmmsg and
+//           ignores --batch.
+
+#include "wire_format.cpp"
+#include "multicast_feed.cpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+
+namespace
+{
+
+struct GeneratorConfig
+{
+    uint16_t port = 5555;
+    unsigned clients = 1;
+    double rate = 1000000; // Messages per second; 0 = unpaced
+    uint64_t messages = 0; // 0 = until the peer goes away
+    unsigned batch = 256;  // Messages per pacing step and per iovec (TCP)
+    double burst_period_ms = 0;
+    double burst_ms = 0;
+    double burst_factor = 1;
+    std::string multicast; // "A,B:PORT" for multicast mode
+    std::string interface = "127.0.0.1";
+};
+
+uint64_t monotonic_ns()
+{
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+// Messages that should have been sent t_ns into the run: the base rate
+// throughout, plus (factor - 1) times it during each period's burst
+struct Schedule
+{
+    double per_ns = 0;
+    double period_ns = 0;
+    double burst_ns = 0;
+    double factor = 1;
+
+    explicit Schedule(const GeneratorConfig &config)
+        : per_ns(config.rate / 1e9), period_ns(config.burst_period_ms * 1e6), burst_ns(config.burst_ms * 1e6),
+          factor(config.burst_factor)
+    {
+    }
+
+    bool paced() const { return per_ns > 0; }
+
+    uint64_t due(uint64_t t_ns) const
+    {
+        double t = static_cast<double>(t_ns);
+        double bursting = 0;
+        if (period_ns > 0)
+        {
+            double periods = std::floor(t / period_ns);
+            bursting = periods * burst_ns + std::min(t - periods * period_ns, burst_ns);
+        }
+        return static_cast<uint64_t>(per_ns * (t + (factor - 1) * bursting));
+    }
+};
+
+// Sleep for long waits, spin for short ones so pacing stays tight
+void wait_until_due(const Schedule &schedule, uint64_t start, uint64_t target)
+{
+    for (uint64_t due = schedule.due(monotonic_ns() - start); due < target;
+         due = schedule.due(monotonic_ns() - start))
+    {
+        // More than ~50 us to go
+        if (static_cast<double>(target - due) > schedule.per_ns * 50000)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+        else
+        {
+            cpu_relax();
+        }
+    }
+}
+
+// Random-walk trades and quotes over a few hundred instruments, built once
+std::vector<MarketDataMessage> build_ring(size_t count, uint64_t seed)
+{
+    std::vector<MarketDataMessage> ring(count);
+    std::vector<int64_t> prices(512, 100 * Price::scale);
+    for (auto &message : ring)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        auto instrument = static_cast<uint32_t>((seed >> 33) % prices.size());
+        prices[instrument] += static_cast<int64_t>((seed >> 20) % 5) - 2;
+        init_header(message, 0, (seed >> 45) % 4 == 0 ? MessageType::Trade : MessageType::Quote);
+        message.price = prices[instrument];
+        message.volume = static_cast<uint32_t>(1 + (seed >> 50) % 500);
+        message.instrument = instrument;
+    }
+    return ring;
+}
+
+struct SenderStats
+{
+    uint64_t messages = 0;
+    uint64_t syscalls = 0;
+    double seconds = 0;
+};
+
+// Write every byte of iov, resuming after partial writes.
+// Returns false once the peer has gone away.
+bool write_all(int fd, iovec *iov, int count, uint64_t &syscalls)
+{
+    while (count > 0)
+    {
+        ++syscalls;
+        ssize_t written = ::writev(fd, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        auto left = static_cast<size_t>(written);
+        while (count > 0 && left >= iov->iov_len)
+        {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+SenderStats serve_tcp_client(int fd, const GeneratorConfig &config, unsigned client)
+{
+    constexpr size_t ring_size = 1 << 16;
+    constexpr int max_slices = 64;
+    auto ring = build_ring(ring_size, 17 + client);
+    Schedule schedule(config);
+    SenderStats stats;
+    uint64_t start = monotonic_ns();
+    uint64_t sequence = 1;
+    size_t position = 0;
+
+    while (config.messages == 0 || stats.messages < config.messages)
+    {
+        uint64_t step = config.batch;
+        if (schedule.paced())
+        {
+            wait_until_due(schedule, start, stats.messages + step);
+            // Catch up on whatever fell due while the socket was slow
+            step = std::max<uint64_t>(step, schedule.due(monotonic_ns() - start) - stats.messages);
+        }
+        else
+        {
+            step = uint64_t{config.batch} * max_slices;
+        }
+        if (config.messages != 0)
+        {
+            step = std::min(step, config.messages - stats.messages);
+        }
+        step = std::min<uint64_t>(step, ring_size);
+
+        // Stamp the messages going out, then point iovecs at the ring
+        uint64_t now = monotonic_ns();
+        iovec iov[max_slices + 1];
+        int slices = 0;
+        for (uint64_t left = step; left > 0 && slices < max_slices;)
+        {
+            size_t length = std::min<size_t>({left, config.batch, ring_size - position});
+            for (size_t i = 0; i < length; ++i)
+            {
+                ring[position + i].header.sequence = static_cast<uint32_t>(sequence++);
+                ring[position + i].timestamp_ns = now;
+            }
+            iov[slices++] = {&ring[position], length * sizeof(MarketDataMessage)};
+            position = (position + length) % ring_size;
+            left -= length;
+            stats.messages += length;
+        }
+        if (!write_all(fd, iov, slices, stats.syscalls))
+        {
+            break;
+        }
+    }
+    stats.seconds = static_cast<double>(monotonic_ns() - start) / 1e9;
+    ::close(fd);
+    return stats;
+}
+
+int run_tcp(const GeneratorConfig &config)
+{
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config.port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, static_cast<int>(config.clients)) != 0)
+    {
+        std::perror("listen");
+        return 1;
+    }
+    std::printf("serving %u client(s) on port %u at %.0f msg/s each\n", config.clients, config.port, config.rate);
+    std::fflush(stdout);
+
+    std::vector<SenderStats> stats(config.clients);
+    std::vector<std::thread> senders;
+    for (unsigned client = 0; client < config.clients; ++client)
+    {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0)
+        {
+            std::perror("accept");
+            break;
+        }
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        senders.emplace_back([&, fd, client] { stats[client] = serve_tcp_client(fd, config, client); });
+    }
+    for (auto &sender : senders)
+    {
+        sender.join();
+    }
+    ::close(listener);
+
+    for (size_t client = 0; client < senders.size(); ++client)
+    {
+        const auto &s = stats[client];
+        std::printf("client %zu: %lu messages in %.2f s (%.0f msg/s), %.1f messages per syscall\n", client,
+                    static_cast<unsigned long>(s.messages), s.seconds, static_cast<double>(s.messages) / s.seconds,
+                    static_cast<double>(s.messages) / static_cast<double>(std::max<uint64_t>(1, s.syscalls)));
+    }
+    return 0;
+}
+
+// Sends every packet on both lines, as an exchange's A/B feed does
+int run_multicast(const GeneratorConfig &config)
+{
+    auto comma = config.multicast.find(',');
+    auto colon = config.multicast.rfind(':');
+    if (comma == std::string::npos || colon == std::string::npos || colon < comma)
+    {
+        std::fprintf(stderr, "--multicast expects GROUP_A,GROUP_B:PORT\n");
+        return 1;
+    }
+    std::string groups[2] = {config.multicast.substr(0, comma), config.multicast.substr(comma + 1, colon - comma - 1)};
+    auto port = static_cast<uint16_t>(std::stoi(config.multicast.substr(colon + 1)));
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    in_addr interface{};
+    sockaddr_in destinations[2] = {};
+    bool valid = ::inet_pton(AF_INET, config.interface.c_str(), &interface) == 1;
+    for (int line = 0; line < 2; ++line)
+    {
+        destinations[line].sin_family = AF_INET;
+        destinations[line].sin_port = htons(port);
+        valid = valid && ::inet_pton(AF_INET, groups[line].c_str(), &destinations[line].sin_addr) == 1;
+    }
+    if (!valid)
+    {
+        std::fprintf(stderr, "bad multicast or interface address\n");
+        return 1;
+    }
+    ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface));
+    int loop = 1;
+    ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+    constexpr size_t per_packet = (max_packet_size - sizeof(PacketHeader)) / sizeof(MarketDataMessage);
+    constexpr unsigned packets_per_call = 32;
+    struct Packet
+    {
+        PacketHeader header;
+        MarketDataMessage messages[per_packet];
+    };
+    static_assert(sizeof(Packet) <= max_packet_size);
+
+    std::vector<Packet> packets(packets_per_call);
+    auto ring = build_ring(1 << 16, 17);
+    mmsghdr headers[2 * packets_per_call] = {};
+    iovec vectors[packets_per_call];
+
+    Schedule schedule(config);
+    SenderStats stats;
+    uint64_t start = monotonic_ns(), packet_sequence = 1, sequence = 1;
+    std::printf("multicasting to %s and %s port %u at %.0f msg/s\n", groups[0].c_str(), groups[1].c_str(), port,
+                config.rate);
+    std::fflush(stdout);
+    while (config.messages == 0 || stats.messages < config.messages)
+    {
+        uint64_t step = packets_per_call * per_packet;
+        if (config.messages != 0)
+        {
+            step = std::min(step, config.messages - stats.messages);
+        }
+        if (schedule.paced())
+        {
+            wait_until_due(schedule, start, stats.messages + step);
+        }
+        uint64_t now = monotonic_ns();
+        unsigned count = 0;
+        for (uint64_t left = step; left > 0; ++count)
+        {
+            Packet &packet = packets[count];
+            auto messages = static_cast<uint16_t>(std::min<uint64_t>(left, per_packet));
+            packet.header = {packet_sequence++, messages, sizeof(MarketDataMessage)};
+            for (uint16_t i = 0; i < messages; ++i)
+            {
+                packet.messages[i] = ring[(sequence - 1) % ring.size()];
+                init_header(packet.messages[i], static_cast<uint32_t>(sequence++), packet.messages[i].header.type);
+                packet.messages[i].timestamp_ns = now;
+            }
+            vectors[count] = {&packet, sizeof(PacketHeader) + messages * sizeof(MarketDataMessage)};
+            for (int line = 0; line < 2; ++line)
+            {
+                auto &message = headers[2 * count + line].msg_hdr;
+                message = {};
+                message.msg_name = &destinations[line];
+                message.msg_namelen = sizeof(destinations[line]);
+                message.msg_iov = &vectors[count];
+                message.msg_iovlen = 1;
+            }
+            left -= messages;
+            stats.messages += messages;
+        }
+        for (unsigned sent = 0; sent < 2 * count;)
+        {
+            ++stats.syscalls;
+            int result = ::sendmmsg(fd, headers + sent, 2 * count - sent, 0);
+            if (result < 0)
+            {
+                std::perror("sendmmsg");
+                return 1;
+            }
+            sent += static_cast<unsigned>(result);
+        }
+    }
+    stats.seconds = static_cast<double>(monotonic_ns() - start) / 1e9;
+    std::printf("%lu messages in %lu packets per line, %.2f s (%.0f msg/s), %lu sendmmsg calls\n",
+                static_cast<unsigned long>(stats.messages), static_cast<unsigned long>(packet_sequence - 1),
+                stats.seconds, static_cast<double>(stats.messages) / stats.seconds,
+                static_cast<unsigned long>(stats.syscalls));
+    ::close(fd);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    GeneratorConfig config;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--port")
+            config.port = static_cast<uint16_t>(std::strtoul(value, nullptr, 10));
+        else if (flag == "--clients")
+            config.clients = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        else if (flag == "--rate")
+            config.rate = std::strtod(value, nullptr);
+        else if (flag == "--messages")
+            config.messages = std::strtoull(value, nullptr, 10);
+        else if (flag == "--batch")
+            config.batch = std::max(1u, static_cast<unsigned>(std::strtoul(value, nullptr, 10)));
+        else if (flag == "--burst")
+            std::sscanf(value, "%lf,%lf,%lf", &config.burst_period_ms, &config.burst_ms, &config.burst_factor);
+        else if (flag == "--multicast")
+            config.multicast = value;
+        else if (flag == "--interface")
+            config.interface = value;
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    std::signal(SIGPIPE, SIG_IGN); // A client leaving shows up as a failed writev instead
+    return config.multicast.empty() ? run_tcp(config) : run_multicast(config);
+}
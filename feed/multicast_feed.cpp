@@ -0,0 +1,451 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../SPSC_QUEUES/spsc_q3.cpp"
+#include "../orderbook/threading.cpp"
+
+// Datagram header of the A/B feed: one sequence number per packet, with
+// both lines carrying identical packets. Messages are back-to-back
+// fixed-size records after the header.
+#pragma pack(push, 1)
+struct PacketHeader
+{
+    uint64_t sequence;      // Starts at 1, +1 per packet
+    uint16_t message_count;
+    uint16_t message_size;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(PacketHeader) == 12, "packet header must stay packed");
+
+// Largest UDP payload that fits an Ethernet frame without fragmenting
+inline constexpr size_t max_packet_size = 1472;
+
+struct ArbiterStats
+{
+    uint64_t delivered = 0;    // Packets passed on in sequence order
+    uint64_t duplicates = 0;   // Already delivered or buffered; usually the slower line
+    uint64_t out_of_order = 0; // Arrived ahead of a gap and were buffered
+    uint64_t gaps = 0;         // Runs of sequence numbers given up on
+    uint64_t lost = 0;         // Packets in those runs
+};
+
+// Merges the A and B copies of a sequenced feed: the first copy of each
+// sequence number wins and the later one is dropped. Packets that arrive
+// ahead of a gap are parked in a preallocated window of Window slots until
+// the gap fills from either line. A gap is given up on once it is older
+// than the timeout passed to expire(), or once a packet arrives too far
+// ahead to fit the window; buffered packets behind it are then delivered
+// and the missing run is reported to the sink.
+//
+// Sink needs deliver(sequence, payload, length) and
+// lost(first_sequence, count).
+template <size_t Window = 1024>
+class SequenceArbiter
+{
+    static_assert(Window > 0 && (Window & (Window - 1)) == 0, "window must be a power of two");
+
+private:
+    struct Slot
+    {
+        uint64_t sequence = 0; // 0: empty
+        uint16_t length = 0;
+        char data[max_packet_size];
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t next_sequence = 0; // 0: not yet synchronised to the feed
+    size_t buffered = 0;
+    uint64_t gap_since_ns = 0; // When the oldest open gap was noticed
+    ArbiterStats counters;
+
+public:
+    SequenceArbiter() : slots(new Slot[Window]) {}
+
+    // Expect sequence next first, e.g. after a snapshot; without this the
+    // first packet seen starts the stream
+    void reset(uint64_t next)
+    {
+        for (size_t i = 0; i < Window; ++i)
+        {
+            slots[i].sequence = 0;
+        }
+        next_sequence = next;
+        buffered = 0;
+    }
+
+    // One datagram's payload (after the header) from either line
+    template <typename Sink>
+    void on_packet(uint64_t sequence, const char *payload, size_t length, uint64_t now_ns, Sink &sink)
+    {
+        if (next_sequence == 0)
+        {
+            next_sequence = sequence;
+        }
+        if (sequence < next_sequence)
+        {
+            ++counters.duplicates;
+            return;
+        }
+        if (sequence == next_sequence)
+        {
+            deliver(sequence, payload, length, sink);
+            drain(sink);
+            return;
+        }
+
+        if (sequence - next_sequence >= Window)
+        {
+            // Too far ahead to wait for the gap: give up on the oldest part
+            skip_to(sequence - Window + 1, sink);
+            drain(sink);
+            if (sequence == next_sequence)
+            {
+                deliver(sequence, payload, length, sink);
+                drain(sink);
+                return;
+            }
+        }
+        Slot &slot = slots[sequence & (Window - 1)];
+        if (slot.sequence == sequence)
+        {
+            ++counters.duplicates;
+            return;
+        }
+        slot.sequence = sequence;
+        slot.length = static_cast<uint16_t>(length);
+        std::memcpy(slot.data, payload, length);
+        if (buffered++ == 0)
+        {
+            gap_since_ns = now_ns;
+        }
+        ++counters.out_of_order;
+    }
+
+    // Give up on the oldest gap if it has been open for timeout_ns
+    template <typename Sink>
+    void expire(uint64_t now_ns, uint64_t timeout_ns, Sink &sink)
+    {
+        if (buffered == 0 || now_ns - gap_since_ns < timeout_ns)
+        {
+            return;
+        }
+        uint64_t first_buffered = next_sequence;
+        while (slots[first_buffered & (Window - 1)].sequence != first_buffered)
+        {
+            ++first_buffered;
+        }
+        skip_to(first_buffered, sink);
+        drain(sink);
+        gap_since_ns = now_ns; // Any gap still open starts its own clock
+    }
+
+    // Sequence number the arbiter is waiting for
+    uint64_t expected() const { return next_sequence; }
+
+    // Packets parked behind a gap
+    size_t pending() const { return buffered; }
+
+    const ArbiterStats &stats() const { return counters; }
+
+private:
+    template <typename Sink>
+    void deliver(uint64_t sequence, const char *payload, size_t length, Sink &sink)
+    {
+        sink.deliver(sequence, payload, length);
+        ++counters.delivered;
+        next_sequence = sequence + 1;
+    }
+
+    // Deliver buffered packets that are now next in line
+    template <typename Sink>
+    void drain(Sink &sink)
+    {
+        while (buffered > 0)
+        {
+            Slot &slot = slots[next_sequence & (Window - 1)];
+            if (slot.sequence != next_sequence)
+            {
+                return;
+            }
+            slot.sequence = 0;
+            --buffered;
+            deliver(next_sequence, slot.data, slot.length, sink);
+        }
+    }
+
+    // Move next_sequence up to target, delivering buffered packets on the
+    // way and reporting each missing run as lost
+    template <typename Sink>
+    void skip_to(uint64_t target, Sink &sink)
+    {
+        uint64_t lost_from = 0;
+        auto report = [&](uint64_t end)
+        {
+            if (lost_from != 0)
+            {
+                sink.lost(lost_from, end - lost_from);
+                ++counters.gaps;
+                counters.lost += end - lost_from;
+                lost_from = 0;
+            }
+        };
+
+        // Only the first Window sequence numbers can be in the window
+        uint64_t scan_end = std::min(target, next_sequence + Window);
+        for (uint64_t sequence = next_sequence; sequence < scan_end; ++sequence)
+        {
+            Slot &slot = slots[sequence & (Window - 1)];
+            if (slot.sequence == sequence)
+            {
+                report(sequence);
+                slot.sequence = 0;
+                --buffered;
+                deliver(sequence, slot.data, slot.length, sink);
+            }
+            else if (lost_from == 0)
+            {
+                lost_from = sequence;
+            }
+        }
+        if (target > scan_end && lost_from == 0)
+        {
+            lost_from = scan_end;
+        }
+        report(target);
+        next_sequence = target;
+    }
+};
+
+// One multicast line: group address, port and the local interface to join on
+struct MulticastLine
+{
+    const char *group;
+    uint16_t port;
+    const char *interface = "0.0.0.0";
+};
+
+struct FeedHandlerStats
+{
+    uint64_t packets[2] = {0, 0}; // Received per line, A then B
+    uint64_t malformed = 0;
+    uint64_t messages = 0;        // Pushed to the queue
+    uint64_t queue_full = 0;      // Pushes that had to wait for the book thread
+};
+
+// Receives the A and B multicast lines with batched recvmmsg, arbitrates
+// them through SequenceArbiter, and pushes the messages of each in-order
+// packet into the book thread's queue. Runs on its own (ideally pinned)
+// thread: the only state shared with the book thread is the queue. A full
+// queue backs the handler up rather than dropping, since a dropped message
+// corrupts the book; the socket buffers absorb the delay.
+template <typename Message, typename Queue = Fifo3<Message>, size_t Window = 1024>
+class MulticastFeedHandler
+{
+    static_assert(std::is_trivially_copyable_v<Message>, "messages are decoded from raw bytes");
+
+private:
+    static constexpr unsigned batch = 32; // Datagrams per recvmmsg
+
+    struct LineBuffers
+    {
+        mmsghdr headers[batch];
+        iovec vectors[batch];
+        char packets[batch][max_packet_size];
+    };
+
+    // Adapts the arbiter's callbacks to the queue
+    struct QueueSink
+    {
+        MulticastFeedHandler *handler;
+        void deliver(uint64_t sequence, const char *payload, size_t length) { handler->publish(sequence, payload, length); }
+        // The hook for a retransmission request or snapshot recovery; for
+        // now losses only show in arbitration()
+        void lost(uint64_t, uint64_t) {}
+    };
+
+    Queue &queue;
+    MulticastLine lines[2];
+    int sockets[2] = {-1, -1};
+    uint64_t gap_timeout_ns;
+    SequenceArbiter<Window> arbiter;
+    std::unique_ptr<LineBuffers> buffers[2];
+    FeedHandlerStats counters;
+
+public:
+    // gap_timeout_ns: how long a sequence gap may wait for the other line
+    // before its packets are declared lost
+    MulticastFeedHandler(Queue &out, MulticastLine a, MulticastLine b, uint64_t gap_timeout_ns = 1000000)
+        : queue(out), lines{a, b}, gap_timeout_ns(gap_timeout_ns)
+    {
+        for (auto &line : buffers)
+        {
+            line = std::make_unique<LineBuffers>();
+            for (unsigned i = 0; i < batch; ++i)
+            {
+                line->vectors[i] = {line->packets[i], max_packet_size};
+                line->headers[i] = {};
+                line->headers[i].msg_hdr.msg_iov = &line->vectors[i];
+                line->headers[i].msg_hdr.msg_iovlen = 1;
+            }
+        }
+    }
+
+    MulticastFeedHandler(const MulticastFeedHandler &) = delete;
+    MulticastFeedHandler &operator=(const MulticastFeedHandler &) = delete;
+
+    ~MulticastFeedHandler()
+    {
+        for (int fd : sockets)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+    }
+
+    // Bind and join both groups; prints the reason and returns false on failure
+    bool open(int receive_buffer_bytes = 8 << 20)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            sockets[i] = join(lines[i], receive_buffer_bytes);
+            if (sockets[i] < 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Drain whatever both lines have queued, then time out stale gaps.
+    // Returns the number of datagrams received.
+    size_t poll()
+    {
+        size_t received = 0;
+        uint64_t now = now_ns();
+        for (int i = 0; i < 2; ++i)
+        {
+            received += receive(i, now);
+        }
+        QueueSink sink{this};
+        arbiter.expire(now, gap_timeout_ns, sink);
+        return received;
+    }
+
+    // Poll until running is cleared, pausing briefly while both lines are idle
+    void run(const std::atomic<bool> &running)
+    {
+        while (running.load(std::memory_order_relaxed))
+        {
+            if (poll() == 0)
+            {
+                cpu_relax();
+            }
+        }
+    }
+
+    const FeedHandlerStats &stats() const { return counters; }
+    const ArbiterStats &arbitration() const { return arbiter.stats(); }
+
+private:
+    static uint64_t now_ns()
+    {
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+    static int join(const MulticastLine &line, int receive_buffer_bytes)
+    {
+        int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if (fd < 0)
+        {
+            std::perror("socket");
+            return -1;
+        }
+        int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer_bytes, sizeof(receive_buffer_bytes));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(line.port);
+        ip_mreq membership{};
+        if (::inet_pton(AF_INET, line.group, &address.sin_addr) != 1 ||
+            ::inet_pton(AF_INET, line.interface, &membership.imr_interface) != 1)
+        {
+            std::fprintf(stderr, "bad multicast address %s on %s\n", line.group, line.interface);
+            ::close(fd);
+            return -1;
+        }
+        membership.imr_multiaddr = address.sin_addr;
+        // Binding to the group address keeps the other line's datagrams out
+        // when both share a port
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            ::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0)
+        {
+            std::perror(line.group);
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    size_t receive(int line, uint64_t now)
+    {
+        LineBuffers &in = *buffers[line];
+        int count = ::recvmmsg(sockets[line], in.headers, batch, MSG_DONTWAIT, nullptr);
+        if (count <= 0)
+        {
+            return 0;
+        }
+        counters.packets[line] += static_cast<uint64_t>(count);
+        QueueSink sink{this};
+        for (int i = 0; i < count; ++i)
+        {
+            size_t length = in.headers[i].msg_len;
+            PacketHeader header;
+            if (length < sizeof(header)) HFT_UNLIKELY
+            {
+                ++counters.malformed;
+                continue;
+            }
+            std::memcpy(&header, in.packets[i], sizeof(header));
+            if (header.sequence == 0 || header.message_size != sizeof(Message) ||
+                length != sizeof(header) + size_t{header.message_count} * sizeof(Message)) HFT_UNLIKELY
+            {
+                ++counters.malformed;
+                continue;
+            }
+            arbiter.on_packet(header.sequence, in.packets[i] + sizeof(header), length - sizeof(header), now, sink);
+        }
+        return static_cast<size_t>(count);
+    }
+
+    void publish(uint64_t, const char *payload, size_t length)
+    {
+        for (size_t offset = 0; offset < length; offset += sizeof(Message))
+        {
+            Message message;
+            std::memcpy(&message, payload + offset, sizeof(Message));
+            while (not queue.push(message))
+            {
+                ++counters.queue_full;
+                cpu_relax();
+            }
+            ++counters.messages;
+        }
+    }
+};
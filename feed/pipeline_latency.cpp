@@ -0,0 +1,214 @@
+// Stage-by-stage latency of the whole feed pipeline on one host.
+//
+// A publisher thread paces MarketDataMessages over loopback TCP, stamping
+// each with its send time. The feed thread reads them with FeedReader,
+// takes the kernel receive timestamp (SO_TIMESTAMPING) when available,
+// decodes, and pushes each message with its StageStamps onto a Fifo3. The
+// main thread plays the book thread: it pops, applies the quote to an
+// OrderBook, and records the stamps. The report shows where the time goes:
+// sent -> rx is the kernel and loopback, rx -> decoded the reader,
+// decoded -> enqueued the push, enqueued -> dequeued the queue hand-off,
+// dequeued -> applied the book.
+//
+//   pipeline_latency [messages] [rate per second] [messages per write]
+//
+// Defaults: 200000 messages, 100000 per second, 16 per write
+
+#include "feed_reader.cpp"
+#include "timestamps.cpp"
+#include "wire_format.cpp"
+#include "../orderbook/orderbook.cpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace
+{
+
+using StampedMessage = Stamped<MarketDataMessage>;
+
+constexpr uint64_t resting_orders = 1000; // Book size kept steady by cancelling old quotes
+
+// Bids below 100.00, asks above, so quotes rest and never match
+int64_t quote_price(uint32_t sequence)
+{
+    int64_t offset = static_cast<int64_t>(sequence * 37 % 100) * 100;
+    return sequence & 1 ? 990000 + offset : 1000100 + offset;
+}
+
+void publish(int listener, uint32_t messages, uint64_t rate, uint32_t batch)
+{
+    int fd = ::accept(listener, nullptr, nullptr);
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    std::vector<MarketDataMessage> out(batch);
+    uint64_t start = TscClock::now_ns();
+    for (uint32_t sent = 0; sent < messages;)
+    {
+        // Pace against the schedule so a late write is caught up on
+        uint64_t due = start + static_cast<uint64_t>(sent) * 1000000000ull / rate;
+        while (TscClock::now_ns() < due)
+        {
+            std::this_thread::yield();
+        }
+        uint32_t count = std::min(batch, messages - sent);
+        uint64_t now = TscClock::now_ns();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            MarketDataMessage &md = out[i];
+            uint32_t sequence = sent + i + 1;
+            init_header(md, sequence, MessageType::Quote);
+            md.timestamp_ns = now;
+            md.price = quote_price(sequence);
+            md.volume = 100;
+            md.instrument = 1;
+        }
+        const char *bytes = reinterpret_cast<const char *>(out.data());
+        size_t length = count * sizeof(MarketDataMessage);
+        while (length)
+        {
+            ssize_t written = ::send(fd, bytes, length, MSG_NOSIGNAL);
+            if (written <= 0)
+            {
+                std::perror("send");
+                ::close(fd);
+                return;
+            }
+            bytes += written;
+            length -= static_cast<size_t>(written);
+        }
+        sent += count;
+    }
+    ::close(fd);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint32_t messages = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 200000;
+    uint64_t rate = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    uint32_t batch = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 16;
+    if (!messages || !rate || !batch)
+    {
+        std::fprintf(stderr, "messages, rate and batch must be positive\n");
+        return 1;
+    }
+    if (!TscClock::invariant())
+    {
+        std::fprintf(stderr, "warning: no invariant TSC, stage latencies may drift\n");
+    }
+
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(address);
+    if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, 1) != 0 ||
+        ::getsockname(listener, reinterpret_cast<sockaddr *>(&address), &address_length) != 0)
+    {
+        std::perror("listen");
+        return 1;
+    }
+    std::thread publisher(publish, listener, messages, rate, batch);
+
+    Fifo3<StampedMessage> queue(1 << 14);
+    bool kernel_stamps = false;
+    std::atomic<bool> feed_done{false};
+    std::thread feed([&] {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            std::perror("connect");
+            std::exit(1);
+        }
+        FeedReader<WireFraming> reader(SocketTransport(fd), WireFraming{});
+        kernel_stamps = reader.transport().enable_rx_timestamps();
+
+        uint32_t decoded = 0;
+        while (decoded < messages)
+        {
+            std::span<const char> batch_bytes;
+            ReadStatus status = reader.poll(batch_bytes);
+            if (batch_bytes.empty())
+            {
+                if (status == ReadStatus::Closed || status == ReadStatus::Error)
+                {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            uint64_t rx = reader.transport().last_rx_ticks();
+            rx = rx ? rx : TscClock::now();
+            for (size_t offset = 0; offset < batch_bytes.size();)
+            {
+                auto rest = batch_bytes.subspan(offset);
+                size_t length = WireFraming{}.frame(rest.data(), rest.size());
+                offset += length;
+                const auto *md = view_message<MarketDataMessage>(rest.first(length));
+                if (!md)
+                {
+                    continue;
+                }
+                StampedMessage item{*md, {}};
+                item.stamps.stamp(Stage::Sent, TscClock::from_monotonic_ns(md->timestamp_ns));
+                item.stamps.stamp(Stage::Rx, rx);
+                item.stamps.stamp(Stage::Decoded);
+                item.stamps.stamp(Stage::Enqueued);
+                while (!queue.push(item))
+                {
+                    std::this_thread::yield(); // Book thread is behind
+                }
+                ++decoded;
+            }
+        }
+        ::close(fd);
+        feed_done.store(true, std::memory_order_release);
+    });
+
+    // Book thread
+    OrderBook book;
+    StageLatencyReport report;
+    for (uint32_t applied = 0; applied < messages;)
+    {
+        StampedMessage item;
+        if (!queue.pop(item))
+        {
+            if (feed_done.load(std::memory_order_acquire) && queue.empty())
+            {
+                break; // Feed ended early
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        item.stamps.stamp(Stage::Dequeued);
+        uint32_t sequence = item.message.header.sequence;
+        book.add_order({sequence, (sequence & 1) != 0, item.message.price_value(), item.message.volume,
+                        TscClock::now_ns()});
+        if (sequence > resting_orders)
+        {
+            book.cancel_order(sequence - resting_orders);
+        }
+        item.stamps.stamp(Stage::Applied);
+        report.record(item.stamps);
+        ++applied;
+    }
+
+    feed.join();
+    publisher.join();
+    ::close(listener);
+
+    std::printf("%u messages at %lu/s, %u per write, rx stamps from %s\n", messages,
+                static_cast<unsigned long>(rate), batch, kernel_stamps ? "the kernel" : "recv return");
+    std::printf("stage latency (ns):\n");
+    report.print();
+    return 0;
+}
@@ -0,0 +1,423 @@
+// Tick-to-decision latency of the composed pipeline, one thread per stage.
+//
+// The feed thread replays pre-encoded MarketDataMessages through
+// FeedReader over a MemoryTransport, one batch per poll paced to --rate,
+// decodes them and constructs each with its StageStamps in place on a
+// Fifo4. The book thread takes up to --batch messages at a time straight
+// from their slots and applies every quote to an OrderBook, cancelling the
+// oldest to keep the book at --orders. Whenever the best bid or ask
+// changed it stores the new TopOfBook, with the stamps of the tick that
+// moved it, in a Seqlock. The strategy thread polls the seqlock and
+// computes a queue imbalance signal from each top of book it sees. A
+// seqlock keeps only the latest value, so tops overwritten before the
+// strategy read them are counted as conflated rather than decided.
+//
+// Sent is each batch's scheduled arrival, so time the pipeline spends
+// behind schedule is charged to it rather than hidden; sent -> decided is
+// the tick-to-decision figure. Throughput is messages applied per second
+// from the first poll to the last apply; --rate 0 runs the feed flat out
+// to find the sustainable rate.
+//
+// --save writes the headline figures to a file and --baseline compares
+// against one, exiting with status 3 if any latency rose, or throughput
+// fell, by more than --tolerance-pct. Saving a baseline from the previous
+// build catches a regression in any stage.
+//
+//   tick_to_decision [--messages N] [--rate PER_S] [--batch N] [--orders N]
+//                    [--feed-core C] [--book-core C] [--strategy-core C]
+//                    [--save FILE] [--baseline FILE] [--tolerance-pct PCT]
+//
+// Defaults: --messages 1000000 --rate 200000 --batch 8 --orders 1000,
+// threads unpinned (-1), --tolerance-pct 10
+
+#include "feed_reader.cpp"
+#include "timestamps.cpp"
+#include "wire_format.cpp"
+#include "../SPSC_QUEUES/spsc_q4.cpp"
+#include "../SPSC_QUEUES/wait_strategy.cpp"
+#include "../orderbook/orderbook.cpp"
+#include "../orderbook/seqlock.cpp"
+#include "../orderbook/threading.cpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Config
+{
+    uint32_t messages = 1000000;
+    uint64_t rate = 200000; // Messages per second; 0 for as fast as possible
+    uint32_t batch = 8;     // Messages per poll
+    uint32_t orders = 1000; // Resting quotes kept in the book
+    int feed_core = -1;
+    int book_core = -1;
+    int strategy_core = -1;
+    const char *save = nullptr;
+    const char *baseline = nullptr;
+    double tolerance_pct = 10;
+};
+
+using StampedMessage = Stamped<MarketDataMessage>;
+
+// What the book thread publishes: the new top and the tick that made it
+struct TopUpdate
+{
+    TopOfBook<1> top;
+    StageStamps stamps;
+};
+
+// Deterministic generator (splitmix64), as in orderbook_bench
+uint64_t mix(uint64_t x)
+{
+    uint64_t z = x + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Quotes within 20 ticks of 100.00, bids below and asks above, so they rest
+// and a good share of them land on the touch
+std::vector<char> encode_feed(uint32_t messages)
+{
+    std::vector<char> bytes(size_t{messages} * sizeof(MarketDataMessage));
+    for (uint32_t i = 0; i < messages; ++i)
+    {
+        uint32_t sequence = i + 1;
+        uint64_t r = mix(sequence);
+        Price offset = Price::from_raw(static_cast<int64_t>(1 + r % 20) * (Price::scale / 100));
+        MarketDataMessage md{};
+        init_header(md, sequence, MessageType::Quote);
+        md.timestamp_ns = 0;
+        md.price = (sequence & 1 ? 100_px - offset : 100_px + offset).raw;
+        md.volume = static_cast<uint32_t>(1 + (r >> 32) % 100);
+        md.instrument = 1;
+        std::memcpy(bytes.data() + size_t{i} * sizeof(MarketDataMessage), &md, sizeof(md));
+    }
+    return bytes;
+}
+
+void pin(const char *stage, int core)
+{
+    if (!pin_current_thread(core))
+    {
+        std::fprintf(stderr, "warning: could not pin the %s thread to core %d\n", stage, core);
+    }
+}
+
+bool same_level(const PriceLevel &a, const PriceLevel &b)
+{
+    return a.price == b.price && a.total_quantity == b.total_quantity;
+}
+
+// Lean with the heavier side of the touch when it outweighs the other 5:4
+int decide(const TopOfBook<1> &top)
+{
+    uint64_t bid = top.best_bid().total_quantity;
+    uint64_t ask = top.best_ask().total_quantity;
+    return 4 * bid > 5 * ask ? 1 : 4 * ask > 5 * bid ? -1 : 0;
+}
+
+// Headline figures; latencies in ns, lower is better, throughput higher
+struct Figures
+{
+    static constexpr size_t count = 5;
+    static constexpr const char *names[count] = {"p50_ns", "p99_ns", "p99.9_ns", "max_ns", "msgs_per_s"};
+    double values[count] = {};
+
+    static bool higher_is_better(size_t i) { return i == count - 1; }
+
+    bool save(const char *path) const
+    {
+        FILE *file = std::fopen(path, "w");
+        if (!file)
+        {
+            std::perror(path);
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::fprintf(file, "%s %.1f\n", names[i], values[i]);
+        }
+        return std::fclose(file) == 0;
+    }
+
+    bool load(const char *path)
+    {
+        FILE *file = std::fopen(path, "r");
+        if (!file)
+        {
+            std::perror(path);
+            return false;
+        }
+        char name[32];
+        double value;
+        size_t found = 0;
+        while (std::fscanf(file, "%31s %lf", name, &value) == 2)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (std::strcmp(name, names[i]) == 0)
+                {
+                    values[i] = value;
+                    ++found;
+                }
+            }
+        }
+        std::fclose(file);
+        if (found != count)
+        {
+            std::fprintf(stderr, "%s: expected %zu figures, found %zu\n", path, count, found);
+        }
+        return found == count;
+    }
+};
+
+// Print each figure against the baseline; false if any regressed
+bool compare(const Figures &current, const Figures &baseline, double tolerance_pct)
+{
+    bool ok = true;
+    std::printf("against baseline (tolerance %.1f%%):\n", tolerance_pct);
+    for (size_t i = 0; i < Figures::count; ++i)
+    {
+        double base = baseline.values[i];
+        double change = base > 0 ? 100.0 * (current.values[i] - base) / base : 0;
+        bool regressed = Figures::higher_is_better(i) ? change < -tolerance_pct : change > tolerance_pct;
+        ok = ok && !regressed;
+        std::printf("  %-10s %12.1f -> %12.1f  %+7.1f%%%s\n", Figures::names[i], base, current.values[i], change,
+                    regressed ? "  REGRESSED" : "");
+    }
+    return ok;
+}
+
+void feed_stage(const Config &config, std::span<const char> bytes, Fifo4<StampedMessage> &queue,
+                std::atomic<uint64_t> &first_poll)
+{
+    pin("feed", config.feed_core);
+    FeedReader<WireFraming, MemoryTransport> reader(
+        MemoryTransport(bytes, size_t{config.batch} * sizeof(MarketDataMessage)), WireFraming{});
+
+    uint64_t start = TscClock::now();
+    double ticks_per_message = config.rate ? 1e9 / TscClock::ns_per_tick() / static_cast<double>(config.rate) : 0;
+    first_poll.store(start, std::memory_order_release);
+    SpinYieldWait pace;
+
+    for (uint32_t decoded = 0; decoded < config.messages;)
+    {
+        // Hold each batch until it is due, as a paced publisher would
+        uint64_t due = start + static_cast<uint64_t>(static_cast<double>(decoded) * ticks_per_message);
+        pace.wait([&] { return TscClock::now() >= due; });
+
+        std::span<const char> batch;
+        ReadStatus status = reader.poll(batch);
+        if (batch.empty())
+        {
+            if (status == ReadStatus::Closed || status == ReadStatus::Error)
+            {
+                break;
+            }
+            continue;
+        }
+        uint64_t rx = TscClock::now();
+        for (size_t offset = 0; offset < batch.size();)
+        {
+            auto rest = batch.subspan(offset);
+            size_t length = WireFraming{}.frame(rest.data(), rest.size());
+            offset += length;
+            const auto *md = view_message<MarketDataMessage>(rest.first(length));
+            if (!md)
+            {
+                continue;
+            }
+            StageStamps stamps;
+            stamps.stamp(Stage::Sent, config.rate ? due : rx);
+            stamps.stamp(Stage::Rx, rx);
+            stamps.stamp(Stage::Decoded);
+            stamps.stamp(Stage::Enqueued);
+            while (!queue.emplace(*md, stamps))
+            {
+                std::this_thread::yield(); // Book thread is behind
+            }
+            ++decoded;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Config config;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--messages")
+            config.messages = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (flag == "--rate")
+            config.rate = std::strtoull(value, nullptr, 10);
+        else if (flag == "--batch")
+            config.batch = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (flag == "--orders")
+            config.orders = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (flag == "--feed-core")
+            config.feed_core = std::atoi(value);
+        else if (flag == "--book-core")
+            config.book_core = std::atoi(value);
+        else if (flag == "--strategy-core")
+            config.strategy_core = std::atoi(value);
+        else if (flag == "--save")
+            config.save = value;
+        else if (flag == "--baseline")
+            config.baseline = value;
+        else if (flag == "--tolerance-pct")
+            config.tolerance_pct = std::strtod(value, nullptr);
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!config.messages || !config.batch || !config.orders)
+    {
+        std::fprintf(stderr, "--messages, --batch and --orders must be positive\n");
+        return 1;
+    }
+    if (!TscClock::invariant())
+    {
+        std::fprintf(stderr, "warning: no invariant TSC, stage latencies may drift\n");
+    }
+
+    std::vector<char> bytes = encode_feed(config.messages);
+    Fifo4<StampedMessage> queue(1 << 14);
+    Seqlock<TopUpdate> slot;
+    std::atomic<uint64_t> first_poll{0};
+    std::atomic<bool> book_done{false};
+
+    // Strategy thread: one decision per top of book it observes
+    StageLatencyReport report;
+    uint64_t decisions = 0, conflated = 0;
+    uint64_t signals = 0;
+    std::thread strategy([&] {
+        pin("strategy", config.strategy_core);
+        SpinYieldWait wait;
+        uint64_t seen = 0;
+        for (;;)
+        {
+            // Done is read first, so once it is set the version is final
+            wait.wait([&] { return book_done.load(std::memory_order_acquire) || slot.version() != seen; });
+            if (slot.version() == seen)
+            {
+                break; // Book finished and its last top was already seen
+            }
+            TopUpdate update;
+            uint64_t version;
+            if (!slot.try_load(update, version) || version == seen)
+            {
+                continue; // Overlapped a store; the next attempt gets it
+            }
+            conflated += version - seen - 1;
+            seen = version;
+            signals += decide(update.top) != 0;
+            update.stamps.stamp(Stage::Decided);
+            report.record(update.stamps);
+            ++decisions;
+        }
+    });
+
+    std::thread feed(feed_stage, std::cref(config), std::span<const char>(bytes), std::ref(queue),
+                     std::ref(first_poll));
+
+    // Book thread
+    uint64_t last_apply = 0, published = 0;
+    std::thread book_thread([&] {
+        pin("book", config.book_core);
+        OrderBook book;
+        book.reserve(size_t{config.orders} * 2);
+        SpinYieldWait wait;
+        PriceLevel bid = book.best_bid(), ask = book.best_ask();
+        auto apply = [&](StampedMessage &item) {
+            item.stamps.stamp(Stage::Dequeued);
+            uint32_t sequence = item.message.header.sequence;
+            book.add_order({sequence, (sequence & 1) != 0, item.message.price_value(), item.message.volume,
+                            TscClock::now_ns()});
+            if (sequence > config.orders)
+            {
+                book.cancel_order(sequence - config.orders);
+            }
+            item.stamps.stamp(Stage::Applied);
+
+            PriceLevel new_bid = book.best_bid(), new_ask = book.best_ask();
+            if (!same_level(bid, new_bid) || !same_level(ask, new_ask))
+            {
+                bid = new_bid;
+                ask = new_ask;
+                TopUpdate update;
+                update.top.sequence = ++published;
+                update.top.bid_count = bid.total_quantity != 0;
+                update.top.ask_count = ask.total_quantity != 0;
+                update.top.bids[0] = bid;
+                update.top.asks[0] = ask;
+                update.stamps = item.stamps;
+                update.stamps.stamp(Stage::Published);
+                slot.store(update);
+            }
+        };
+        for (uint32_t applied = 0; applied < config.messages;)
+        {
+            size_t taken = 0;
+            wait.wait([&] { return (taken = queue.pop_batch(config.batch, apply)) != 0; });
+            applied += static_cast<uint32_t>(taken);
+        }
+        last_apply = TscClock::now();
+        book_done.store(true, std::memory_order_release);
+    });
+
+    feed.join();
+    book_thread.join();
+    strategy.join();
+
+    double seconds = TscClock::to_ns(last_apply - first_poll.load()) / 1e9;
+    Figures figures;
+    const LatencyHistogram &total = report.end_to_end();
+    figures.values[0] = total.percentile_ns(0.50);
+    figures.values[1] = total.percentile_ns(0.99);
+    figures.values[2] = total.percentile_ns(0.999);
+    figures.values[3] = total.max_ns();
+    figures.values[4] = static_cast<double>(config.messages) / seconds;
+
+    std::printf("%u messages, %s, %u per poll, %u resting orders, cores feed %d book %d strategy %d\n",
+                config.messages, config.rate ? (std::to_string(config.rate) + "/s").c_str() : "unpaced",
+                config.batch, config.orders, config.feed_core, config.book_core, config.strategy_core);
+    std::printf("throughput %.0f msg/s over %.3f s; %lu tops published, %lu decided, %lu conflated, %lu signals\n",
+                figures.values[4], seconds, static_cast<unsigned long>(published), static_cast<unsigned long>(decisions),
+                static_cast<unsigned long>(conflated), static_cast<unsigned long>(signals));
+    std::printf("stage latency of decided ticks (ns):\n");
+    report.print();
+    std::printf("tick to decision (ns): p50=%.0f p99=%.0f p99.9=%.0f max=%.0f\n", figures.values[0],
+                figures.values[1], figures.values[2], figures.values[3]);
+
+    if (config.save && !figures.save(config.save))
+    {
+        return 1;
+    }
+    if (config.baseline)
+    {
+        Figures baseline;
+        if (!baseline.load(config.baseline))
+        {
+            return 1;
+        }
+        if (!compare(figures, baseline, config.tolerance_pct))
+        {
+            return 3;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include "../orderbook/latency_histogram.cpp"
+#include "../orderbook/tsc_clock.cpp"
+
+// Per-message stage stamps for the feed -> queue -> book pipeline. Every
+// stamp is a TscClock tick; stamps taken elsewhere (the publisher's send
+// time, the kernel's or NIC's receive time) are converted into ticks when
+// they are recorded, so any two stages subtract directly.
+
+enum class Stage : uint8_t
+{
+    Sent,      // Publisher send time from the message (CLOCK_MONOTONIC), if it has one
+    Rx,        // NIC or kernel receive time if SO_TIMESTAMPING is on, else when recv returned
+    Decoded,   // Message parsed out of the receive buffer
+    Enqueued,  // Pushed onto the queue to the book thread
+    Dequeued,  // Popped by the book thread
+    Applied,   // Book updated
+    Published, // New top of book stored for the strategy thread
+    Decided    // Strategy acted on that top of book
+};
+
+inline constexpr size_t stage_count = 8;
+
+inline const char *stage_name(Stage stage)
+{
+    static constexpr const char *names[stage_count] = {"sent",     "rx",      "decoded",   "enqueued",
+                                                       "dequeued", "applied", "published", "decided"};
+    return names[static_cast<size_t>(stage)];
+}
+
+// One cache line carried next to each message; 0 means the stage wasn't
+// stamped
+struct StageStamps
+{
+    uint64_t ticks[stage_count] = {};
+
+    void stamp(Stage stage, uint64_t when = TscClock::now()) { ticks[static_cast<size_t>(stage)] = when; }
+    uint64_t at(Stage stage) const { return ticks[static_cast<size_t>(stage)]; }
+    bool has(Stage stage) const { return at(stage) != 0; }
+};
+
+// What travels through the queue when stage latency is measured
+template <typename Message>
+struct Stamped
+{
+    Message message;
+    StageStamps stamps;
+};
+
+// Kernel receive timestamps (SO_TIMESTAMPING). Software stamps are taken
+// in the network stack when the packet arrives and are CLOCK_REALTIME.
+// Hardware stamps come from the NIC's clock, which only matches
+// CLOCK_REALTIME if something (ptp4l/phc2sys) disciplines it; they also
+// need enable_nic_timestamping, root, and a NIC that supports it.
+struct RxTimestamp
+{
+    uint64_t realtime_ns = 0;
+    bool hardware = false;
+};
+
+// Ask for receive timestamps on fd; they arrive as SCM_TIMESTAMPING
+// control messages on recvmsg(). Returns false if the kernel refuses.
+inline bool enable_rx_timestamping(int fd, bool hardware = false)
+{
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (hardware)
+    {
+        flags |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    }
+    return ::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0;
+}
+
+// Turn on receive stamping in the NIC behind interface (SIOCSHWTSTAMP,
+// needs CAP_NET_ADMIN). fd is any socket, used only for the ioctl.
+inline bool enable_nic_timestamping(int fd, const char *interface)
+{
+    hwtstamp_config config{};
+    config.tx_type = HWTSTAMP_TX_OFF;
+    config.rx_filter = HWTSTAMP_FILTER_ALL;
+    ifreq request{};
+    std::strncpy(request.ifr_name, interface, IFNAMSIZ - 1);
+    request.ifr_data = reinterpret_cast<char *>(&config);
+    if (::ioctl(fd, SIOCSHWTSTAMP, &request) != 0)
+    {
+        std::perror("SIOCSHWTSTAMP");
+        return false;
+    }
+    return true;
+}
+
+// Control buffer big enough for one SCM_TIMESTAMPING message
+struct RxTimestampControl
+{
+    alignas(cmsghdr) char bytes[CMSG_SPACE(sizeof(timespec) * 3)];
+};
+
+// Pull the receive timestamp out of a recvmsg() result, preferring the
+// hardware stamp when there is one. Returns false if none was attached.
+inline bool read_rx_timestamp(const msghdr &message, RxTimestamp &out)
+{
+    for (const cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr *>(&message),
+                                                                                 const_cast<cmsghdr *>(cmsg)))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING)
+        {
+            continue;
+        }
+        // ts[0] software, ts[1] legacy, ts[2] raw hardware
+        timespec ts[3];
+        std::memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+        const timespec &chosen = ts[2].tv_sec || ts[2].tv_nsec ? ts[2] : ts[0];
+        if (!chosen.tv_sec && !chosen.tv_nsec)
+        {
+            return false;
+        }
+        out.realtime_ns = static_cast<uint64_t>(chosen.tv_sec) * 1000000000ull + static_cast<uint64_t>(chosen.tv_nsec);
+        out.hardware = &chosen == &ts[2];
+        return true;
+    }
+    return false;
+}
+
+// Latency between consecutive stages, plus first to last stamped stage.
+// A pair is recorded only when both of its stages were stamped. Stamps
+// from different clocks can disagree by a little (the realtime offset is
+// sampled once), so a negative gap counts as 0 rather than wrapping.
+class StageLatencyReport
+{
+private:
+    LatencyHistogram gaps[stage_count - 1]; // gaps[i]: stage i to stage i + 1
+    LatencyHistogram total;
+
+    static uint64_t elapsed(uint64_t from, uint64_t to) { return to > from ? to - from : 0; }
+
+public:
+    void record(const StageStamps &stamps)
+    {
+        size_t first = stage_count, last = 0;
+        for (size_t i = 0; i < stage_count; ++i)
+        {
+            if (!stamps.ticks[i])
+            {
+                continue;
+            }
+            first = first == stage_count ? i : first;
+            last = i;
+            if (i > 0 && stamps.ticks[i - 1])
+            {
+                gaps[i - 1].record(elapsed(stamps.ticks[i - 1], stamps.ticks[i]));
+            }
+        }
+        if (first < last)
+        {
+            total.record(elapsed(stamps.ticks[first], stamps.ticks[last]));
+        }
+    }
+
+    void reset()
+    {
+        for (LatencyHistogram &gap : gaps)
+        {
+            gap.reset();
+        }
+        total.reset();
+    }
+
+    const LatencyHistogram &between(Stage from) const { return gaps[static_cast<size_t>(from)]; }
+    const LatencyHistogram &end_to_end() const { return total; }
+
+    // One line per stage pair that has samples, in ns
+    void print(FILE *out = stdout) const
+    {
+        auto line = [out](const char *from, const char *to, const LatencyHistogram &h) {
+            std::fprintf(out, "  %-9s -> %-9s n=%-9lu p50=%-7.0f p99=%-7.0f p99.9=%-7.0f max=%.0f\n", from, to,
+                         static_cast<unsigned long>(h.count()), h.percentile_ns(0.50), h.percentile_ns(0.99),
+                         h.percentile_ns(0.999), h.max_ns());
+        };
+        for (size_t i = 0; i + 1 < stage_count; ++i)
+        {
+            if (gaps[i].count())
+            {
+                line(stage_name(static_cast<Stage>(i)), stage_name(static_cast<Stage>(i + 1)), gaps[i]);
+            }
+        }
+        if (total.count())
+        {
+            line("first", "last", total);
+        }
+    }
+};
@@ -0,0 +1,472 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define FEED_HAS_IO_URING 1
+#endif
+
+#include "../orderbook/threading.cpp"
+#include "timestamps.cpp"
+
+// Byte-stream transports for FeedReader. Each is a policy class picked at
+// compile time, so the receive loop has no virtual calls and decode and
+// book code never see which one is in use:
+//
+//   SocketTransport  non-blocking recv() on a connected socket
+//   IoUringTransport recv submitted through io_uring, completion busy-polled
+//   MemoryTransport  a byte range in memory, e.g. a MappedFile capture
+//
+// A kernel-bypass backend such as AF_XDP fits the same interface: its
+// receive() would copy (or, with a larger change, lend) UMEM frames.
+// It needs libxdp and a NIC queue, so it isn't provided here.
+
+enum class ReadStatus
+{
+    Ok,         // New bytes arrived (the span may still be empty)
+    WouldBlock, // Nothing to read right now
+    Closed,     // Peer shut the connection down, or the capture ended
+    Error       // See errno
+};
+
+// receive() fills up to capacity bytes at buffer and sets received. While
+// busy() is true a receive is still in flight into that buffer, and the
+// bytes from buffer onwards must stay where they are; the next receive()
+// must pass the same buffer.
+template <typename T>
+concept FeedTransport = requires(T transport, const T &view, char *buffer, size_t capacity, size_t &received) {
+    { transport.receive(buffer, capacity, received) } -> std::same_as<ReadStatus>;
+    { view.busy() } -> std::same_as<bool>;
+    { view.syscalls() } -> std::convertible_to<uint64_t>;
+};
+
+class SocketTransport
+{
+private:
+    int fd;
+    uint64_t calls = 0;
+    bool timestamping = false;
+    RxTimestamp last_rx;
+
+public:
+    // Switches fd to non-blocking; fd stays owned by the caller
+    explicit SocketTransport(int socket_fd) : fd(socket_fd)
+    {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    // Ask the kernel to busy-poll the device queue for up to usec
+    // microseconds before sleeping on an empty socket (Linux
+    // SO_BUSY_POLL; needs CAP_NET_ADMIN to raise above the sysctl).
+    // Returns false if unsupported.
+    bool set_busy_poll(int usec)
+    {
+#ifdef SO_BUSY_POLL
+        return ::setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) == 0;
+#else
+        (void)usec;
+        return false;
+#endif
+    }
+
+    // Receive through recvmsg() and keep the kernel's (or, if enabled on
+    // the interface, the NIC's) receive timestamp; for TCP it is that of
+    // the latest segment read. See timestamps.cpp.
+    bool enable_rx_timestamps(bool hardware = false)
+    {
+        timestamping = enable_rx_timestamping(fd, hardware);
+        return timestamping;
+    }
+
+    // Receive time of the bytes from the last receive() that returned Ok,
+    // as a TscClock tick; 0 if timestamps are off or none came with them
+    uint64_t last_rx_ticks() const
+    {
+        return last_rx.realtime_ns ? TscClock::from_realtime_ns(last_rx.realtime_ns) : 0;
+    }
+
+    bool last_rx_hardware() const { return last_rx.hardware; }
+
+    ReadStatus receive(char *buffer, size_t capacity, size_t &received)
+    {
+        ++calls;
+        ssize_t result = timestamping ? receive_stamped(buffer, capacity) : ::recv(fd, buffer, capacity, MSG_DONTWAIT);
+        if (result > 0)
+        {
+            received = static_cast<size_t>(result);
+            return ReadStatus::Ok;
+        }
+        received = 0;
+        if (result == 0)
+        {
+            return ReadStatus::Closed;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            return ReadStatus::WouldBlock;
+        }
+        return ReadStatus::Error;
+    }
+
+    bool busy() const { return false; }
+    uint64_t syscalls() const { return calls; }
+
+private:
+    ssize_t receive_stamped(char *buffer, size_t capacity)
+    {
+        iovec iov{buffer, capacity};
+        RxTimestampControl control;
+        msghdr message{};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control.bytes;
+        message.msg_controllen = sizeof(control.bytes);
+        ssize_t result = ::recvmsg(fd, &message, MSG_DONTWAIT);
+        if (result > 0 && !read_rx_timestamp(message, last_rx))
+        {
+            last_rx = RxTimestamp{};
+        }
+        return result;
+    }
+};
+
+// Replays bytes from memory in chunks of at most max_chunk, so framing
+// across chunk boundaries gets exercised without any socket
+class MemoryTransport
+{
+private:
+    std::span<const char> bytes;
+    size_t max_chunk;
+    size_t offset = 0;
+
+public:
+    explicit MemoryTransport(std::span<const char> data, size_t chunk = 64 * 1024)
+        : bytes(data), max_chunk(std::max<size_t>(1, chunk))
+    {
+    }
+
+    ReadStatus receive(char *buffer, size_t capacity, size_t &received)
+    {
+        received = std::min({capacity, max_chunk, bytes.size() - offset});
+        if (received == 0)
+        {
+            return offset == bytes.size() ? ReadStatus::Closed : ReadStatus::WouldBlock;
+        }
+        std::memcpy(buffer, bytes.data() + offset, received);
+        offset += received;
+        return ReadStatus::Ok;
+    }
+
+    bool busy() const { return false; }
+    uint64_t syscalls() const { return 0; }
+};
+
+// Read-only mapping of a whole file, e.g. a raw feed capture taken with
+// `nc localhost 5555 > session.bin`, to replay through MemoryTransport
+class MappedFile
+{
+private:
+    void *base = MAP_FAILED;
+    size_t length = 0;
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        if (base != MAP_FAILED)
+        {
+            munmap(base, length);
+        }
+    }
+
+    // Prints the reason and returns false on failure
+    bool open(const char *path)
+    {
+        int fd = ::open(path, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+        {
+            std::perror(path);
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            return false;
+        }
+        length = static_cast<size_t>(st.st_size);
+        base = length ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (length && base == MAP_FAILED)
+        {
+            std::perror("mmap");
+            return false;
+        }
+        return true;
+    }
+
+    std::span<const char> bytes() const
+    {
+        return base == MAP_FAILED ? std::span<const char>{} : std::span<const char>(static_cast<const char *>(base), length);
+    }
+};
+
+#ifdef FEED_HAS_IO_URING
+
+// recv through a private io_uring, driven with raw syscalls (no liburing).
+// receive() submits one IORING_OP_RECV into the caller's buffer and
+// busy-polls the completion queue in user space for up to spin_limit
+// rounds. If nothing completes in that time it returns WouldBlock with
+// the recv left in flight (busy() is true), and a later receive() picks up
+// its completion without another submit. With sqpoll the kernel's
+// submission thread takes the submit syscall off the hot path as well.
+class IoUringTransport
+{
+private:
+    static constexpr uint64_t recv_tag = 1;
+    static constexpr uint64_t cancel_tag = 2;
+
+    int fd;
+    int ring_fd = -1;
+    unsigned spin_limit;
+    bool in_flight = false;
+    uint64_t calls = 0;
+
+    void *ring_memory = MAP_FAILED;
+    size_t ring_bytes = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqe_bytes = 0;
+
+    unsigned *sq_tail = nullptr;
+    unsigned *sq_mask = nullptr;
+    unsigned *sq_flags = nullptr;
+    unsigned *sq_array = nullptr;
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned *cq_mask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+    bool sqpoll = false;
+
+public:
+    // socket_fd stays owned by the caller. Check ok() before use: io_uring
+    // may be disabled by the kernel or a seccomp profile.
+    explicit IoUringTransport(int socket_fd, bool use_sqpoll = false, unsigned spin = 256)
+        : fd(socket_fd), spin_limit(spin), sqpoll(use_sqpoll)
+    {
+        io_uring_params params{};
+        if (use_sqpoll)
+        {
+            params.flags = IORING_SETUP_SQPOLL;
+            params.sq_thread_idle = 100; // ms before the kernel thread sleeps
+        }
+        ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, 8, &params));
+        if (ring_fd < 0)
+        {
+            std::perror("io_uring_setup");
+            return;
+        }
+        // One mapping for both rings (IORING_FEAT_SINGLE_MMAP, Linux 5.4+)
+        ring_bytes = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                              params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        ring_memory = mmap(nullptr, ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                           IORING_OFF_SQ_RING);
+        sqe_bytes = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqe_memory = mmap(nullptr, sqe_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                                IORING_OFF_SQES);
+        if (ring_memory == MAP_FAILED || sqe_memory == MAP_FAILED || !(params.features & IORING_FEAT_SINGLE_MMAP))
+        {
+            std::fprintf(stderr, "io_uring: cannot map rings\n");
+            if (sqe_memory != MAP_FAILED)
+            {
+                munmap(sqe_memory, sqe_bytes);
+            }
+            release();
+            return;
+        }
+        sqes = static_cast<io_uring_sqe *>(sqe_memory);
+        auto *ring = static_cast<char *>(ring_memory);
+        sq_tail = reinterpret_cast<unsigned *>(ring + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned *>(ring + params.sq_off.ring_mask);
+        sq_flags = reinterpret_cast<unsigned *>(ring + params.sq_off.flags);
+        sq_array = reinterpret_cast<unsigned *>(ring + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned *>(ring + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned *>(ring + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned *>(ring + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(ring + params.cq_off.cqes);
+    }
+
+    IoUringTransport(IoUringTransport &&other) noexcept
+        : fd(other.fd), ring_fd(std::exchange(other.ring_fd, -1)), spin_limit(other.spin_limit),
+          in_flight(std::exchange(other.in_flight, false)), calls(other.calls),
+          ring_memory(std::exchange(other.ring_memory, MAP_FAILED)), ring_bytes(other.ring_bytes),
+          sqes(std::exchange(other.sqes, static_cast<io_uring_sqe *>(MAP_FAILED))), sqe_bytes(other.sqe_bytes),
+          sq_tail(other.sq_tail), sq_mask(other.sq_mask), sq_flags(other.sq_flags), sq_array(other.sq_array),
+          cq_head(other.cq_head), cq_tail(other.cq_tail), cq_mask(other.cq_mask), cqes(other.cqes),
+          sqpoll(other.sqpoll)
+    {
+    }
+
+    IoUringTransport(const IoUringTransport &) = delete;
+    IoUringTransport &operator=(const IoUringTransport &) = delete;
+    IoUringTransport &operator=(IoUringTransport &&) = delete;
+
+    ~IoUringTransport()
+    {
+        if (in_flight)
+        {
+            // The recv targets a buffer about to be freed: cancel it and
+            // wait until the kernel has let go
+            io_uring_sqe *sqe = next_sqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = recv_tag;
+            sqe->user_data = cancel_tag;
+            submit();
+            while (in_flight)
+            {
+                int32_t result;
+                uint64_t tag;
+                if (!reap(result, tag))
+                {
+                    enter(0, 1, IORING_ENTER_GETEVENTS);
+                }
+                else if (tag == recv_tag)
+                {
+                    in_flight = false;
+                }
+            }
+        }
+        if (sqes != MAP_FAILED)
+        {
+            munmap(sqes, sqe_bytes);
+        }
+        release();
+    }
+
+    bool ok() const { return cqes != nullptr; }
+
+    ReadStatus receive(char *buffer, size_t capacity, size_t &received)
+    {
+        received = 0;
+        if (!in_flight)
+        {
+            io_uring_sqe *sqe = next_sqe();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(buffer);
+            sqe->len = static_cast<uint32_t>(std::min<size_t>(capacity, UINT32_MAX));
+            sqe->user_data = recv_tag;
+            submit();
+            in_flight = true;
+        }
+        for (unsigned spin = 0; spin < spin_limit; ++spin)
+        {
+            int32_t result;
+            uint64_t tag;
+            if (!reap(result, tag))
+            {
+                cpu_relax();
+                continue;
+            }
+            if (tag != recv_tag)
+            {
+                continue; // A stale cancel completion
+            }
+            in_flight = false;
+            if (result > 0)
+            {
+                received = static_cast<size_t>(result);
+                return ReadStatus::Ok;
+            }
+            if (result == 0)
+            {
+                return ReadStatus::Closed;
+            }
+            errno = -result;
+            return errno == EAGAIN || errno == EINTR ? ReadStatus::WouldBlock : ReadStatus::Error;
+        }
+        return ReadStatus::WouldBlock;
+    }
+
+    bool busy() const { return in_flight; }
+    uint64_t syscalls() const { return calls; }
+
+private:
+    void release()
+    {
+        if (ring_memory != MAP_FAILED)
+        {
+            munmap(ring_memory, ring_bytes);
+        }
+        if (ring_fd >= 0)
+        {
+            ::close(ring_fd);
+        }
+        cqes = nullptr;
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        ++calls;
+        return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    // Only one request is ever queued at a time, so the ring never fills
+    io_uring_sqe *next_sqe()
+    {
+        unsigned index = *sq_tail & *sq_mask;
+        io_uring_sqe *sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array[index] = index;
+        return sqe;
+    }
+
+    void submit()
+    {
+        std::atomic_ref<unsigned>(*sq_tail).store(*sq_tail + 1, std::memory_order_release);
+        if (!sqpoll)
+        {
+            enter(1, 0, 0);
+            return;
+        }
+        // The tail store must be visible before the flag is read, or a
+        // kernel thread going to sleep could miss the new entry
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (std::atomic_ref<unsigned>(*sq_flags).load(std::memory_order_relaxed) & IORING_SQ_NEED_WAKEUP)
+        {
+            enter(0, 0, IORING_ENTER_SQ_WAKEUP);
+        }
+    }
+
+    bool reap(int32_t &result, uint64_t &tag)
+    {
+        unsigned head = *cq_head;
+        if (head == std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        const io_uring_cqe &cqe = cqes[head & *cq_mask];
+        result = cqe.res;
+        tag = cqe.user_data;
+        std::atomic_ref<unsigned>(*cq_head).store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,185 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "../orderbook/price.cpp"
+
+// Binary feed schema. Every message starts with a MessageHeader, and every
+// field has a fixed offset, width and byte order, so the layout does not
+// depend on the compiler's padding rules (see L5/padding.cpp): each field
+// is a LittleEndian<T>, which is a plain byte array of alignment 1. A
+// packed message therefore sits at any offset of a receive buffer, and a
+// view of it is a pointer cast with no copy. static_asserts pin every
+// offset so the schema can't drift silently.
+
+// Unaligned little-endian scalar. Reading composes the bytes explicitly,
+// which compilers reduce to a single load on little-endian targets.
+template <typename T>
+class LittleEndian
+{
+    static_assert(std::is_integral_v<T>, "wire fields are integers; prices are fixed point");
+    using Bits = std::make_unsigned_t<T>;
+
+private:
+    unsigned char bytes[sizeof(T)];
+
+public:
+    LittleEndian() = default;
+    LittleEndian(T value) { set(value); }
+
+    T get() const
+    {
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            T value;
+            std::memcpy(&value, bytes, sizeof(T));
+            return value;
+        }
+        else
+        {
+            Bits value = 0;
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                value |= static_cast<Bits>(static_cast<Bits>(bytes[i]) << (8 * i));
+            }
+            return static_cast<T>(value);
+        }
+    }
+
+    void set(T value)
+    {
+        auto bits = static_cast<Bits>(value);
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            bytes[i] = static_cast<unsigned char>(bits >> (8 * i));
+        }
+    }
+
+    operator T() const { return get(); }
+    LittleEndian &operator=(T value)
+    {
+        set(value);
+        return *this;
+    }
+};
+
+inline constexpr uint8_t wire_version = 1;
+
+enum class MessageType : uint8_t
+{
+    Heartbeat = 0,
+    Trade = 1,
+    Quote = 2
+};
+
+// Common to every message; length covers the header itself
+struct MessageHeader
+{
+    LittleEndian<uint16_t> length;
+    MessageType type;
+    uint8_t version;
+    LittleEndian<uint32_t> sequence; // Per session, +1 per message
+};
+
+static_assert(sizeof(MessageHeader) == 8 && alignof(MessageHeader) == 1, "header must stay packed");
+static_assert(offsetof(MessageHeader, type) == 2 && offsetof(MessageHeader, sequence) == 4);
+
+struct HeartbeatMessage
+{
+    static constexpr MessageType message_type = MessageType::Heartbeat;
+
+    MessageHeader header;
+};
+
+// Trade or quote update; replaces the padded MarketData struct of
+// L1/mocks/MarketFeed.cpp. 32 bytes, so two fit a 64-byte cache line.
+struct MarketDataMessage
+{
+    static constexpr MessageType message_type = MessageType::Trade; // Or MessageType::Quote
+
+    MessageHeader header;
+    LittleEndian<uint64_t> timestamp_ns; // Exchange send time
+    LittleEndian<int64_t> price;         // Raw Price units (1 / Price::scale)
+    LittleEndian<uint32_t> volume;
+    LittleEndian<uint32_t> instrument;
+
+    Price price_value() const { return Price::from_raw(price); }
+};
+
+static_assert(sizeof(MarketDataMessage) == 32 && alignof(MarketDataMessage) == 1, "market data must stay packed");
+static_assert(offsetof(MarketDataMessage, timestamp_ns) == 8 && offsetof(MarketDataMessage, price) == 16 &&
+              offsetof(MarketDataMessage, volume) == 24 && offsetof(MarketDataMessage, instrument) == 28);
+
+// Messages whose bytes can be read in place from a receive buffer
+template <typename Message>
+concept WireMessage = std::is_trivially_copyable_v<Message> && std::is_standard_layout_v<Message> &&
+                      alignof(Message) == 1 && requires { Message::message_type; };
+
+// Whether type can be viewed as Message; MarketDataMessage covers both
+// trades and quotes
+template <WireMessage Message>
+constexpr bool accepts(MessageType type)
+{
+    if constexpr (std::is_same_v<Message, MarketDataMessage>)
+    {
+        return type == MessageType::Trade || type == MessageType::Quote;
+    }
+    else
+    {
+        return type == Message::message_type;
+    }
+}
+
+// Zero-copy view of the message at the front of bytes, or nullptr if it is
+// truncated, of another type or version, or its length disagrees with the
+// schema. The view is valid as long as bytes is.
+template <WireMessage Message>
+const Message *view_message(std::span<const char> bytes)
+{
+    if (bytes.size() < sizeof(Message))
+    {
+        return nullptr;
+    }
+    const auto *message = reinterpret_cast<const Message *>(bytes.data());
+    if (message->header.length != sizeof(Message) || message->header.version != wire_version ||
+        !accepts<Message>(message->header.type))
+    {
+        return nullptr;
+    }
+    return message;
+}
+
+// Fill in the header of a message being encoded in place
+template <WireMessage Message>
+void init_header(Message &message, uint32_t sequence, MessageType type = Message::message_type)
+{
+    message.header.length = static_cast<uint16_t>(sizeof(Message));
+    message.header.type = type;
+    message.header.version = wire_version;
+    message.header.sequence = sequence;
+}
+
+// Framing policy for FeedReader over a stream of wire messages: each
+// message is as long as its header says. A length shorter than the header
+// is a corrupt stream; it is framed as a header-sized message so the reader
+// keeps making progress and the decoder rejects it.
+struct WireFraming
+{
+    size_t frame(const char *data, size_t available) const
+    {
+        if (available < sizeof(MessageHeader))
+        {
+            return 0;
+        }
+        const auto *header = reinterpret_cast<const MessageHeader *>(data);
+        size_t length = std::max<size_t>(header->length, sizeof(MessageHeader));
+        return available >= length ? length : 0;
+    }
+
+    size_t max_message_size() const { return UINT16_MAX; }
+};
@@ -0,0 +1,109 @@
+// End-of-interval analytics over many books with WorkStealingPool.
+//
+// Builds one OrderBook per instrument from random flow, then computes per
+// book the depth-weighted mid over the top levels and the resting quantity
+// near the touch, first serially and then with parallel_for for a growing
+// number of workers. Books are deliberately uneven in depth so static
+// chunking would leave some workers idle. Results must match the serial
+// pass exactly.
+//
+//   analytics_bench [instruments] [max workers] [grain]
+//
+// Defaults: 4000 instruments, hardware threads - 1 workers, grain 16
+
+#include "work_stealing_pool.cpp"
+#include "../orderbook/orderbook.cpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct Metrics {
+    double weighted_mid = 0;
+    std::uint64_t near_quantity = 0;
+
+    bool operator==(Metrics const&) const = default;
+};
+
+// Depth-weighted mid over the top 5 levels a side, and quantity within the
+// top 20; repeated to stand in for a heavier analytic
+Metrics analyse(OrderBook const& book) {
+    thread_local std::vector<PriceLevel> bids, asks;
+    Metrics metrics;
+    for (int pass = 0; pass < 20; ++pass) {
+        book.get_snapshot(20, bids, asks);
+        double weighted = 0, quantity = 0;
+        std::uint64_t near = 0;
+        for (std::size_t i = 0; i < bids.size(); ++i) {
+            if (i < 5) {
+                weighted += bids[i].price.to_double() * static_cast<double>(bids[i].total_quantity);
+                quantity += static_cast<double>(bids[i].total_quantity);
+            }
+            near += bids[i].total_quantity;
+        }
+        for (std::size_t i = 0; i < asks.size(); ++i) {
+            if (i < 5) {
+                weighted += asks[i].price.to_double() * static_cast<double>(asks[i].total_quantity);
+                quantity += static_cast<double>(asks[i].total_quantity);
+            }
+            near += asks[i].total_quantity;
+        }
+        metrics = {quantity > 0 ? weighted / quantity : 0, near};
+    }
+    return metrics;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t instruments = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4000;
+    unsigned hw = std::max(2u, std::thread::hardware_concurrency());
+    unsigned max_workers = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : hw - 1;
+    std::size_t grain = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 16;
+
+    std::uint64_t seed = 1;
+    auto next = [&seed]() {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+
+    std::vector<std::unique_ptr<OrderBook>> books;
+    for (std::size_t i = 0; i < instruments; ++i) {
+        auto book = std::make_unique<OrderBook>();
+        std::uint64_t orders = 50 + next() % (i % 10 == 0 ? 5000 : 500);
+        for (std::uint64_t id = 1; id <= orders; ++id) {
+            bool is_buy = next() % 2 == 0;
+            Price offset = Price::from_raw(static_cast<std::int64_t>(next() % 100) * (Price::scale / 100));
+            book->add_order({id, is_buy, is_buy ? 100_px - offset : 100_px + 0.01_px + offset, 1 + next() % 100, id});
+        }
+        books.push_back(std::move(book));
+    }
+
+    using clock = std::chrono::steady_clock;
+    std::vector<Metrics> expected(instruments), results(instruments);
+    auto start = clock::now();
+    for (std::size_t i = 0; i < instruments; ++i) {
+        expected[i] = analyse(*books[i]);
+    }
+    double serial = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    std::printf("%zu instruments: serial %.1f ms\n", instruments, serial);
+
+    bool consistent = true;
+    for (unsigned workers = 0; workers <= max_workers; workers = workers ? workers * 2 : 1) {
+        WorkStealingPool pool(std::vector<int>(workers, -1));
+        start = clock::now();
+        pool.parallel_for(0, instruments, grain, [&](std::size_t i) { results[i] = analyse(*books[i]); });
+        double parallel = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        bool same = results == expected;
+        consistent = consistent && same;
+        std::printf("%2zu threads: %.1f ms (%.2fx)%s\n", pool.concurrency(), parallel, serial / parallel,
+                    same ? "" : "  MISMATCH");
+        std::fill(results.begin(), results.end(), Metrics{});
+    }
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "../SPSC_QUEUES/spsc_q3.cpp"
+
+/// Chase-Lev work-stealing deque, with the C11 orderings of Lê et al.
+/// (PPoPP 2013), over a fixed power-of-two ring.
+///
+/// The owning thread pushes and takes at the bottom, LIFO, so it keeps
+/// working on what it split most recently and is still in cache; other
+/// threads steal from the top, FIFO, taking the oldest and so usually the
+/// largest piece of work. Owner and thieves only contend over the last
+/// element. T must fit in a lock-free atomic, e.g. a packed index range.
+template<typename T>
+class ChaseLevDeque
+{
+    static_assert(std::atomic<T>::is_always_lock_free, "deque elements must be lock-free atomics");
+
+public:
+    /// capacity is rounded up to the next power of two
+    explicit ChaseLevDeque(std::size_t capacity)
+        : mask_{static_cast<std::int64_t>(std::bit_ceil(capacity)) - 1}
+        , ring_{std::make_unique<std::atomic<T>[]>(static_cast<std::size_t>(mask_ + 1))} {}
+
+    /// Owner only.
+    /// @return `true` if pushed; `false` if the deque is full.
+    bool push(T value) {
+        auto bottom = bottom_.load(std::memory_order_relaxed);
+        auto top = top_.load(std::memory_order_acquire);
+        if (bottom - top > mask_) {
+            return false;
+        }
+        ring_[bottom & mask_].store(value, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// Owner only; the most recently pushed element.
+    /// @return `true` if an element was taken; `false` if the deque is empty.
+    bool take(T& value) {
+        auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = top_.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        value = ring_[bottom & mask_].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last element: race thieves for it
+            bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /// Any thread; the oldest element.
+    /// @return `true` if an element was stolen; `false` if empty or lost a race.
+    bool steal(T& value) {
+        auto top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+        value = ring_[top & mask_].load(std::memory_order_relaxed);
+        return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    /// Approximate when other threads are active
+    bool empty() const noexcept {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::int64_t mask_;
+    std::unique_ptr<std::atomic<T>[]> ring_;
+
+    /// Advanced by thieves and, for the last element, the owner
+    alignas(cache_line_size) std::atomic<std::int64_t> top_{0};
+
+    /// Owner only; loaded by thieves
+    alignas(cache_line_size) std::atomic<std::int64_t> bottom_{0};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[cache_line_size - sizeof(std::int64_t)];
+};
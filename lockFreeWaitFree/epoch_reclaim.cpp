@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "../SPSC_QUEUES/spsc_q3.cpp"
+
+/// Epoch-based reclamation (Fraser) for lock-free structures whose nodes
+/// are T.
+///
+/// A thread announces the global epoch when it starts an operation and
+/// withdraws when done; inside, it may follow any pointer it finds. A
+/// removed node is retired with the epoch of its removal. The epoch can
+/// only advance once every thread inside an operation has seen the current
+/// one, so when it is two ahead of a node's retirement nobody can still be
+/// holding that node and it is reclaimed.
+///
+/// Compared with hazard pointers this costs one fence per operation rather
+/// than one per node visited, which matters for long traversals; the price
+/// is that a thread stalled inside an operation holds up reclamation for
+/// everyone. At most MaxThreads threads may hold a record at once.
+template<typename T, std::size_t MaxThreads = 64>
+class EpochReclaimer
+{
+public:
+    EpochReclaimer() = default;
+    EpochReclaimer(EpochReclaimer const&) = delete;
+    EpochReclaimer& operator=(EpochReclaimer const&) = delete;
+
+    /// Claim a free record for the calling thread; returns its index
+    std::size_t acquire() {
+        for (std::size_t i = 0; i < MaxThreads; ++i) {
+            bool expected = false;
+            if (not records_[i].active.load(std::memory_order_relaxed) &&
+                records_[i].active.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return i;
+            }
+        }
+        throw std::runtime_error("EpochReclaimer: more than MaxThreads threads attached");
+    }
+
+    /// Free the record; nodes it still holds are reclaimed by its next owner
+    void release(std::size_t thread) noexcept {
+        records_[thread].active.store(false, std::memory_order_release);
+    }
+
+    /// Start an operation: pointers read from now on stay valid until exit
+    void enter(std::size_t thread) noexcept {
+        // Re-check so the announcement is never older than the epoch in
+        // force once it is visible
+        auto epoch = epoch_.load(std::memory_order_relaxed);
+        while (true) {
+            records_[thread].epoch.store(epoch, std::memory_order_seq_cst);
+            auto now = epoch_.load(std::memory_order_seq_cst);
+            if (now == epoch) {
+                return;
+            }
+            epoch = now;
+        }
+    }
+
+    void exit(std::size_t thread) noexcept {
+        records_[thread].epoch.store(idle, std::memory_order_release);
+    }
+
+    /// Hand over an unlinked node; reclaim(node) runs once no operation
+    /// that could have seen it is still in progress
+    template<typename Reclaim>
+    void retire(std::size_t thread, T* node, Reclaim&& reclaim) {
+        auto& retired = records_[thread].retired;
+        // Not before the unlink, which the caller did with a seq_cst CAS
+        retired.push_back({node, epoch_.load(std::memory_order_seq_cst)});
+        if (retired.size() % scan_interval == 0) {
+            try_advance();
+            collect(thread, reclaim);
+        }
+    }
+
+private:
+    static constexpr std::uint64_t idle = ~std::uint64_t{0};
+
+    // Retirements between attempts to advance the epoch
+    static constexpr std::size_t scan_interval = 64;
+
+    struct Retired
+    {
+        T* node;
+        std::uint64_t epoch;
+    };
+
+    struct alignas(cache_line_size) Record
+    {
+        std::atomic<std::uint64_t> epoch{idle}; // Announced epoch, or idle
+        std::atomic<bool> active{false};
+        std::vector<Retired> retired; // Owner only, in epoch order
+    };
+
+    void try_advance() noexcept {
+        auto current = epoch_.load(std::memory_order_seq_cst);
+        for (auto& record : records_) {
+            auto seen = record.epoch.load(std::memory_order_seq_cst);
+            if (seen != idle && seen != current) {
+                return;
+            }
+        }
+        epoch_.compare_exchange_strong(current, current + 1, std::memory_order_acq_rel);
+    }
+
+    template<typename Reclaim>
+    void collect(std::size_t thread, Reclaim&& reclaim) {
+        auto& retired = records_[thread].retired;
+        auto safe = epoch_.load(std::memory_order_acquire);
+        std::size_t freed = 0;
+        while (freed < retired.size() && retired[freed].epoch + 2 <= safe) {
+            reclaim(retired[freed++].node);
+        }
+        retired.erase(retired.begin(), retired.begin() + static_cast<std::ptrdiff_t>(freed));
+    }
+
+    /// Advanced by whichever thread finds every active thread caught up
+    alignas(cache_line_size) std::atomic<std::uint64_t> epoch_{0};
+
+    Record records_[MaxThreads];
+};
@@ -0,0 +1,183 @@
+// Contention benchmark for LockFreeList against a mutex-protected list.
+//
+// For 1, 2, 4, ... up to the maximum thread count, every thread runs the
+// same mix of finds, inserts and removes over a shared key range, so the
+// list hovers around half full. Before timing, each list is checked with
+// threads inserting their own keys and removing every other one.
+//
+//   list_bench [ops per thread] [max threads] [key range] [find %]
+//
+// Defaults: 200000 ops, 32 threads, 1024 keys, 80% finds
+
+#include "lock_free_list.cpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// Sorted singly linked list behind one lock, with the same interface
+class MutexList {
+    struct Node {
+        std::uint64_t key;
+        std::uint64_t value;
+        Node* next;
+    };
+
+public:
+    struct Handle {
+        MutexList& list;
+        bool insert(std::uint64_t key, std::uint64_t value) { return list.insert(key, value); }
+        bool remove(std::uint64_t key) { return list.remove(key); }
+        bool contains(std::uint64_t key) { return list.contains(key); }
+    };
+
+    ~MutexList() {
+        while (head_) {
+            Node* next = head_->next;
+            delete head_;
+            head_ = next;
+        }
+    }
+
+    Handle attach() { return {*this}; }
+
+    bool insert(std::uint64_t key, std::uint64_t value) {
+        std::lock_guard lock{mutex_};
+        Node** link = &head_;
+        while (*link && (*link)->key < key) {
+            link = &(*link)->next;
+        }
+        if (*link && (*link)->key == key) {
+            return false;
+        }
+        *link = new Node{key, value, *link};
+        return true;
+    }
+
+    bool remove(std::uint64_t key) {
+        std::lock_guard lock{mutex_};
+        Node** link = &head_;
+        while (*link && (*link)->key < key) {
+            link = &(*link)->next;
+        }
+        if (not *link || (*link)->key != key) {
+            return false;
+        }
+        Node* victim = *link;
+        *link = victim->next;
+        delete victim;
+        return true;
+    }
+
+    bool contains(std::uint64_t key) {
+        std::lock_guard lock{mutex_};
+        Node* node = head_;
+        while (node && node->key < key) {
+            node = node->next;
+        }
+        return node && node->key == key;
+    }
+
+private:
+    std::mutex mutex_;
+    Node* head_ = nullptr;
+};
+
+// Thread t owns keys t, t + threads, ...; insert them all, remove the odd
+// multiples, then check from one thread what is left
+template<typename List>
+bool check(unsigned threads) {
+    List list;
+    constexpr std::uint64_t per_thread = 2000;
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            auto handle = list.attach();
+            for (std::uint64_t i = 0; i < per_thread; ++i) {
+                handle.insert(i * threads + t, t);
+            }
+            for (std::uint64_t i = 1; i < per_thread; i += 2) {
+                handle.remove(i * threads + t);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto handle = list.attach();
+    for (std::uint64_t key = 0; key < per_thread * threads; ++key) {
+        if (handle.contains(key) != ((key / threads) % 2 == 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hits are summed into here so finds cannot be optimised away
+std::atomic<std::uint64_t> found_total{0};
+
+template<typename List>
+double run(unsigned threads, std::uint64_t ops, std::uint64_t keys, unsigned find_pct) {
+    List list;
+    {
+        auto handle = list.attach();
+        for (std::uint64_t key = 0; key < keys; key += 2) {
+            handle.insert(key, key);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            auto handle = list.attach();
+            std::uint64_t seed = t + 1, found = 0;
+            for (std::uint64_t i = 0; i < ops; ++i) {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                std::uint64_t key = (seed >> 33) % keys;
+                unsigned action = static_cast<unsigned>((seed >> 20) % 100);
+                if (action < find_pct) {
+                    found += handle.contains(key);
+                } else if ((action - find_pct) % 2 == 0) {
+                    handle.insert(key, i);
+                } else {
+                    handle.remove(key);
+                }
+            }
+            found_total.fetch_add(found, std::memory_order_relaxed);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(ops * threads) / elapsed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::uint64_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    unsigned max_threads = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 32;
+    std::uint64_t keys = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1024;
+    unsigned find_pct = argc > 4 ? static_cast<unsigned>(std::atoi(argv[4])) : 80;
+
+    bool ok = check<LockFreeList<>>(4) && check<MutexList>(4);
+    std::printf("Consistency check %s\n", ok ? "passed" : "FAILED");
+
+    std::printf("%lu ops per thread over %lu keys, %u%% finds\n", static_cast<unsigned long>(ops),
+                static_cast<unsigned long>(keys), find_pct);
+    std::printf("%8s %16s %16s\n", "threads", "lock-free ops/s", "mutex ops/s");
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        double lock_free = run<LockFreeList<>>(threads, ops, keys, find_pct);
+        double locked = run<MutexList>(threads, ops, keys, find_pct);
+        std::printf("%8u %16.0f %16.0f\n", threads, lock_free, locked);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "epoch_reclaim.cpp"
+#include "../orderbook/memory_pool.cpp"
+
+/// Lock-free sorted map from uint64_t keys to uint64_t values, e.g. order
+/// id to owning session, grown from the CAS-on-head insert in
+/// linkedListInsertion.cpp.
+///
+/// Harris's list: remove first marks the victim's next pointer (logical
+/// delete), so no insert can link after it, then unlinks it; any traversal
+/// that meets a marked node helps unlink it. Every operation runs inside an
+/// epoch, and unlinked nodes are retired to the EpochReclaimer and freed
+/// once no operation that could have seen them is still running.
+///
+/// Nodes come from per-thread MemoryPools rather than new: each attached
+/// thread allocates from its own pool, and a node freed by another thread
+/// goes back through that pool's remote free list.
+///
+/// Each thread works through a Handle from attach(), which holds its epoch
+/// record; up to MaxThreads handles may exist at once.
+template<std::size_t MaxThreads = 64>
+class LockFreeList
+{
+    struct Node
+    {
+        std::uint64_t key;
+        std::uint64_t value;
+        std::atomic<std::uintptr_t> next; // Low bit set once logically deleted
+        std::size_t owner;                // Index of the pool it came from
+    };
+
+    using Epochs = EpochReclaimer<Node, MaxThreads>;
+
+public:
+    class Handle
+    {
+    public:
+        ~Handle() { list_.epochs_.release(thread_); }
+        Handle(Handle const&) = delete;
+        Handle& operator=(Handle const&) = delete;
+
+        /// Add key; false (and no change) if it is already present
+        bool insert(std::uint64_t key, std::uint64_t value) {
+            Operation operation{*this};
+            Node* node = new (list_.pools_[thread_].allocate()) Node{key, value, {0}, thread_};
+            Position at;
+            while (true) {
+                if (search(key, at)) {
+                    list_.pools_[thread_].deallocate(node);
+                    return false;
+                }
+                node->next.store(to_link(at.curr), std::memory_order_relaxed);
+                auto expected = to_link(at.curr);
+                if (at.prev->compare_exchange_strong(expected, to_link(node), std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+        }
+
+        /// Remove key; false if it was not present
+        bool remove(std::uint64_t key) {
+            Operation operation{*this};
+            Position at;
+            while (true) {
+                if (not search(key, at)) {
+                    return false;
+                }
+                auto next = to_link(at.next);
+                if (not at.curr->next.compare_exchange_strong(next, next | marked, std::memory_order_acq_rel,
+                                                             std::memory_order_relaxed)) {
+                    // Someone else marked or inserted after it; look again
+                    continue;
+                }
+                auto expected = to_link(at.curr);
+                if (at.prev->compare_exchange_strong(expected, next)) {
+                    retire(at.curr);
+                } else {
+                    // A traversal will unlink it; make sure one does
+                    search(key, at);
+                }
+                return true;
+            }
+        }
+
+        /// Look key up; false if it is not present
+        bool find(std::uint64_t key, std::uint64_t& value) {
+            Operation operation{*this};
+            Position at;
+            bool found = search(key, at);
+            if (found) {
+                value = at.curr->value;
+            }
+            return found;
+        }
+
+        bool contains(std::uint64_t key) {
+            std::uint64_t value;
+            return find(key, value);
+        }
+
+    private:
+        friend class LockFreeList;
+
+        explicit Handle(LockFreeList& list) : list_{list}, thread_{list.epochs_.acquire()} {}
+
+        // Keeps every node reached during one public call alive
+        struct Operation
+        {
+            Handle& handle;
+            explicit Operation(Handle& h) : handle{h} { handle.list_.epochs_.enter(handle.thread_); }
+            ~Operation() { handle.list_.epochs_.exit(handle.thread_); }
+        };
+
+        struct Position
+        {
+            std::atomic<std::uintptr_t>* prev; // Link that points at curr
+            Node* curr;                        // First node with key >= the one sought, or null
+            Node* next;
+        };
+
+        // Find the position for key, unlinking marked nodes on the way
+        bool search(std::uint64_t key, Position& at) {
+        again:
+            at.prev = &list_.head_;
+            at.curr = to_node(at.prev->load(std::memory_order_acquire));
+            while (true) {
+                if (not at.curr) {
+                    return false;
+                }
+                auto link = at.curr->next.load(std::memory_order_acquire);
+                at.next = to_node(link & ~marked);
+                if (link & marked) {
+                    // curr is logically deleted: unlink it before moving on
+                    auto expected = to_link(at.curr);
+                    if (not at.prev->compare_exchange_strong(expected, to_link(at.next))) {
+                        goto again;
+                    }
+                    retire(at.curr);
+                } else {
+                    if (at.curr->key >= key) {
+                        return at.curr->key == key;
+                    }
+                    at.prev = &at.curr->next;
+                }
+                at.curr = at.next;
+            }
+        }
+
+        void retire(Node* node) {
+            list_.epochs_.retire(thread_, node, [this](Node* n) { list_.free_node(thread_, n); });
+        }
+
+        LockFreeList& list_;
+        std::size_t thread_;
+    };
+
+    LockFreeList() = default;
+    LockFreeList(LockFreeList const&) = delete;
+    LockFreeList& operator=(LockFreeList const&) = delete;
+
+    /// Nodes still linked or retired are released with the pools; every
+    /// Handle must be gone by now
+    ~LockFreeList() = default;
+
+    /// Register the calling thread
+    Handle attach() { return Handle{*this}; }
+
+    /// Reserve pool space for n nodes for the thread holding handle
+    void reserve(Handle const& handle, std::size_t n) { pools_[handle.thread_].reserve(n); }
+
+private:
+    static constexpr std::uintptr_t marked = 1;
+
+    static std::uintptr_t to_link(Node* node) noexcept { return reinterpret_cast<std::uintptr_t>(node); }
+    static Node* to_node(std::uintptr_t link) noexcept { return reinterpret_cast<Node*>(link); }
+
+    // Called by the thread holding record thread once node is unreachable
+    void free_node(std::size_t thread, Node* node) {
+        if (node->owner == thread) {
+            pools_[thread].deallocate(node);
+        } else {
+            pools_[node->owner].deallocate_remote(node);
+        }
+    }
+
+    alignas(cache_line_size) std::atomic<std::uintptr_t> head_{0};
+    Epochs epochs_;
+    MemoryPool<Node, 1024> pools_[MaxThreads]; // Pool i is allocated from by the holder of record i
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "../SPSC_QUEUES/spsc_q3.cpp"
+
+/// Lock-free Treiber stack of slot indices, for free lists over a fixed
+/// array of slots.
+///
+/// Push and pop CAS the head as in LockFreeList::insert, but the head packs
+/// a 32-bit index with a 32-bit generation that every successful CAS bumps.
+/// A pop that read a head, was delayed while that slot was popped, reused
+/// and pushed back, then fails its CAS on the generation instead of
+/// installing a stale next (the ABA problem). Links live in a separate
+/// array of atomics, so a delayed pop reading a reused slot's link is a
+/// well-defined stale read rather than a race on the slot's contents.
+///
+/// A 64-bit CAS is used instead of a 128-bit pointer-and-tag one because it
+/// is lock-free everywhere without -mcx16. The generation would have to
+/// wrap (2^32 operations) while one pop is suspended to fool it.
+class IndexStack
+{
+public:
+    static constexpr std::uint32_t none = ~std::uint32_t{0};
+
+    /// Holds indices 0 .. capacity - 1; starts empty
+    explicit IndexStack(std::uint32_t capacity)
+        : next_{std::make_unique<std::atomic<std::uint32_t>[]>(capacity)} {}
+
+    /// Push indices first .. last - 1 so that first is popped first; not
+    /// thread safe, for setting up
+    void fill(std::uint32_t first, std::uint32_t last) {
+        for (std::uint32_t i = last; i-- > first;) {
+            push(i);
+        }
+    }
+
+    void push(std::uint32_t index) {
+        auto head = head_.load(std::memory_order_relaxed);
+        do {
+            next_[index].store(index_of(head), std::memory_order_relaxed);
+        } while (not head_.compare_exchange_weak(head, pack(index, generation_of(head) + 1),
+                                                 std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /// @return an index, or `none` if the stack is empty
+    std::uint32_t pop() {
+        auto head = head_.load(std::memory_order_acquire);
+        while (index_of(head) != none) {
+            auto next = next_[index_of(head)].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, pack(next, generation_of(head) + 1), std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+                return index_of(head);
+            }
+        }
+        return none;
+    }
+
+    bool empty() const noexcept { return index_of(head_.load(std::memory_order_relaxed)) == none; }
+
+private:
+    static std::uint64_t pack(std::uint32_t index, std::uint32_t generation) noexcept {
+        return std::uint64_t{generation} << 32 | index;
+    }
+    static std::uint32_t index_of(std::uint64_t head) noexcept { return static_cast<std::uint32_t>(head); }
+    static std::uint32_t generation_of(std::uint64_t head) noexcept { return static_cast<std::uint32_t>(head >> 32); }
+
+    /// Index on top (low half) and generation (high half)
+    alignas(cache_line_size) std::atomic<std::uint64_t> head_{pack(none, 0)};
+
+    std::unique_ptr<std::atomic<std::uint32_t>[]> next_;
+};
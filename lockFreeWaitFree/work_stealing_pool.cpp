@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "chase_lev_deque.cpp"
+#include "../orderbook/threading.cpp"
+
+/// Fork-join pool for data-parallel loops such as per-instrument analytics.
+///
+/// parallel_for(begin, end, grain, fn) calls fn(i) for every i in the
+/// range. Work is a range [begin, end) packed into one word: whoever holds
+/// a range larger than grain pushes its upper half onto its own Chase-Lev
+/// deque and keeps splitting the lower half, so idle workers can steal the
+/// big untouched halves from the top. The calling thread works too, on a
+/// deque of its own, and returns once every index has run.
+///
+/// Workers are pinned like BookManager's shards and sleep in
+/// std::atomic::wait between loops. Each worker's state is padded to cache
+/// lines so neighbouring workers' deques do not false-share. One loop runs
+/// at a time; fn must not call parallel_for itself.
+class WorkStealingPool
+{
+public:
+    /// One worker per entry of cores; -1 leaves that worker unpinned
+    explicit WorkStealingPool(std::vector<int> const& cores) {
+        for (std::size_t i = 0; i <= cores.size(); ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (std::size_t i = 0; i < cores.size(); ++i) {
+            workers_[i]->thread = std::thread([this, i, core = cores[i]] { run_worker(i, core); });
+        }
+    }
+
+    WorkStealingPool(WorkStealingPool const&) = delete;
+    WorkStealingPool& operator=(WorkStealingPool const&) = delete;
+
+    ~WorkStealingPool() {
+        stopping_.store(true, std::memory_order_relaxed);
+        generation_.fetch_add(2, std::memory_order_release);
+        generation_.notify_all();
+        for (auto& worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    /// Threads that run loop bodies, counting the caller
+    std::size_t concurrency() const noexcept { return workers_.size(); }
+
+    /// Call fn(i) for every i in [begin, end), in no particular order and
+    /// from any of the pool's threads; ranges of at most grain indices run
+    /// on one thread. end must fit in 32 bits.
+    template<typename Fn>
+    void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, Fn&& fn) {
+        if (begin >= end) {
+            return;
+        }
+        std::lock_guard lock{submit_};
+        auto invoke = [](void* context, std::uint32_t first, std::uint32_t last) {
+            auto& body = *static_cast<std::remove_reference_t<Fn>*>(context);
+            for (auto i = first; i < last; ++i) {
+                body(static_cast<std::size_t>(i));
+            }
+        };
+        job_ = {invoke, &fn, grain ? grain : 1};
+        remaining_.store(end - begin, std::memory_order_relaxed);
+
+        std::size_t caller = workers_.size() - 1;
+        workers_[caller]->deque.push(pack(static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end)));
+
+        // Odd generation: a job is open
+        generation_.fetch_add(1, std::memory_order_seq_cst);
+        generation_.notify_all();
+        participate(caller);
+
+        // Close the job, then wait out workers that have not noticed yet
+        generation_.fetch_add(1, std::memory_order_seq_cst);
+        for (unsigned spins = 0; busy_.load(std::memory_order_seq_cst) != 0; ++spins) {
+            backoff(spins);
+        }
+    }
+
+private:
+    using Range = std::uint64_t; // begin in the high half, end in the low
+
+    static Range pack(std::uint32_t begin, std::uint32_t end) noexcept { return Range{begin} << 32 | end; }
+    static std::uint32_t begin_of(Range range) noexcept { return static_cast<std::uint32_t>(range >> 32); }
+    static std::uint32_t end_of(Range range) noexcept { return static_cast<std::uint32_t>(range); }
+
+    struct Job
+    {
+        void (*invoke)(void* context, std::uint32_t begin, std::uint32_t end);
+        void* context;
+        std::size_t grain;
+    };
+
+    struct alignas(cache_line_size) Worker
+    {
+        ChaseLevDeque<Range> deque{256}; // Splitting in halves never nests deeper than 64
+        std::thread thread;
+    };
+
+    void run_worker(std::size_t self, int core) {
+        pin_current_thread(core);
+        std::uint64_t seen = 0;
+        while (true) {
+            generation_.wait(seen, std::memory_order_acquire);
+            seen = generation_.load(std::memory_order_acquire);
+            if (stopping_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            if (seen % 2 == 0) {
+                continue;
+            }
+            // Announce before re-checking, so parallel_for cannot return
+            // while we are still reading its job
+            busy_.fetch_add(1, std::memory_order_seq_cst);
+            if (generation_.load(std::memory_order_seq_cst) == seen) {
+                participate(self);
+            }
+            busy_.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    void participate(std::size_t self) {
+        auto& own = workers_[self]->deque;
+        std::size_t victim = self;
+        unsigned spins = 0;
+        Range range;
+        while (remaining_.load(std::memory_order_acquire) != 0) {
+            if (own.take(range)) {
+                execute(own, range);
+                continue;
+            }
+            // Round-robin over the others, starting after the last victim
+            bool stolen = false;
+            for (std::size_t n = 1; n < workers_.size() && not stolen; ++n) {
+                victim = (victim + 1) % workers_.size();
+                stolen = victim != self && workers_[victim]->deque.steal(range);
+            }
+            if (stolen) {
+                execute(own, range);
+                spins = 0;
+            } else {
+                backoff(spins);
+            }
+        }
+    }
+
+    // Spin while others finish their ranges, yielding now and then in case
+    // one of them was preempted holding work
+    static void backoff(unsigned& spins) {
+        if (++spins % 64 == 0) {
+            std::this_thread::yield();
+        } else {
+            cpu_relax();
+        }
+    }
+
+    void execute(ChaseLevDeque<Range>& own, Range range) {
+        auto begin = begin_of(range), end = end_of(range);
+        while (end - begin > job_.grain) {
+            auto middle = begin + (end - begin) / 2;
+            if (not own.push(pack(middle, end))) {
+                break;
+            }
+            end = middle;
+        }
+        job_.invoke(job_.context, begin, end);
+        remaining_.fetch_sub(end - begin, std::memory_order_acq_rel);
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_; // The last one is the caller's
+    std::mutex submit_;
+    Job job_{};
+
+    /// Bumped to odd when a loop opens and to even when it closes
+    alignas(cache_line_size) std::atomic<std::uint64_t> generation_{0};
+    std::atomic<bool> stopping_{false};
+
+    /// Indices not yet run in the open loop
+    alignas(cache_line_size) std::atomic<std::size_t> remaining_{0};
+
+    /// Workers that may be reading job_
+    alignas(cache_line_size) std::atomic<std::size_t> busy_{0};
+};
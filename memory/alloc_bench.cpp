@@ -0,0 +1,462 @@
+// Allocator comparison for fixed-size objects, the structured successor of
+// L1's ObjectCreation and L3's MemoryLeak one-offs.
+//
+// Allocators:
+//   new          ::operator new / ::operator delete
+//   pool         MemoryPool (deallocate_remote for frees on other threads)
+//   arena        Arena bump allocation; frees are no-ops and the single
+//                pattern rewinds after each batch
+//   pmr-mono     std::pmr::monotonic_buffer_resource, frees are no-ops
+//   pmr-pool     std::pmr::unsynchronized_pool_resource (owner thread only)
+//   pmr-sync     std::pmr::synchronized_pool_resource
+//   return-q     owner-thread free list refilled through a Fifo3 return
+//                ring, recycling across an SPSC pipeline
+//
+// Patterns:
+//   single       one thread allocates --batch objects, touches them and
+//                frees them newest first
+//   pc           producer allocates and ships to a consumer over Fifo3,
+//                which sends each object back for the producer to free
+//   cross        as pc, but the consumer frees the object itself
+//
+// Each allocator/pattern pair runs in a forked child, so peak RSS and page
+// faults belong to that run alone. ns/op is wall time per object over the
+// whole run (for pc and cross this includes the hand-off); alloc p99 is
+// the allocate call alone, sampled every 64th.
+//
+//   alloc_bench [--ops N] [--batch N] [--size 16|64|256]
+//               [--patterns single,pc,cross]
+//
+// Defaults: --ops 2000000 --batch 64 --size 64 --patterns single,pc,cross
+
+#include "arena.cpp"
+#include "../orderbook/latency_histogram.cpp"
+#include "../orderbook/memory_pool.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+
+template <size_t Size>
+struct alignas(16) Slot
+{
+    char bytes[Size];
+};
+
+struct Config
+{
+    uint64_t ops = 2000000;
+    size_t batch = 64;
+    size_t size = 64;
+    std::string patterns = "single,pc,cross";
+};
+
+// Every allocator: allocate(), deallocate() on the allocating thread,
+// deallocate_remote() from the other one when remote_free is set, and
+// end_batch() after each single-pattern batch
+template <size_t Size>
+struct NewDelete
+{
+    static constexpr const char *name = "new";
+    static constexpr bool remote_free = true;
+    explicit NewDelete(uint64_t) {}
+    void *allocate() { return ::operator new(Size); }
+    void deallocate(void *p) { ::operator delete(p); }
+    void deallocate_remote(void *p) { ::operator delete(p); }
+    void end_batch() {}
+};
+
+template <size_t Size>
+struct Pool
+{
+    static constexpr const char *name = "pool";
+    static constexpr bool remote_free = true;
+    MemoryPool<Slot<Size>> pool;
+    explicit Pool(uint64_t) {}
+    void *allocate() { return pool.allocate(); }
+    void deallocate(void *p) { pool.deallocate(static_cast<Slot<Size> *>(p)); }
+    void deallocate_remote(void *p) { pool.deallocate_remote(static_cast<Slot<Size> *>(p)); }
+    void end_batch() {}
+};
+
+template <size_t Size>
+struct Bump
+{
+    static constexpr const char *name = "arena";
+    static constexpr bool remote_free = true; // Frees touch nothing
+    Arena arena;
+    explicit Bump(uint64_t ops) : arena(ArenaConfig{(ops + 1) * Size, ArenaPages::Normal, -1, false}) {}
+    void *allocate()
+    {
+        void *p = arena.allocate(Size, alignof(Slot<Size>));
+        if (!p)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+    void deallocate(void *) {}
+    void deallocate_remote(void *) {}
+    void end_batch() { arena.reset(); }
+};
+
+template <size_t Size>
+struct PmrMonotonic
+{
+    static constexpr const char *name = "pmr-mono";
+    static constexpr bool remote_free = true; // Frees touch nothing
+    std::pmr::monotonic_buffer_resource resource;
+    explicit PmrMonotonic(uint64_t) {}
+    void *allocate() { return resource.allocate(Size, alignof(Slot<Size>)); }
+    void deallocate(void *) {}
+    void deallocate_remote(void *) {}
+    void end_batch() { resource.release(); }
+};
+
+template <size_t Size>
+struct PmrPool
+{
+    static constexpr const char *name = "pmr-pool";
+    static constexpr bool remote_free = false;
+    std::pmr::unsynchronized_pool_resource resource;
+    explicit PmrPool(uint64_t) {}
+    void *allocate() { return resource.allocate(Size, alignof(Slot<Size>)); }
+    void deallocate(void *p) { resource.deallocate(p, Size, alignof(Slot<Size>)); }
+    void deallocate_remote(void *) {}
+    void end_batch() {}
+};
+
+template <size_t Size>
+struct PmrSync
+{
+    static constexpr const char *name = "pmr-sync";
+    static constexpr bool remote_free = true;
+    std::pmr::synchronized_pool_resource resource;
+    explicit PmrSync(uint64_t) {}
+    void *allocate() { return resource.allocate(Size, alignof(Slot<Size>)); }
+    void deallocate(void *p) { resource.deallocate(p, Size, alignof(Slot<Size>)); }
+    void deallocate_remote(void *p) { resource.deallocate(p, Size, alignof(Slot<Size>)); }
+    void end_batch() {}
+};
+
+// The owner keeps a plain free list; other threads push frees onto an
+// SPSC ring that the owner drains when its list runs dry, so neither side
+// ever contends on a shared free list
+template <size_t Size>
+struct ReturnQueue
+{
+    static constexpr const char *name = "return-q";
+    static constexpr bool remote_free = true;
+    MemoryPool<Slot<Size>> pool; // Fresh slots
+    std::vector<void *> free_list;
+    Fifo3<void *> returns{1 << 12};
+    explicit ReturnQueue(uint64_t) { free_list.reserve(1 << 14); }
+    void *allocate()
+    {
+        if (free_list.empty())
+        {
+            void *p;
+            while (free_list.size() < free_list.capacity() && returns.pop(p))
+            {
+                free_list.push_back(p);
+            }
+            if (free_list.empty())
+            {
+                return pool.allocate();
+            }
+        }
+        void *p = free_list.back();
+        free_list.pop_back();
+        return p;
+    }
+    void deallocate(void *p)
+    {
+        if (free_list.size() < free_list.capacity())
+        {
+            free_list.push_back(p);
+        }
+        else
+        {
+            pool.deallocate(static_cast<Slot<Size> *>(p));
+        }
+    }
+    // A full ring falls back to the pool's own remote list, so the freeing
+    // thread never waits for the owner to drain
+    void deallocate_remote(void *p)
+    {
+        if (!returns.push(p))
+        {
+            pool.deallocate_remote(static_cast<Slot<Size> *>(p));
+        }
+    }
+    void end_batch() {}
+};
+
+struct Result
+{
+    double ns_per_op;
+    double alloc_p99_ns;
+    long peak_rss_kb;
+    long faults;
+    bool ran;
+};
+
+// Time one allocate call in 64
+template <typename Alloc>
+void *timed_allocate(Alloc &alloc, uint64_t i, LatencyHistogram &latency)
+{
+    if (i % 64)
+    {
+        return alloc.allocate();
+    }
+    uint64_t start = TscClock::now();
+    void *p = alloc.allocate();
+    latency.record(TscClock::now() - start);
+    return p;
+}
+
+template <typename Alloc>
+void run_single(Alloc &alloc, const Config &config, LatencyHistogram &latency)
+{
+    std::vector<void *> held(config.batch);
+    for (uint64_t done = 0; done < config.ops;)
+    {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(config.batch, config.ops - done));
+        for (size_t i = 0; i < count; ++i)
+        {
+            held[i] = timed_allocate(alloc, done + i, latency);
+            static_cast<volatile char *>(held[i])[0] = 1;
+        }
+        done += count;
+        for (size_t i = count; i-- > 0;)
+        {
+            alloc.deallocate(held[i]);
+        }
+        alloc.end_batch();
+    }
+}
+
+// Producer on this thread, consumer on another; owner_frees picks pc
+template <typename Alloc>
+void run_handoff(Alloc &alloc, const Config &config, LatencyHistogram &latency, bool owner_frees)
+{
+    Fifo3<void *> to_consumer(1 << 12);
+    Fifo3<void *> to_producer(1 << 12);
+    std::thread consumer([&] {
+        for (uint64_t seen = 0; seen < config.ops;)
+        {
+            void *p;
+            if (!to_consumer.pop(p))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            static_cast<volatile char *>(p)[0] = 2;
+            if (owner_frees)
+            {
+                while (!to_producer.push(p))
+                {
+                    std::this_thread::yield();
+                }
+            }
+            else
+            {
+                alloc.deallocate_remote(p);
+            }
+            ++seen;
+        }
+    });
+
+    uint64_t freed = 0;
+    auto drain = [&] {
+        void *p;
+        while (to_producer.pop(p))
+        {
+            alloc.deallocate(p);
+            ++freed;
+        }
+    };
+    for (uint64_t i = 0; i < config.ops; ++i)
+    {
+        void *p = timed_allocate(alloc, i, latency);
+        static_cast<volatile char *>(p)[0] = 1;
+        while (!to_consumer.push(p))
+        {
+            drain();
+            std::this_thread::yield();
+        }
+        if (owner_frees && (i & 63) == 0)
+        {
+            drain();
+        }
+    }
+    // The consumer may be waiting on a full return ring
+    while (owner_frees && freed < config.ops)
+    {
+        drain();
+        std::this_thread::yield();
+    }
+    consumer.join();
+}
+
+long fault_count()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt + usage.ru_majflt;
+}
+
+template <typename Alloc>
+Result measure(const Config &config, const std::string &pattern)
+{
+    if (pattern == "cross" && !Alloc::remote_free) // pc frees on the owner too
+    {
+        return {0, 0, 0, 0, false};
+    }
+    long faults_before = fault_count();
+    LatencyHistogram latency;
+    auto start = TscClock::now();
+    {
+        Alloc alloc(config.ops);
+        if (pattern == "single")
+        {
+            run_single(alloc, config, latency);
+        }
+        else
+        {
+            run_handoff(alloc, config, latency, pattern == "pc");
+        }
+    }
+    double ns = TscClock::to_ns(TscClock::now() - start);
+
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return {ns / static_cast<double>(config.ops), latency.percentile_ns(0.99), usage.ru_maxrss,
+            fault_count() - faults_before, true};
+}
+
+// Run in a child so RSS and faults start from the same baseline each time
+template <typename Alloc>
+void report(const Config &config, const std::string &pattern)
+{
+    int fds[2];
+    if (::pipe(fds) != 0)
+    {
+        std::perror("pipe");
+        std::exit(1);
+    }
+    pid_t child = ::fork();
+    if (child == 0)
+    {
+        ::close(fds[0]);
+        Result result = measure<Alloc>(config, pattern);
+        ssize_t written = ::write(fds[1], &result, sizeof(result));
+        ::_exit(written == sizeof(result) ? 0 : 1);
+    }
+    ::close(fds[1]);
+    Result result{};
+    bool received = ::read(fds[0], &result, sizeof(result)) == sizeof(result);
+    ::close(fds[0]);
+    int status = 0;
+    ::waitpid(child, &status, 0);
+
+    if (!received)
+    {
+        std::printf("%-7s %-9s failed\n", pattern.c_str(), Alloc::name);
+    }
+    else if (!result.ran)
+    {
+        std::printf("%-7s %-9s %9s\n", pattern.c_str(), Alloc::name, "n/a");
+    }
+    else
+    {
+        std::printf("%-7s %-9s %9.2f %11.0f %10.1f %9ld\n", pattern.c_str(), Alloc::name, result.ns_per_op,
+                    result.alloc_p99_ns, static_cast<double>(result.peak_rss_kb) / 1024.0, result.faults);
+    }
+    std::fflush(stdout);
+}
+
+template <size_t Size>
+void run_all(const Config &config)
+{
+    std::printf("%lu objects of %zu bytes, batch %zu\n", static_cast<unsigned long>(config.ops), Size, config.batch);
+    std::printf("%-7s %-9s %9s %11s %10s %9s\n", "pattern", "allocator", "ns/op", "alloc p99", "peak MiB", "faults");
+    size_t begin = 0;
+    while (begin <= config.patterns.size())
+    {
+        size_t end = config.patterns.find(',', begin);
+        end = end == std::string::npos ? config.patterns.size() : end;
+        std::string pattern = config.patterns.substr(begin, end - begin);
+        begin = end + 1;
+        if (pattern != "single" && pattern != "pc" && pattern != "cross")
+        {
+            std::fprintf(stderr, "unknown pattern %s\n", pattern.c_str());
+            continue;
+        }
+        report<NewDelete<Size>>(config, pattern);
+        report<Pool<Size>>(config, pattern);
+        report<Bump<Size>>(config, pattern);
+        report<PmrMonotonic<Size>>(config, pattern);
+        report<PmrPool<Size>>(config, pattern);
+        report<PmrSync<Size>>(config, pattern);
+        report<ReturnQueue<Size>>(config, pattern);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Config config;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--ops")
+            config.ops = std::strtoull(value, nullptr, 10);
+        else if (flag == "--batch")
+            config.batch = std::strtoull(value, nullptr, 10);
+        else if (flag == "--size")
+            config.size = std::strtoull(value, nullptr, 10);
+        else if (flag == "--patterns")
+            config.patterns = value;
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (config.ops == 0 || config.batch == 0)
+    {
+        std::fprintf(stderr, "--ops and --batch must be positive\n");
+        return 1;
+    }
+    TscClock::ns_per_tick(); // Calibrate once, before forking
+
+    switch (config.size)
+    {
+    case 16:
+        run_all<16>(config);
+        break;
+    case 64:
+        run_all<64>(config);
+        break;
+    case 256:
+        run_all<256>(config);
+        break;
+    default:
+        std::fprintf(stderr, "--size must be 16, 64 or 256\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "unique_ptr.cpp"
+
+// Intrusive reference counting for objects shared between components,
+// the lightweight counterpart of the L10 shared_ptr examples. The count
+// lives in the object (derive from RefCounted), so there is no control
+// block, and the object itself can come from a MemoryPool or an Arena:
+// the deleter policy from unique_ptr.cpp decides where it goes when the
+// last RefPtr drops it.
+//
+// The count policy decides what a copy costs. LocalRefCount is a plain
+// integer for objects confined to one thread, so copying a handle compiles
+// to an ordinary increment with no locked instruction. AtomicRefCount is
+// for objects handed across threads and, like std::shared_ptr, pays a
+// locked increment and decrement per copy.
+
+// Count for objects only ever touched by one thread
+class LocalRefCount
+{
+private:
+    uint32_t value = 0;
+
+public:
+    void increment() { ++value; }
+    bool decrement() { return --value == 0; } // True when the last reference went
+    uint32_t load() const { return value; }
+};
+
+// Count for objects whose handles are copied and dropped on several threads
+class AtomicRefCount
+{
+private:
+    std::atomic<uint32_t> value{0};
+
+public:
+    void increment() { value.fetch_add(1, std::memory_order_relaxed); }
+
+    // The releasing decrement publishes this thread's writes to whichever
+    // thread destroys the object
+    bool decrement() { return value.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+    uint32_t load() const { return value.load(std::memory_order_relaxed); }
+};
+
+template <typename T>
+class RefPtr;
+
+// Base of a ref-counted Derived. Deleter receives the Derived * when the
+// count reaches zero; a stateless one takes no space, and a PoolDelete is
+// set by make_pooled_ref.
+template <typename Derived, typename Deleter = DefaultDelete<Derived>, typename Count = LocalRefCount>
+class RefCounted
+{
+private:
+    mutable Count refs;
+    [[no_unique_address]] Deleter deleter;
+
+    template <typename T>
+    friend class RefPtr;
+
+    template <typename T, typename Pool, typename... Args>
+    friend RefPtr<T> make_pooled_ref(Pool &pool, Args &&...args);
+
+    void add_ref() const { refs.increment(); }
+
+    void release_ref() const
+    {
+        if (refs.decrement())
+        {
+            // const handles share immutable data; the last one still owns it
+            Deleter release = deleter;
+            release(static_cast<Derived *>(const_cast<RefCounted *>(this)));
+        }
+    }
+
+protected:
+    RefCounted() = default;
+    ~RefCounted() = default;
+
+    // A copy is a new object with no references yet
+    RefCounted(const RefCounted &) : refs(), deleter() {}
+    RefCounted &operator=(const RefCounted &) { return *this; }
+
+public:
+    uint32_t use_count() const { return refs.load(); }
+};
+
+// Handle to a RefCounted object, T possibly const. Adopting a raw pointer
+// adds a reference, so a pointer taken from get() can be wrapped again.
+template <typename T>
+class RefPtr
+{
+private:
+    T *ptr = nullptr;
+
+public:
+    RefPtr() = default;
+
+    explicit RefPtr(T *p) : ptr(p)
+    {
+        if (ptr)
+        {
+            ptr->add_ref();
+        }
+    }
+
+    ~RefPtr()
+    {
+        if (ptr)
+        {
+            ptr->release_ref();
+        }
+    }
+
+    RefPtr(const RefPtr &other) : RefPtr(other.ptr) {}
+    RefPtr(RefPtr &&other) noexcept : ptr(std::exchange(other.ptr, nullptr)) {}
+
+    // From RefPtr<Derived> or RefPtr<non-const T>
+    template <typename U>
+    RefPtr(const RefPtr<U> &other) : RefPtr(other.get()) {}
+
+    RefPtr &operator=(const RefPtr &other)
+    {
+        RefPtr(other).swap(*this);
+        return *this;
+    }
+
+    RefPtr &operator=(RefPtr &&other) noexcept
+    {
+        RefPtr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void swap(RefPtr &other) noexcept { std::swap(ptr, other.ptr); }
+
+    T &operator*() const { return *ptr; }
+    T *operator->() const { return ptr; }
+    T *get() const { return ptr; }
+    explicit operator bool() const { return ptr != nullptr; }
+
+    void reset() { RefPtr().swap(*this); }
+};
+
+// New T on the heap; T's Deleter must be DefaultDelete
+template <typename T, typename... Args>
+RefPtr<T> make_ref(Args &&...args)
+{
+    return RefPtr<T>(new T(std::forward<Args>(args)...));
+}
+
+// New T in a slot of pool, returned there with the last reference; T's
+// Deleter must be PoolDelete<Pool>. Nothrow construction as for make_pooled.
+template <typename T, typename Pool, typename... Args>
+RefPtr<T> make_pooled_ref(Pool &pool, Args &&...args)
+{
+    static_assert(std::is_nothrow_constructible_v<T, Args...>, "pooled objects must construct without throwing");
+    T *object = new (pool.allocate()) T(std::forward<Args>(args)...);
+    object->deleter = PoolDelete<Pool>(pool);
+    return RefPtr<T>(object);
+}
+
+// New T in arena, destroyed in place with the last reference and its
+// memory left to the arena; T's Deleter must be ArenaDelete. Empty if the
+// arena is exhausted.
+template <typename T, typename... Args>
+RefPtr<T> make_arena_ref(Arena &arena, Args &&...args)
+{
+    return RefPtr<T>(arena.create<T>(std::forward<Args>(args)...));
+}
+
+static_assert(sizeof(RefPtr<int>) == sizeof(int *));
+
+#ifdef REF_PTR_MAIN
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "../orderbook/memory_pool.cpp"
+
+// Immutable per-instrument reference data, shared by the components of one
+// book thread (feed handler, book, risk checks)
+struct InstrumentInfo : RefCounted<InstrumentInfo, PoolDelete<MemoryPool<InstrumentInfo, 64>>>
+{
+    uint32_t instrument;
+    int64_t tick_size;
+    uint64_t lot_size;
+    char symbol[16];
+
+    InstrumentInfo(uint32_t id, int64_t tick, uint64_t lot) noexcept : instrument(id), tick_size(tick), lot_size(lot)
+    {
+        std::snprintf(symbol, sizeof(symbol), "INST%u", id);
+    }
+};
+
+// Snapshot buffer shared with a publisher on another thread
+struct SnapshotBuffer : RefCounted<SnapshotBuffer, DefaultDelete<SnapshotBuffer>, AtomicRefCount>
+{
+    std::vector<std::byte> bytes;
+};
+
+struct Component
+{
+    RefPtr<const InstrumentInfo> info;
+};
+
+// Copy handles the way components hand reference data around, and compare
+// an intrusive local count with an atomic one and with std::shared_ptr
+int main()
+{
+    MemoryPool<InstrumentInfo, 64> pool;
+    pool.reserve(64);
+    const uint64_t rounds = 20000000;
+    uint64_t checksum = 0;
+
+    RefPtr<InstrumentInfo> info = make_pooled_ref<InstrumentInfo>(pool, 7u, 25, 100);
+    {
+        std::vector<Component> components(3, Component{info});
+        std::printf("%s shared by %u handles\n", components[0].info->symbol, info->use_count());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < rounds; ++i)
+    {
+        Component copy{info};
+        checksum += copy.info->lot_size;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("RefPtr, local count:  %.2f ns per copy and drop\n", ns / static_cast<double>(rounds));
+
+    RefPtr<SnapshotBuffer> buffer = make_ref<SnapshotBuffer>();
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < rounds; ++i)
+    {
+        RefPtr<SnapshotBuffer> copy = buffer;
+        checksum += copy->use_count();
+    }
+    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("RefPtr, atomic count: %.2f ns per copy and drop\n", ns / static_cast<double>(rounds));
+
+    auto shared = std::make_shared<const uint64_t>(100);
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < rounds; ++i)
+    {
+        std::shared_ptr<const uint64_t> copy = shared;
+        checksum += *copy;
+    }
+    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("std::shared_ptr:      %.2f ns per copy and drop\n", ns / static_cast<double>(rounds));
+
+    const InstrumentInfo *slot = info.get();
+    info.reset();
+    RefPtr<InstrumentInfo> next = make_pooled_ref<InstrumentInfo>(pool, 8u, 25, 100);
+    std::printf("last reference returned the slot to the pool: %s\n", next.get() == slot ? "yes" : "no");
+    return checksum == 0;
+}
+#endif
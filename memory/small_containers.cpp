@@ -0,0 +1,513 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "../orderbook/memory_pool.cpp"
+
+// Containers for per-order metadata on the hot path, the correct versions
+// of what the L6 move-semantics examples and L10's Vector<T> sketch:
+//
+//   InlineVector<T, N>  up to N elements stored in the object itself
+//   SmallString         up to 23 characters inline, in a 24-byte object
+//   PoolVector<T>       unbounded, in fixed chunks from a shared MemoryPool
+//
+// None of them touches the heap in steady state, moves are noexcept (so
+// std::vector and friends move rather than copy them), and copies are
+// deep and exception-safe.
+
+// Fixed-capacity vector with inline storage. A full vector rejects new
+// elements (push_back returns false, emplace_back nullptr) rather than
+// growing, as Fifo3 does when full.
+template <typename T, size_t N>
+class InlineVector
+{
+private:
+    static constexpr bool nothrow_move = std::is_nothrow_move_constructible_v<T>;
+
+    alignas(T) std::byte storage[N * sizeof(T)];
+    size_t count = 0;
+
+    T *slot(size_t i) { return std::launder(reinterpret_cast<T *>(storage) + i); }
+    const T *slot(size_t i) const { return std::launder(reinterpret_cast<const T *>(storage) + i); }
+
+public:
+    InlineVector() = default;
+
+    InlineVector(const InlineVector &other)
+    {
+        for (const T &item : other)
+        {
+            emplace_back(item); // On a throw the destructor unwinds what was copied
+        }
+    }
+
+    InlineVector(InlineVector &&other) noexcept(nothrow_move)
+    {
+        for (T &item : other)
+        {
+            emplace_back(std::move(item));
+        }
+        other.clear();
+    }
+
+    InlineVector &operator=(const InlineVector &other)
+    {
+        if (this != &other)
+        {
+            InlineVector copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    InlineVector &operator=(InlineVector &&other) noexcept(nothrow_move)
+    {
+        if (this != &other)
+        {
+            clear();
+            for (T &item : other)
+            {
+                emplace_back(std::move(item));
+            }
+            other.clear();
+        }
+        return *this;
+    }
+
+    ~InlineVector() { clear(); }
+
+    template <typename... Args>
+    T *emplace_back(Args &&...args)
+    {
+        if (count == N)
+        {
+            return nullptr;
+        }
+        T *item = new (slot(count)) T(std::forward<Args>(args)...);
+        ++count;
+        return item;
+    }
+
+    bool push_back(const T &item) { return emplace_back(item) != nullptr; }
+    bool push_back(T &&item) { return emplace_back(std::move(item)) != nullptr; }
+
+    void pop_back() { slot(--count)->~T(); }
+
+    void clear()
+    {
+        while (count)
+        {
+            pop_back();
+        }
+    }
+
+    T &operator[](size_t i) { return *slot(i); }
+    const T &operator[](size_t i) const { return *slot(i); }
+
+    T *begin() { return slot(0); }
+    T *end() { return slot(count); }
+    const T *begin() const { return slot(0); }
+    const T *end() const { return slot(count); }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == N; }
+    static constexpr size_t capacity() { return N; }
+};
+
+// String of chars, stored inline up to 23 characters and on the heap
+// beyond (an id that long is rare enough to pay for it).
+//
+// Inline, the characters start at byte 0 and the last byte holds
+// 23 - size, so a 23-character string's last byte doubles as its
+// terminator. Spilled, the bytes hold a pointer, the size and the capacity
+// with the top byte set to 0xFF, which no inline string has there.
+class SmallString
+{
+public:
+    static constexpr size_t inline_capacity = 23;
+
+private:
+    static_assert(std::endian::native == std::endian::little, "the heap marker sits in the capacity's top byte");
+    static constexpr uint8_t heap_marker = 0xFF;
+    static constexpr size_t capacity_marker = size_t{heap_marker} << 56;
+
+    struct Heap
+    {
+        char *data;
+        size_t size;
+        size_t capacity; // Top byte is heap_marker
+    };
+
+    alignas(Heap) char bytes[sizeof(Heap)];
+
+    bool on_heap() const { return static_cast<uint8_t>(bytes[inline_capacity]) == heap_marker; }
+
+    Heap heap() const
+    {
+        Heap h;
+        std::memcpy(&h, bytes, sizeof(h));
+        return h;
+    }
+
+    void set_inline(const char *data, size_t size)
+    {
+        std::memcpy(bytes, data, size);
+        bytes[size] = '\0';
+        bytes[inline_capacity] = static_cast<char>(inline_capacity - size);
+    }
+
+    HFT_COLD void set_heap(const char *data, size_t size)
+    {
+        Heap h{new char[size + 1], size, size | capacity_marker};
+        std::memcpy(h.data, data, size);
+        h.data[size] = '\0';
+        std::memcpy(bytes, &h, sizeof(h));
+    }
+
+    void assign(std::string_view text)
+    {
+        if (text.size() <= inline_capacity) HFT_LIKELY
+        {
+            set_inline(text.data(), text.size());
+        }
+        else
+        {
+            set_heap(text.data(), text.size());
+        }
+    }
+
+    void release()
+    {
+        if (on_heap())
+        {
+            delete[] heap().data;
+        }
+    }
+
+public:
+    SmallString() { set_inline("", 0); }
+    SmallString(std::string_view text) { assign(text); }
+    SmallString(const char *text) : SmallString(std::string_view(text)) {}
+
+    SmallString(const SmallString &other) { assign(other.view()); }
+
+    // Steals a spilled buffer; otherwise copies the 24 bytes
+    SmallString(SmallString &&other) noexcept
+    {
+        std::memcpy(bytes, other.bytes, sizeof(bytes));
+        other.set_inline("", 0);
+    }
+
+    SmallString &operator=(const SmallString &other)
+    {
+        if (this != &other)
+        {
+            SmallString copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    SmallString &operator=(SmallString &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            std::memcpy(bytes, other.bytes, sizeof(bytes));
+            other.set_inline("", 0);
+        }
+        return *this;
+    }
+
+    ~SmallString() { release(); }
+
+    size_t size() const
+    {
+        return on_heap() ? heap().size : inline_capacity - static_cast<uint8_t>(bytes[inline_capacity]);
+    }
+
+    bool empty() const { return size() == 0; }
+    bool is_inline() const { return !on_heap(); }
+    const char *data() const { return on_heap() ? heap().data : bytes; }
+    const char *c_str() const { return data(); }
+    std::string_view view() const { return {data(), size()}; }
+    operator std::string_view() const { return view(); }
+
+    friend bool operator==(const SmallString &a, const SmallString &b) { return a.view() == b.view(); }
+    friend bool operator==(const SmallString &a, std::string_view b) { return a.view() == b; }
+};
+
+static_assert(sizeof(SmallString) == 24 && std::is_nothrow_move_constructible_v<SmallString>);
+
+// Growable vector whose storage is chunks of ChunkSize elements taken from
+// a MemoryPool shared by many vectors (one per order, say). Growing never
+// moves elements, so pointers to them stay valid; emptied chunks go back
+// to the pool. Indexing walks the chunk list, so it suits short lists
+// walked front to back rather than large random-access arrays.
+template <typename T, size_t ChunkSize = 8>
+class PoolVector
+{
+public:
+    struct Chunk
+    {
+        Chunk *prev;
+        Chunk *next;
+        alignas(T) std::byte items[ChunkSize * sizeof(T)];
+
+        T *at(size_t i) { return std::launder(reinterpret_cast<T *>(items) + i); }
+    };
+
+    using Pool = MemoryPool<Chunk, 256>;
+
+private:
+    Pool *pool;
+    Chunk *head = nullptr;
+    Chunk *tail = nullptr;
+    size_t count = 0;
+
+    size_t tail_size() const { return count ? (count - 1) % ChunkSize + 1 : 0; }
+
+public:
+    template <bool Const>
+    class Iterator
+    {
+    private:
+        using Item = std::conditional_t<Const, const T, T>;
+        Chunk *chunk;
+        size_t index;
+
+    public:
+        Iterator(Chunk *c, size_t i) : chunk(c), index(i) {}
+
+        Item &operator*() const { return *chunk->at(index); }
+        Item *operator->() const { return chunk->at(index); }
+
+        Iterator &operator++()
+        {
+            if (++index == ChunkSize && chunk->next)
+            {
+                chunk = chunk->next;
+                index = 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const { return chunk == other.chunk && index == other.index; }
+    };
+
+    explicit PoolVector(Pool &chunk_pool) : pool(&chunk_pool) {}
+
+    // Copies share the source's pool
+    PoolVector(const PoolVector &other) : pool(other.pool)
+    {
+        for (const T &item : other)
+        {
+            emplace_back(item);
+        }
+    }
+
+    PoolVector(PoolVector &&other) noexcept
+        : pool(other.pool), head(std::exchange(other.head, nullptr)), tail(std::exchange(other.tail, nullptr)),
+          count(std::exchange(other.count, 0))
+    {
+    }
+
+    PoolVector &operator=(const PoolVector &other)
+    {
+        if (this != &other)
+        {
+            PoolVector copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    // Takes over other's chunks, and with them other's pool
+    PoolVector &operator=(PoolVector &&other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            pool = other.pool;
+            head = std::exchange(other.head, nullptr);
+            tail = std::exchange(other.tail, nullptr);
+            count = std::exchange(other.count, 0);
+        }
+        return *this;
+    }
+
+    ~PoolVector() { clear(); }
+
+    template <typename... Args>
+    T &emplace_back(Args &&...args)
+    {
+        if (tail_size() == ChunkSize || !tail)
+        {
+            Chunk *chunk = pool->allocate();
+            chunk->prev = tail;
+            chunk->next = nullptr;
+            (tail ? tail->next : head) = chunk;
+            tail = chunk;
+        }
+        size_t index = count ? tail_size() % ChunkSize : 0;
+        T *item = new (tail->at(index)) T(std::forward<Args>(args)...);
+        ++count;
+        return *item;
+    }
+
+    void push_back(const T &item) { emplace_back(item); }
+    void push_back(T &&item) { emplace_back(std::move(item)); }
+
+    void pop_back()
+    {
+        size_t index = tail_size() - 1;
+        tail->at(index)->~T();
+        --count;
+        if (index == 0)
+        {
+            Chunk *emptied = tail;
+            tail = emptied->prev;
+            (tail ? tail->next : head) = nullptr;
+            pool->deallocate(emptied);
+        }
+    }
+
+    void clear()
+    {
+        while (count)
+        {
+            pop_back();
+        }
+    }
+
+    T &operator[](size_t i)
+    {
+        Chunk *chunk = head;
+        for (; i >= ChunkSize; i -= ChunkSize)
+        {
+            chunk = chunk->next;
+        }
+        return *chunk->at(i);
+    }
+
+    const T &operator[](size_t i) const { return const_cast<PoolVector &>(*this)[i]; }
+
+    T &back() { return *tail->at(tail_size() - 1); }
+
+    Iterator<false> begin() { return {head, 0}; }
+    Iterator<false> end() { return {tail, tail_size()}; }
+    Iterator<true> begin() const { return {head, 0}; }
+    Iterator<true> end() const { return {tail, tail_size()}; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+};
+
+#ifdef SMALL_CONTAINERS_MAIN
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Per-order metadata built from all three: a client order id, a few
+// inline tags and an unbounded fill history
+struct OrderMetadata
+{
+    SmallString client_order_id;
+    InlineVector<uint32_t, 4> tags;
+    PoolVector<uint64_t> fills;
+
+    explicit OrderMetadata(PoolVector<uint64_t>::Pool &pool) : fills(pool) {}
+};
+
+static_assert(std::is_nothrow_move_constructible_v<OrderMetadata>);
+
+// Check that copies are deep and moves steal, then time building and
+// dropping metadata against std::string / std::vector equivalents
+int main()
+{
+    PoolVector<uint64_t>::Pool pool;
+    pool.reserve(1024);
+
+    bool ok = true;
+    {
+        SmallString short_id("CLIENT-0000000000000001"); // 23 chars, inline
+        SmallString long_id("CLIENT-ORDER-ID-THAT-SPILLS-TO-THE-HEAP");
+        SmallString copy = long_id;
+        SmallString moved = std::move(long_id);
+        ok = ok && short_id.is_inline() && short_id.size() == 23 && !copy.is_inline() && copy == moved &&
+             copy.data() != moved.data() && long_id.empty();
+
+        InlineVector<std::string, 4> names;
+        for (const char *name : {"a", "b", "c", "d", "e"})
+        {
+            names.push_back(name);
+        }
+        InlineVector<std::string, 4> names_copy = names;
+        InlineVector<std::string, 4> names_moved = std::move(names);
+        ok = ok && names_copy.size() == 4 && names_moved[3] == "d" && names.empty();
+
+        PoolVector<uint64_t> fills(pool);
+        for (uint64_t i = 0; i < 100; ++i)
+        {
+            fills.push_back(i);
+        }
+        PoolVector<uint64_t> fills_copy = fills;
+        uint64_t sum = 0;
+        for (uint64_t fill : fills_copy)
+        {
+            sum += fill;
+        }
+        while (fills.size() > 3)
+        {
+            fills.pop_back();
+        }
+        ok = ok && sum == 4950 && fills.size() == 3 && fills[2] == 2 && fills_copy[99] == 99;
+    }
+    std::printf("copy/move semantics: %s\n", ok ? "ok" : "BROKEN");
+
+    const uint64_t rounds = 2000000;
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < rounds; ++i)
+    {
+        OrderMetadata meta(pool);
+        meta.client_order_id = "CL-ORD-ID-00012345";
+        meta.tags.push_back(static_cast<uint32_t>(i));
+        meta.fills.push_back(i);
+        meta.fills.push_back(i + 1);
+        OrderMetadata moved = std::move(meta);
+        checksum += moved.fills.size() + moved.client_order_id.size();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("inline/pool metadata: %.1f ns per build, move and drop\n", ns / static_cast<double>(rounds));
+
+    struct HeapMetadata
+    {
+        std::string client_order_id;
+        std::vector<uint32_t> tags;
+        std::vector<uint64_t> fills;
+    };
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < rounds; ++i)
+    {
+        HeapMetadata meta;
+        meta.client_order_id = "CL-ORD-ID-00012345";
+        meta.tags.push_back(static_cast<uint32_t>(i));
+        meta.fills.push_back(i);
+        meta.fills.push_back(i + 1);
+        HeapMetadata moved = std::move(meta);
+        checksum += moved.fills.size() + moved.client_order_id.size();
+    }
+    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("std::string/vector:   %.1f ns per build, move and drop\n", ns / static_cast<double>(rounds));
+    return !ok || checksum == 0;
+}
+#endif
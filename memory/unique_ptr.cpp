@@ -0,0 +1,247 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "arena.cpp"
+
+// Owning pointer with the deleter fixed at compile time, grown out of the
+// L8 unqiePtr example so it can own objects that did not come from new:
+// MemoryPool and ConcurrentMemoryPool slots, Arena allocations and
+// objects placed in a shared-memory segment.
+//
+// A stateless deleter (DefaultDelete, StaticPoolDelete, ArenaDelete) is
+// held as an empty base, so the pointer is exactly the size of a T* and
+// destruction is an inlined call. std::unique_ptr with a function-pointer
+// deleter costs a second word and an indirect call on every reset.
+// PoolDelete, which carries its pool, costs the extra word but no call.
+
+template <typename T>
+struct DefaultDelete
+{
+    void operator()(T *ptr) const { delete ptr; }
+};
+
+// Hands the object back to its pool, whose deallocate runs the destructor
+template <typename Pool>
+class PoolDelete
+{
+private:
+    Pool *pool = nullptr;
+
+public:
+    PoolDelete() = default;
+    explicit PoolDelete(Pool &p) : pool(&p) {}
+
+    template <typename T>
+    void operator()(T *ptr) const { pool->deallocate(ptr); }
+};
+
+// PoolDelete for a pool with static storage duration, named as a template
+// argument so the deleter holds nothing
+template <auto &GlobalPool>
+struct StaticPoolDelete
+{
+    template <typename T>
+    void operator()(T *ptr) const { GlobalPool.deallocate(ptr); }
+};
+
+// Runs the destructor only; the memory goes back with the arena (reset,
+// rewind) or the shared-memory segment it was placed in
+struct ArenaDelete
+{
+    template <typename T>
+    void operator()(T *ptr) const { ptr->~T(); }
+};
+
+// Pointer plus deleter; the specialisation below stores nothing for an
+// empty deleter
+template <typename T, typename Deleter, bool Stateless = std::is_empty_v<Deleter> && !std::is_final_v<Deleter>>
+class UniquePtrStorage
+{
+protected:
+    T *ptr;
+    Deleter deleter;
+
+    UniquePtrStorage(T *p, Deleter d) : ptr(p), deleter(std::move(d)) {}
+    Deleter &deleter_ref() { return deleter; }
+    const Deleter &deleter_ref() const { return deleter; }
+};
+
+template <typename T, typename Deleter>
+class UniquePtrStorage<T, Deleter, true> : private Deleter
+{
+protected:
+    T *ptr;
+
+    UniquePtrStorage(T *p, Deleter d) : Deleter(std::move(d)), ptr(p) {}
+    Deleter &deleter_ref() { return *this; }
+    const Deleter &deleter_ref() const { return *this; }
+};
+
+template <typename T, typename Deleter = DefaultDelete<T>>
+class UniquePtr : private UniquePtrStorage<T, Deleter>
+{
+private:
+    using Storage = UniquePtrStorage<T, Deleter>;
+    using Storage::deleter_ref;
+    using Storage::ptr;
+
+public:
+    explicit UniquePtr(T *p = nullptr, Deleter d = Deleter()) : Storage(p, std::move(d)) {}
+
+    ~UniquePtr()
+    {
+        if (ptr)
+        {
+            deleter_ref()(ptr);
+        }
+    }
+
+    UniquePtr(const UniquePtr &) = delete;
+    UniquePtr &operator=(const UniquePtr &) = delete;
+
+    UniquePtr(UniquePtr &&other) noexcept : Storage(other.ptr, std::move(other.deleter_ref()))
+    {
+        other.ptr = nullptr;
+    }
+
+    UniquePtr &operator=(UniquePtr &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset(other.release());
+            deleter_ref() = std::move(other.deleter_ref());
+        }
+        return *this;
+    }
+
+    T &operator*() const { return *ptr; }
+    T *operator->() const { return ptr; }
+    T *get() const { return ptr; }
+    explicit operator bool() const { return ptr != nullptr; }
+
+    Deleter &get_deleter() { return deleter_ref(); }
+    const Deleter &get_deleter() const { return deleter_ref(); }
+
+    // Give up ownership without destroying
+    T *release()
+    {
+        T *owned = ptr;
+        ptr = nullptr;
+        return owned;
+    }
+
+    // Destroy the current object, if any, and own p
+    void reset(T *p = nullptr)
+    {
+        T *old = ptr;
+        ptr = p;
+        if (old)
+        {
+            deleter_ref()(old);
+        }
+    }
+};
+
+static_assert(sizeof(UniquePtr<int>) == sizeof(int *));
+static_assert(sizeof(UniquePtr<int, ArenaDelete>) == sizeof(int *));
+
+// Construct a T in a slot of pool (MemoryPool<T> or ConcurrentMemoryPool<T>)
+// owned by a pointer that returns it there. A pool slot cannot be handed
+// back unconstructed, hence the nothrow requirement.
+template <typename T, typename Pool, typename... Args>
+UniquePtr<T, PoolDelete<Pool>> make_pooled(Pool &pool, Args &&...args)
+{
+    static_assert(std::is_nothrow_constructible_v<T, Args...>, "pooled objects must construct without throwing");
+    return UniquePtr<T, PoolDelete<Pool>>(new (pool.allocate()) T(std::forward<Args>(args)...),
+                                          PoolDelete<Pool>(pool));
+}
+
+// As above for a pool with static storage duration: make_pooled<T, pool>(args...)
+template <typename T, auto &GlobalPool, typename... Args>
+UniquePtr<T, StaticPoolDelete<GlobalPool>> make_pooled(Args &&...args)
+{
+    static_assert(std::is_nothrow_constructible_v<T, Args...>, "pooled objects must construct without throwing");
+    return UniquePtr<T, StaticPoolDelete<GlobalPool>>(new (GlobalPool.allocate()) T(std::forward<Args>(args)...));
+}
+
+// Construct a T in arena; the pointer is empty if the arena is exhausted
+template <typename T, typename... Args>
+UniquePtr<T, ArenaDelete> make_in_arena(Arena &arena, Args &&...args)
+{
+    return UniquePtr<T, ArenaDelete>(arena.create<T>(std::forward<Args>(args)...));
+}
+
+#ifdef UNIQUE_PTR_MAIN
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+#include "../orderbook/memory_pool.cpp"
+
+struct Quote
+{
+    uint64_t id;
+    int64_t price;
+    uint64_t quantity;
+    static inline uint64_t live = 0;
+
+    Quote(uint64_t i, int64_t p, uint64_t q) noexcept : id(i), price(p), quantity(q) { ++live; }
+    ~Quote() { --live; }
+};
+
+MemoryPool<Quote, 1024> quote_pool;
+
+// Own pool slots through a size-of-a-pointer handle, then compare the cost
+// of a pool round trip against std::unique_ptr with a function-pointer deleter
+int main()
+{
+    static_assert(sizeof(UniquePtr<Quote, StaticPoolDelete<quote_pool>>) == sizeof(Quote *));
+    std::printf("sizeof: UniquePtr<default> %zu, <StaticPoolDelete> %zu, <ArenaDelete> %zu, <PoolDelete> %zu, "
+                "std::unique_ptr<fn ptr> %zu\n",
+                sizeof(UniquePtr<Quote>), sizeof(UniquePtr<Quote, StaticPoolDelete<quote_pool>>),
+                sizeof(UniquePtr<Quote, ArenaDelete>), sizeof(UniquePtr<Quote, PoolDelete<MemoryPool<Quote, 1024>>>),
+                sizeof(std::unique_ptr<Quote, void (*)(Quote *)>));
+
+    quote_pool.reserve(1024);
+    {
+        auto a = make_pooled<Quote, quote_pool>(1, 1000000, 10);
+        auto b = make_pooled<Quote>(quote_pool, 2, 1000100, 20);
+        auto moved = std::move(a);
+        ArenaConfig config;
+        config.capacity = size_t{1} << 20;
+        Arena arena(config);
+        auto scratch = make_in_arena<Quote>(arena, 3, 999900, 30);
+        std::printf("live quotes in scope: %lu (moved-from empty: %s)\n", static_cast<unsigned long>(Quote::live),
+                    a ? "no" : "yes");
+    }
+    std::printf("live quotes after scope: %lu\n", static_cast<unsigned long>(Quote::live));
+
+    const uint64_t rounds = 10000000;
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < rounds; ++i)
+    {
+        auto quote = make_pooled<Quote, quote_pool>(i, 1000000, 1);
+        checksum += quote->id;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("UniquePtr<StaticPoolDelete> round trip: %.2f ns\n", ns / static_cast<double>(rounds));
+
+    // An opaque function pointer, as std::unique_ptr users pass for custom frees
+    void (*volatile opaque)(Quote *) = [](Quote *quote) { quote_pool.deallocate(quote); };
+    void (*release)(Quote *) = opaque;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < rounds; ++i)
+    {
+        std::unique_ptr<Quote, void (*)(Quote *)> quote(new (quote_pool.allocate()) Quote(i, 1000000, 1), release);
+        checksum += quote->id;
+    }
+    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("std::unique_ptr<fn ptr> round trip:     %.2f ns\n", ns / static_cast<double>(rounds));
+    return checksum == 0 || Quote::live != 0;
+}
+#endif
@@ -0,0 +1,266 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "orderbook.cpp"
+#include "threading.cpp"
+#include "../SPSC_QUEUES/spsc_q4.cpp"
+
+// One book operation routed to an instrument
+struct InstrumentOp
+{
+    uint32_t instrument;
+    BookOp op;
+};
+
+// Owns one book per instrument and shards instruments round-robin across
+// worker threads. The feed thread is the single producer of every shard's
+// Fifo4; each worker is the only thread that touches its books. The only
+// cross-thread reads are the queues and each book's TopOfBookSlot.
+template <typename Book = OrderBook>
+class BookManager
+{
+private:
+    struct alignas(64) Shard
+    {
+        Fifo4<InstrumentOp> queue;
+        std::vector<std::unique_ptr<Book>> books; // Local index = instrument / shard count
+        int core;
+        std::thread worker;
+        std::atomic<uint64_t> processed{0};
+
+        Shard(size_t capacity, int pinned_core) : queue(capacity), core(pinned_core) {}
+    };
+
+    size_t instrument_count;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::unique_ptr<TopOfBookSlot<>[]> tops;
+    std::atomic<bool> running{false};
+
+    static constexpr size_t drain_batch = 64; // Most ops a worker takes per queue release
+
+public:
+    // One shard per entry of cores, which must not be empty; -1 leaves that
+    // worker unpinned
+    BookManager(size_t instruments, const std::vector<int> &cores, size_t queue_capacity = 1 << 16,
+                const typename Book::Config &config = {})
+        : instrument_count(instruments), tops(new TopOfBookSlot<>[instruments])
+    {
+        if (cores.empty())
+        {
+            throw std::invalid_argument("BookManager needs at least one shard");
+        }
+        for (int core : cores)
+        {
+            shards.push_back(std::make_unique<Shard>(queue_capacity, core));
+        }
+        for (size_t i = 0; i < instruments; ++i)
+        {
+            auto book = std::make_unique<Book>(config);
+            book->set_top_slot(&tops[i]);
+            shards[i % shards.size()]->books.push_back(std::move(book));
+        }
+    }
+
+    BookManager(const BookManager &) = delete;
+    BookManager &operator=(const BookManager &) = delete;
+
+    ~BookManager() { stop(); }
+
+    size_t instruments() const { return instrument_count; }
+    size_t shard_count() const { return shards.size(); }
+    size_t shard_of(uint32_t instrument) const { return instrument % shards.size(); }
+
+    void start()
+    {
+        running.store(true, std::memory_order_release);
+        for (auto &shard : shards)
+        {
+            Shard *s = shard.get();
+            s->worker = std::thread([this, s]
+                                    { run_shard(*s); });
+        }
+    }
+
+    // Let workers drain what is queued, then join them
+    void stop()
+    {
+        running.store(false, std::memory_order_release);
+        for (auto &shard : shards)
+        {
+            if (shard->worker.joinable())
+            {
+                shard->worker.join();
+            }
+        }
+    }
+
+    // Feed thread only. Returns false if the owning shard's queue is full
+    // or there is no such instrument.
+    bool try_submit(uint32_t instrument, const BookOp &op)
+    {
+        if (instrument >= instrument_count) HFT_UNLIKELY
+        {
+            return false;
+        }
+        return shards[shard_of(instrument)]->queue.emplace(InstrumentOp{instrument, op});
+    }
+
+    // Feed thread only. Spins while the owning shard is backed up; returns
+    // false, without queueing, if there is no such instrument.
+    bool submit(uint32_t instrument, const BookOp &op)
+    {
+        if (instrument >= instrument_count) HFT_UNLIKELY
+        {
+            return false;
+        }
+        while (!shards[shard_of(instrument)]->queue.emplace(InstrumentOp{instrument, op}))
+        {
+            cpu_relax();
+        }
+        return true;
+    }
+
+    // Any thread; never blocks the owning worker. An unknown instrument
+    // reads as an empty book.
+    TopOfBook<> top_of_book(uint32_t instrument) const
+    {
+        return instrument < instrument_count ? tops[instrument].load() : TopOfBook<>{};
+    }
+
+    uint64_t processed() const
+    {
+        uint64_t total = 0;
+        for (const auto &shard : shards)
+        {
+            total += shard->processed.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    void run_shard(Shard &shard)
+    {
+        pin_current_thread(shard.core);
+
+        const size_t stride = shards.size();
+        uint64_t processed = 0;
+
+        // Ops are applied straight from their queue slots, and a drained
+        // batch is released to the feed thread with one store
+        auto apply = [&](InstrumentOp &message)
+        {
+            // The book republishes its top of book itself when it moves
+            shard.books[message.instrument / stride]->apply(message.op);
+        };
+
+        while (true)
+        {
+            size_t drained = shard.queue.pop_batch(drain_batch, apply);
+            if (drained == 0)
+            {
+                if (!running.load(std::memory_order_acquire) && shard.queue.empty())
+                {
+                    break;
+                }
+                cpu_relax();
+                continue;
+            }
+            processed += drained;
+            shard.processed.store(processed, std::memory_order_relaxed);
+        }
+    }
+};
+
+#ifdef BOOK_MANAGER_MAIN
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Feed random flow for many instruments through the manager while another
+// thread polls top of book
+// book_manager [instruments] [shards] [messages]
+int main(int argc, char **argv)
+{
+    size_t instruments = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    unsigned hw = std::max(2u, std::thread::hardware_concurrency());
+    size_t shard_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : hw - 1;
+    uint64_t messages = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 5000000;
+    if (instruments == 0 || shard_count == 0)
+    {
+        std::fprintf(stderr, "usage: %s [instruments] [shards] [messages], both counts above 0\n", argv[0]);
+        return 1;
+    }
+
+    // Core 0 is left to the feed thread; pin workers only if there are cores
+    std::vector<int> cores;
+    for (size_t i = 0; i < shard_count; ++i)
+    {
+        cores.push_back(shard_count < hw ? static_cast<int>(i + 1) : -1);
+    }
+
+    BookManager<OrderBook> manager(instruments, cores);
+    manager.start();
+
+    std::atomic<bool> polling{true};
+    std::atomic<uint64_t> polls{0};
+    std::atomic<uint64_t> crossed{0};
+    std::thread reader([&]
+                       {
+                           uint64_t n = 0, bad = 0;
+                           while (polling.load(std::memory_order_relaxed))
+                           {
+                               TopOfBook<> top = manager.top_of_book(static_cast<uint32_t>(n++ % instruments));
+                               bad += top.bid_count && top.ask_count && top.bids[0].price >= top.asks[0].price;
+                           }
+                           polls.store(n);
+                           crossed.store(bad); });
+
+    uint64_t seed = 1;
+    auto next = [&seed]()
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+    std::vector<uint64_t> next_id(instruments, 1);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < messages; ++i)
+    {
+        uint32_t instrument = static_cast<uint32_t>(next() % instruments);
+        uint64_t &id = next_id[instrument];
+        if (next() % 10 < 6 || id < 10)
+        {
+            bool is_buy = next() % 2 == 0;
+            Price offset = Price::from_raw(static_cast<int64_t>(next() % 20) * (Price::scale / 100));
+            Price price = is_buy ? 100_px - offset : 100_px + 0.01_px + offset;
+            manager.submit(instrument, BookOp::add({id, is_buy, price, 1 + next() % 100, i}));
+            ++id;
+        }
+        else
+        {
+            manager.submit(instrument, BookOp::cancel(1 + next() % (id - 1)));
+        }
+    }
+    manager.stop();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    polling.store(false);
+    reader.join();
+
+    std::printf("%zu instruments over %zu shards: %lu messages in %.3f s (%.0f msg/s), %lu top-of-book polls (%lu crossed)\n",
+                instruments, manager.shard_count(), static_cast<unsigned long>(manager.processed()), elapsed,
+                static_cast<double>(manager.processed()) / elapsed, static_cast<unsigned long>(polls.load()),
+                static_cast<unsigned long>(crossed.load()));
+
+    TopOfBook<> top = manager.top_of_book(0);
+    PriceLevel bid = top.best_bid(), ask = top.best_ask();
+    std::printf("Instrument 0: %.2f x %lu / %.2f x %lu\n", bid.price.to_double(),
+                static_cast<unsigned long>(bid.total_quantity), ask.price.to_double(),
+                static_cast<unsigned long>(ask.total_quantity));
+    return 0;
+}
+#endif
@@ -0,0 +1,157 @@
+#pragma once
+#include <cstdio>
+#include <cstddef>
+#include <span>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "orderbook.cpp"
+
+// File-backed book images for warm restarts. Both directions go through a
+// shared mapping of the file, so the image is written and read in place
+// with no intermediate buffer. A path under /dev/shm keeps the image in
+// shared memory, where it survives the process but not a reboot.
+
+// Write book's snapshot to path, replacing it; prints the reason and
+// returns false on failure
+template <typename Book>
+bool save_book_snapshot(const Book &book, const char *path)
+{
+    size_t length = book.snapshot_size();
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        std::perror(path);
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(length)) != 0)
+    {
+        std::perror("ftruncate");
+        ::close(fd);
+        return false;
+    }
+
+    void *base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        std::perror("mmap");
+        return false;
+    }
+    size_t written = book.write_snapshot(std::span<std::byte>(static_cast<std::byte *>(base), length));
+    munmap(base, length);
+    return written == length;
+}
+
+// Restore an empty book from a snapshot written by save_book_snapshot;
+// prints the reason and returns false on failure
+template <typename Book>
+bool load_book_snapshot(Book &book, const char *path)
+{
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        std::perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        std::fprintf(stderr, "%s: not a book snapshot\n", path);
+        ::close(fd);
+        return false;
+    }
+
+    size_t length = static_cast<size_t>(st.st_size);
+    void *base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        std::perror("mmap");
+        return false;
+    }
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    bool ok = book.restore_snapshot(std::span<const std::byte>(static_cast<const std::byte *>(base), length));
+    munmap(base, length);
+    if (!ok)
+    {
+        std::fprintf(stderr, "%s: bad book snapshot\n", path);
+    }
+    return ok;
+}
+
+#ifdef BOOK_SNAPSHOT_MAIN
+#include <chrono>
+#include <cstdlib>
+
+// Build a deep book, save it, then compare a snapshot restore against
+// rebuilding the same book by replaying add_order
+// book_snapshot [file] [orders]
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "/dev/shm/orderbook.snap";
+    uint64_t orders = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    uint64_t seed = 1;
+    auto next = [&seed]()
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+
+    std::vector<Order> flow;
+    flow.reserve(orders);
+    for (uint64_t id = 1; id <= orders; ++id)
+    {
+        bool is_buy = next() % 2 == 0;
+        Price offset = Price::from_raw(static_cast<int64_t>(1 + next() % 2000) * (Price::scale / 100));
+        flow.push_back({id, is_buy, is_buy ? 100_px - offset : 100_px + offset, 1 + next() % 100, id});
+    }
+
+    OrderBook book;
+    book.reserve(orders);
+    for (const Order &order : flow)
+    {
+        book.add_order(order);
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto us_since = [](clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+    };
+
+    auto start = clock::now();
+    if (!save_book_snapshot(book, path))
+    {
+        return 1;
+    }
+    auto save_us = us_since(start);
+
+    OrderBook restored;
+    start = clock::now();
+    if (!load_book_snapshot(restored, path))
+    {
+        return 1;
+    }
+    auto load_us = us_since(start);
+
+    OrderBook replayed;
+    start = clock::now();
+    replayed.reserve(orders);
+    for (const Order &order : flow)
+    {
+        replayed.add_order(order);
+    }
+    auto replay_us = us_since(start);
+
+    std::printf("%lu orders, %zu bytes: save %ld us, restore %ld us, replay add_order %ld us\n",
+                static_cast<unsigned long>(orders), book.snapshot_size(), static_cast<long>(save_us),
+                static_cast<long>(load_us), static_cast<long>(replay_us));
+    restored.print_book(3);
+    return 0;
+}
+#endif
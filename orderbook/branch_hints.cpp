@@ -0,0 +1,37 @@
+#pragma once
+
+// Hot/cold path annotations shared by the book, pools, indexes, queues and
+// feed handlers.
+//
+// HFT_LIKELY / HFT_UNLIKELY follow a condition and mark the branch the
+// steady state does or doesn't take:
+//
+//   if (!node) HFT_UNLIKELY
+//   {
+//       return false;
+//   }
+//
+// They expand to C++20 [[likely]] / [[unlikely]], which make the common
+// branch the fall-through and move the other one out of the hot block.
+// Only annotate branches whose bias is structural (a lookup that misses
+// only on bad input, a queue that is full only under overload), not
+// data-dependent ones such as a bid/ask split.
+//
+// HFT_COLD marks functions that run only on slow paths: growing a table,
+// mapping a pool block, reporting an error. GCC and Clang never inline
+// them, optimise them for size and place them in .text.unlikely, away from
+// the hot loop, so the hot code stays dense in the instruction cache.
+//
+// Build with -DHFT_NO_BRANCH_HINTS to compile the branch hints out and
+// compare (see orderbook/branch_bench.cpp). HFT_COLD stays, since moving
+// error paths out of line is a layout choice, not a prediction.
+
+#ifdef HFT_NO_BRANCH_HINTS
+#define HFT_LIKELY
+#define HFT_UNLIKELY
+#else
+#define HFT_LIKELY [[likely]]
+#define HFT_UNLIKELY [[unlikely]]
+#endif
+
+#define HFT_COLD [[gnu::cold, gnu::noinline]]
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "lookup_tables.cpp"
+#include "tsc_clock.cpp"
+
+// HDR-style log-linear histogram of TSC tick counts. Values below 32 get
+// exact buckets; above that each power of two is split into 16 linear
+// sub-buckets, so any recorded value is reported within ~6%. All buckets
+// are preallocated inline; record() is a shift, a compare and an increment.
+class LatencyHistogram
+{
+private:
+    using Buckets = LogLinearBuckets<5>; // 32 exact buckets, then 16 per power of two
+    static_assert(Buckets::consistent());
+    static constexpr size_t bucket_count = Buckets::count;
+
+    uint64_t counts[bucket_count] = {};
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+
+public:
+    void record(uint64_t ticks)
+    {
+        counts[Buckets::index(ticks)]++;
+        total++;
+        max_value = std::max(max_value, ticks);
+    }
+
+    void reset() { *this = LatencyHistogram{}; }
+
+    uint64_t count() const { return total; }
+    uint64_t max_ticks() const { return max_value; }
+
+    // Smallest recorded bucket bound covering the given fraction (0.999 for
+    // p99.9) of samples, in ticks
+    uint64_t percentile_ticks(double fraction) const
+    {
+        if (total == 0)
+        {
+            return 0;
+        }
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * static_cast<double>(total) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucket_count; ++i)
+        {
+            seen += counts[i];
+            if (seen >= target)
+            {
+                return std::min(Buckets::upper[i], max_value);
+            }
+        }
+        return max_value;
+    }
+
+    double percentile_ns(double fraction) const { return TscClock::to_ns(percentile_ticks(fraction)); }
+    double max_ns() const { return TscClock::to_ns(max_value); }
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Tables and constants generated at compile time for the price and
+// latency code, in the spirit of L9/L10's template metaprograms but with
+// constexpr functions. Everything here is either a constant the compiler
+// folds or a small table; hot paths do a load, a multiply or a shift.
+
+// 10^0 .. 10^18, every power of ten an int64_t holds
+inline constexpr std::array<int64_t, 19> powers_of_ten = [] {
+    std::array<int64_t, 19> table{};
+    table[0] = 1;
+    for (size_t i = 1; i < table.size(); ++i)
+    {
+        table[i] = table[i - 1] * 10;
+    }
+    return table;
+}();
+
+// Decimal places of a power-of-ten scale (10000 -> 4), or -1 if scale is
+// not a power of ten
+constexpr int decimal_places(int64_t scale)
+{
+    for (size_t i = 0; i < powers_of_ten.size(); ++i)
+    {
+        if (powers_of_ten[i] == scale)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+static_assert(powers_of_ten[18] == 1000000000000000000 && decimal_places(10000) == 4 && decimal_places(250) == -1);
+
+// Division by a fixed divisor as a multiply and a shift (Granlund and
+// Montgomery, "Division by Invariant Integers using Multiplication").
+// For numerators below 2^63, m = ceil(2^(63 + l) / d) with l = ceil(log2 d)
+// fits 64 bits and n / d == (n * m) >> (63 + l) exactly. A power-of-two d
+// degenerates to a plain shift. Built in a constant expression when d is
+// known at compile time, or once at construction when it is configuration
+// (a tick size); either way the per-call cost is one widening multiply
+// instead of a ~40-cycle divide.
+struct Reciprocal
+{
+    uint64_t multiplier = uint64_t{1} << 63;
+    unsigned shift = 63;
+
+    constexpr Reciprocal() = default;
+
+    constexpr explicit Reciprocal(uint64_t divisor)
+    {
+        unsigned l = divisor > 1 ? static_cast<unsigned>(std::bit_width(divisor - 1)) : 0;
+        unsigned __int128 numerator = static_cast<unsigned __int128>(1) << (63 + l);
+        multiplier = static_cast<uint64_t>((numerator + divisor - 1) / divisor);
+        shift = 63 + l;
+    }
+
+    // n / divisor for n < 2^63
+    constexpr uint64_t divide(uint64_t n) const
+    {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(n) * multiplier) >> shift);
+    }
+
+    // Truncating signed division, matching the / operator
+    constexpr int64_t divide(int64_t n) const
+    {
+        uint64_t magnitude = n < 0 ? 0 - static_cast<uint64_t>(n) : static_cast<uint64_t>(n);
+        auto quotient = static_cast<int64_t>(divide(magnitude));
+        return n < 0 ? -quotient : quotient;
+    }
+};
+
+// Spot checks at the edges the proof covers: largest numerator, divisors
+// around powers of two, and the price tick sizes the benches use
+constexpr bool reciprocal_matches(uint64_t divisor)
+{
+    Reciprocal r(divisor);
+    constexpr uint64_t limit = (uint64_t{1} << 63) - 1;
+    for (uint64_t n : {uint64_t{0}, uint64_t{1}, divisor - 1, divisor, divisor + 1, divisor * 7 - 1, limit,
+                       limit - 1, limit / divisor * divisor, limit / divisor * divisor - 1})
+    {
+        if (n <= limit && r.divide(n) != n / divisor)
+        {
+            return false;
+        }
+    }
+    return r.divide(int64_t{-1000003}) == int64_t{-1000003} / static_cast<int64_t>(divisor);
+}
+
+static_assert(reciprocal_matches(1) && reciprocal_matches(3) && reciprocal_matches(7) && reciprocal_matches(25) &&
+              reciprocal_matches(100) && reciprocal_matches(1000) && reciprocal_matches(1023) &&
+              reciprocal_matches(1024) && reciprocal_matches(1025) && reciprocal_matches(uint64_t{1} << 40) &&
+              reciprocal_matches((uint64_t{1} << 62) + 1));
+
+// Bucket map of an HDR-style log-linear histogram: values below
+// 2^SubBucketBits get exact buckets, and each power of two above that is
+// split into 2^(SubBucketBits - 1) linear sub-buckets. index() is a count
+// of leading zeros and some shifts; the upper bound of every bucket is a
+// table built at compile time.
+template <unsigned SubBucketBits>
+struct LogLinearBuckets
+{
+    static constexpr uint64_t sub_bucket_count = uint64_t{1} << SubBucketBits;
+    static constexpr uint64_t half_count = sub_bucket_count / 2;
+    static constexpr size_t count = sub_bucket_count + (64 - SubBucketBits) * half_count;
+
+    static constexpr size_t index(uint64_t value)
+    {
+        if (value < sub_bucket_count)
+        {
+            return static_cast<size_t>(value);
+        }
+        unsigned shift = static_cast<unsigned>(std::bit_width(value)) - SubBucketBits;
+        return static_cast<size_t>(sub_bucket_count + (shift - 1) * half_count + ((value >> shift) - half_count));
+    }
+
+    // Largest value that lands in each bucket
+    static constexpr std::array<uint64_t, count> upper = [] {
+        std::array<uint64_t, count> table{};
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            if (idx < sub_bucket_count)
+            {
+                table[idx] = idx;
+                continue;
+            }
+            unsigned shift = static_cast<unsigned>((idx - sub_bucket_count) / half_count) + 1;
+            uint64_t sub = (idx - sub_bucket_count) % half_count + half_count;
+            table[idx] = ((sub + 1) << shift) - 1;
+        }
+        return table;
+    }();
+
+    // Every bound maps back to its own bucket and the next value to the next
+    static constexpr bool consistent()
+    {
+        for (size_t idx = 0; idx + 1 < count; ++idx)
+        {
+            if (index(upper[idx]) != idx || index(upper[idx] + 1) != idx + 1)
+            {
+                return false;
+            }
+        }
+        return index(UINT64_MAX) == count - 1 && upper[count - 1] == UINT64_MAX;
+    }
+};
@@ -0,0 +1,479 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <sys/mman.h>
+
+#include "branch_hints.cpp"
+#include "../SPSC_QUEUES/spsc_q3.cpp"
+#include "../memory/arena.cpp"
+#include "../lockFreeWaitFree/treiber_stack.cpp"
+
+// Anonymous read-write mapping of at least bytes, rounded up to whole
+// pages: 2 MiB ones when huge_pages is set and some are reserved, normal
+// pages with transparent huge pages requested otherwise. prefault touches
+// every page before returning.
+struct PageMapping
+{
+    char *data;
+    size_t bytes;
+};
+
+inline PageMapping map_pages(size_t bytes, bool huge_pages, bool prefault)
+{
+    constexpr size_t page_size = 4096;
+    constexpr size_t huge_page_size = 2 * 1024 * 1024;
+    size_t granule = huge_pages ? huge_page_size : page_size;
+    bytes = (std::max<size_t>(bytes, 1) + granule - 1) / granule * granule;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | (prefault ? MAP_POPULATE : 0);
+
+    void *data = MAP_FAILED;
+    if (huge_pages)
+    {
+        data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+    }
+    if (data == MAP_FAILED)
+    {
+        // No reserved huge pages: fall back to normal pages, asking for
+        // transparent huge pages if enabled
+        data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (data == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+        if (huge_pages)
+        {
+            madvise(data, bytes, MADV_HUGEPAGE);
+        }
+    }
+    if (prefault)
+    {
+        // MAP_POPULATE is only a hint for some mappings; touch every page
+        for (size_t offset = 0; offset < bytes; offset += page_size)
+        {
+            static_cast<volatile char *>(data)[offset] = 0;
+        }
+    }
+    return {static_cast<char *>(data), bytes};
+}
+
+// Fixed-size object pool owned by one thread.
+//
+// Freed slots are threaded onto an intrusive free list stored in the slots
+// themselves, so deallocate never allocates. Other threads may hand
+// objects back through deallocate_remote, a lock-free push onto a second
+// list that the owner takes over in one exchange when its own list runs
+// dry. Blocks come straight from mmap, optionally on 2 MiB pages, and
+// reserve() pre-faults them so the first allocations after startup do not
+// page-fault. Blocks are unmapped when the pool is destroyed, unless they
+// were carved from an Arena (set_arena), which then owns them.
+template <typename T, size_t BlockSize = 4096>
+class MemoryPool
+{
+private:
+    struct FreeSlot
+    {
+        FreeSlot *next;
+    };
+
+    struct Block
+    {
+        char *data;
+        size_t bytes;
+        size_t capacity; // Slots
+        bool owned;      // Mapped by us rather than carved from an arena
+    };
+
+    static constexpr size_t slot_align = alignof(T) > alignof(FreeSlot) ? alignof(T) : alignof(FreeSlot);
+    static constexpr size_t slot_size = (std::max(sizeof(T), sizeof(FreeSlot)) + slot_align - 1) / slot_align * slot_align;
+
+    bool huge_pages;
+    Arena *arena = nullptr;
+    std::vector<Block> blocks;
+    size_t current_block = 0; // Block being carved
+    size_t current_index = 0; // Next uncarved slot in it
+    FreeSlot *free_head = nullptr;
+
+    // Written by other threads; kept off the owner's cache line
+    alignas(cache_line_size) std::atomic<FreeSlot *> remote_head{nullptr};
+
+public:
+    explicit MemoryPool(bool use_huge_pages = false) : huge_pages(use_huge_pages) {}
+
+    MemoryPool(const MemoryPool &) = delete;
+    MemoryPool &operator=(const MemoryPool &) = delete;
+
+    ~MemoryPool()
+    {
+        for (const Block &block : blocks)
+        {
+            if (block.owned)
+            {
+                munmap(block.data, block.bytes);
+            }
+        }
+    }
+
+    // Carve future blocks from arena instead of mapping them, e.g. to put
+    // the pool on huge pages local to the owning thread's NUMA node
+    void set_arena(Arena *source) { arena = source; }
+
+    // Uninitialised storage for one T; owner thread only
+    T *allocate()
+    {
+        if (!free_head && remote_head.load(std::memory_order_relaxed))
+        {
+            free_head = remote_head.exchange(nullptr, std::memory_order_acquire);
+        }
+        if (free_head) HFT_LIKELY
+        {
+            FreeSlot *slot = free_head;
+            free_head = slot->next;
+            return reinterpret_cast<T *>(slot);
+        }
+
+        while (current_block < blocks.size() && current_index == blocks[current_block].capacity)
+        {
+            ++current_block;
+            current_index = 0;
+        }
+        if (current_block == blocks.size()) HFT_UNLIKELY
+        {
+            map_block(false);
+        }
+        return reinterpret_cast<T *>(blocks[current_block].data + slot_size * current_index++);
+    }
+
+    // Destroy and recycle; owner thread only
+    void deallocate(T *ptr)
+    {
+        if (ptr)
+        {
+            ptr->~T();
+            FreeSlot *slot = reinterpret_cast<FreeSlot *>(ptr);
+            slot->next = free_head;
+            free_head = slot;
+        }
+    }
+
+    // Destroy and hand back from any other thread. Entries are only ever
+    // pushed here and taken all at once, so the CAS loop has no ABA hazard.
+    void deallocate_remote(T *ptr)
+    {
+        if (ptr)
+        {
+            ptr->~T();
+            FreeSlot *slot = reinterpret_cast<FreeSlot *>(ptr);
+            slot->next = remote_head.load(std::memory_order_relaxed);
+            while (!remote_head.compare_exchange_weak(slot->next, slot, std::memory_order_release,
+                                                      std::memory_order_relaxed))
+            {
+            }
+        }
+    }
+
+    // Map and pre-fault enough blocks for n objects beyond those carved so
+    // far; call at startup, before the hot path
+    void reserve(size_t n)
+    {
+        size_t available = 0;
+        for (size_t i = current_block; i < blocks.size(); ++i)
+        {
+            available += blocks[i].capacity - (i == current_block ? current_index : 0);
+        }
+        while (available < n)
+        {
+            available += map_block(true);
+        }
+    }
+
+    // Slots carved from mapped blocks, live or free
+    size_t capacity() const
+    {
+        size_t total = 0;
+        for (const Block &block : blocks)
+        {
+            total += block.capacity;
+        }
+        return total;
+    }
+
+private:
+    // Map one block of at least BlockSize slots; returns its slot count
+    HFT_COLD size_t map_block(bool prefault)
+    {
+        if (arena)
+        {
+            size_t bytes = BlockSize * slot_size;
+            void *data = arena->allocate(bytes, cache_line_size);
+            if (!data)
+            {
+                throw std::bad_alloc();
+            }
+            blocks.push_back({static_cast<char *>(data), bytes, BlockSize, false});
+            return BlockSize;
+        }
+
+        PageMapping mapping = map_pages(BlockSize * slot_size, huge_pages, prefault);
+        size_t capacity = mapping.bytes / slot_size;
+        blocks.push_back({mapping.data, mapping.bytes, capacity, true});
+        return capacity;
+    }
+};
+
+// Single-owner pool that names slots by 32-bit index rather than pointer
+// and splits each slot into a hot part (Hot) and a cold part (Cold) held
+// in parallel arrays. Walks that read only Hot fields pack more slots per
+// cache line and leave the Cold lines alone.
+//
+// Slots come in chunks of ChunkSize (a power of two) that never move, so
+// at(index) is a shift, a mask and one load from the chunk table, and
+// pointers into the pool stay valid. Freed slots are linked through their
+// Hot storage. Both parts must be trivially destructible: slots are
+// recycled without destructors and chunks released wholesale, by the
+// pool or by the Arena they were carved from (set_arena).
+template <typename Hot, typename Cold, size_t ChunkSize = 4096>
+class IndexedPool
+{
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+private:
+    static_assert(std::has_single_bit(ChunkSize), "ChunkSize must be a power of two");
+    static_assert(std::is_trivially_destructible_v<Hot> && std::is_trivially_destructible_v<Cold>);
+    static_assert(sizeof(Hot) >= sizeof(uint32_t) && alignof(Cold) <= cache_line_size);
+
+    static constexpr unsigned chunk_bits = std::countr_zero(ChunkSize);
+    static constexpr size_t hot_bytes = (ChunkSize * sizeof(Hot) + cache_line_size - 1) / cache_line_size *
+                                        cache_line_size;
+    static constexpr size_t chunk_bytes = hot_bytes + ChunkSize * sizeof(Cold);
+
+    struct Chunk
+    {
+        Hot *hot;
+        Cold *cold;
+    };
+
+    bool huge_pages;
+    Arena *arena = nullptr;
+    std::vector<Chunk> chunks;
+    std::vector<PageMapping> mappings; // Ours to unmap
+    uint32_t carved = 0;               // Slots handed out at least once
+    uint32_t free_head = none;
+
+public:
+    explicit IndexedPool(bool use_huge_pages = false) : huge_pages(use_huge_pages) {}
+
+    IndexedPool(const IndexedPool &) = delete;
+    IndexedPool &operator=(const IndexedPool &) = delete;
+
+    ~IndexedPool()
+    {
+        for (const PageMapping &mapping : mappings)
+        {
+            munmap(mapping.data, mapping.bytes);
+        }
+    }
+
+    // Carve future chunks from arena instead of mapping them
+    void set_arena(Arena *source) { arena = source; }
+
+    // Index of an uninitialised slot
+    uint32_t allocate()
+    {
+        if (free_head != none) HFT_LIKELY
+        {
+            uint32_t index = free_head;
+            std::memcpy(&free_head, at(index), sizeof(free_head));
+            return index;
+        }
+        if (carved == chunks.size() * ChunkSize) HFT_UNLIKELY
+        {
+            map_chunks(false);
+        }
+        return carved++;
+    }
+
+    void deallocate(uint32_t index)
+    {
+        std::memcpy(static_cast<void *>(at(index)), &free_head, sizeof(free_head));
+        free_head = index;
+    }
+
+    Hot *at(uint32_t index) { return chunks[index >> chunk_bits].hot + (index & (ChunkSize - 1)); }
+    const Hot *at(uint32_t index) const { return chunks[index >> chunk_bits].hot + (index & (ChunkSize - 1)); }
+
+    Cold &cold(uint32_t index) { return chunks[index >> chunk_bits].cold[index & (ChunkSize - 1)]; }
+    const Cold &cold(uint32_t index) const { return chunks[index >> chunk_bits].cold[index & (ChunkSize - 1)]; }
+
+    // Map and pre-fault enough chunks for n slots beyond those carved so
+    // far; call at startup, before the hot path
+    void reserve(size_t n)
+    {
+        while (chunks.size() * ChunkSize - carved < n)
+        {
+            map_chunks(true);
+        }
+    }
+
+    // Slots in mapped chunks, live or free
+    size_t capacity() const { return chunks.size() * ChunkSize; }
+
+private:
+    // Add at least one chunk; a huge-page mapping is cut into as many as fit
+    HFT_COLD void map_chunks(bool prefault)
+    {
+        if (capacity() + ChunkSize > none)
+        {
+            throw std::bad_alloc(); // Out of 32-bit indices
+        }
+
+        char *data;
+        size_t count = 1;
+        if (arena)
+        {
+            data = static_cast<char *>(arena->allocate(chunk_bytes, cache_line_size));
+            if (!data)
+            {
+                throw std::bad_alloc();
+            }
+        }
+        else
+        {
+            PageMapping mapping = map_pages(chunk_bytes, huge_pages, prefault);
+            mappings.push_back(mapping);
+            data = mapping.data;
+            count = std::min(mapping.bytes / chunk_bytes, (none - capacity()) / ChunkSize);
+        }
+
+        for (size_t i = 0; i < count; ++i, data += chunk_bytes)
+        {
+            chunks.push_back({reinterpret_cast<Hot *>(data), reinterpret_cast<Cold *>(data + hot_bytes)});
+        }
+    }
+};
+
+// Fixed-capacity object pool that any thread may allocate from and free to
+// without a lock.
+//
+// All slots are mapped up front (optionally on 2 MiB pages) and their
+// indices kept on an IndexStack, whose generation-tagged head makes the
+// concurrent pops ABA-safe. Use MemoryPool instead when one thread owns
+// the pool; this one pays a CAS on a shared line for every operation.
+template <typename T>
+class ConcurrentMemoryPool
+{
+private:
+    static constexpr size_t slot_size = (sizeof(T) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    PageMapping mapping;
+    uint32_t slots;
+    IndexStack free_slots;
+
+public:
+    // capacity must be below 2^32 - 1; prefault touches every page now
+    explicit ConcurrentMemoryPool(uint32_t capacity, bool use_huge_pages = false, bool prefault = false)
+        : mapping(map_pages(size_t{capacity} * slot_size, use_huge_pages, prefault)), slots(capacity),
+          free_slots(capacity)
+    {
+        free_slots.fill(0, capacity);
+    }
+
+    ConcurrentMemoryPool(const ConcurrentMemoryPool &) = delete;
+    ConcurrentMemoryPool &operator=(const ConcurrentMemoryPool &) = delete;
+
+    ~ConcurrentMemoryPool() { munmap(mapping.data, mapping.bytes); }
+
+    // Uninitialised storage for one T, or nullptr if every slot is in use;
+    // any thread
+    T *try_allocate()
+    {
+        uint32_t index = free_slots.pop();
+        return index == IndexStack::none ? nullptr : reinterpret_cast<T *>(mapping.data + slot_size * index);
+    }
+
+    // As try_allocate, but throws std::bad_alloc when exhausted
+    T *allocate()
+    {
+        T *slot = try_allocate();
+        if (!slot)
+        {
+            throw std::bad_alloc();
+        }
+        return slot;
+    }
+
+    // Destroy and recycle; any thread
+    void deallocate(T *ptr)
+    {
+        if (ptr)
+        {
+            ptr->~T();
+            free_slots.push(static_cast<uint32_t>((reinterpret_cast<char *>(ptr) - mapping.data) / slot_size));
+        }
+    }
+
+    size_t capacity() const { return slots; }
+};
+
+#ifdef MEMORY_POOL_MAIN
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// The owner allocates and ships nodes to a consumer thread, which frees
+// them remotely; the pool should stop growing once recycling kicks in
+int main()
+{
+    struct Node
+    {
+        uint64_t id;
+        char payload[56];
+    };
+
+    MemoryPool<Node, 1024> pool;
+    pool.reserve(1 << 16);
+    Fifo3<Node *> handoff(1 << 12);
+    const uint64_t count = 5000000;
+
+    std::thread consumer([&]
+                         {
+                             Node *node;
+                             uint64_t seen = 0, sum = 0;
+                             while (seen < count)
+                             {
+                                 if (!handoff.pop(node))
+                                 {
+                                     std::this_thread::yield();
+                                     continue;
+                                 }
+                                 sum += node->id;
+                                 pool.deallocate_remote(node);
+                                 ++seen;
+                             }
+                             std::printf("Consumer freed %lu nodes (checksum %lu)\n", static_cast<unsigned long>(seen),
+                                         static_cast<unsigned long>(sum)); });
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        Node *node = new (pool.allocate()) Node{i, {}};
+        while (!handoff.push(node))
+        {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%lu cross-thread allocate/free pairs in %.3f s, pool capacity %zu slots\n",
+                static_cast<unsigned long>(count), elapsed, pool.capacity());
+    return 0;
+}
+#endif
@@ -0,0 +1,309 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "branch_hints.cpp"
+
+// Order-id indexes for OrderBook. All of them map a uint64_t order id to a
+// T* and share one interface, so the book takes the index as a template
+// parameter:
+//
+//   T *find(id)            nullptr if absent
+//   bool can_insert(id)    id is absent and the index has room for it
+//   bool insert(id, T *)   false, leaving the index unchanged, if id is
+//                          present or cannot be indexed
+//   T *extract(id)         find and remove in one probe; nullptr if absent
+//   void reserve(n)        pre-size for n live entries
+//   void prefetch(id)      hint that id is about to be looked up
+//   size(), for_each(fn(id, T *))
+
+// Reference index on std::unordered_map; allocates a node per insert
+template <typename T>
+class StdOrderIndex
+{
+private:
+    std::unordered_map<uint64_t, T *> map;
+
+public:
+    size_t size() const { return map.size(); }
+    void reserve(size_t n) { map.reserve(n); }
+
+    // Bucket chains are not worth chasing ahead of time
+    void prefetch(uint64_t) const {}
+
+    T *find(uint64_t id) const
+    {
+        auto it = map.find(id);
+        return it == map.end() ? nullptr : it->second;
+    }
+
+    bool can_insert(uint64_t id) const { return !map.contains(id); }
+    bool insert(uint64_t id, T *value) { return map.emplace(id, value).second; }
+
+    T *extract(uint64_t id)
+    {
+        auto it = map.find(id);
+        if (it == map.end())
+        {
+            return nullptr;
+        }
+        T *value = it->second;
+        map.erase(it);
+        return value;
+    }
+
+    template <typename Fn>
+    void for_each(Fn fn) const
+    {
+        for (const auto &[id, value] : map)
+        {
+            fn(id, value);
+        }
+    }
+};
+
+// Flat open-addressing index with linear probing over a power-of-two table.
+// A null value marks an empty slot, and deletes use backward-shift instead
+// of tombstones, so probe sequences never degrade under cancel-heavy flow.
+template <typename T>
+class FlatOrderIndex
+{
+private:
+    struct Slot
+    {
+        uint64_t id;
+        T *value; // nullptr when empty
+    };
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    unsigned shift = 64;
+    size_t count = 0;
+
+    // Fibonacci hashing spreads sequential ids across the table
+    size_t home(uint64_t id) const
+    {
+        return static_cast<size_t>((id * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+
+public:
+    explicit FlatOrderIndex(size_t expected = 1024) { reserve(expected); }
+
+    size_t size() const { return count; }
+
+    // Size the table so n entries stay under the 50% load factor
+    void reserve(size_t n)
+    {
+        size_t capacity = 16;
+        unsigned bits = 4;
+        while (capacity < n * 2)
+        {
+            capacity <<= 1;
+            ++bits;
+        }
+        if (capacity > slots.size())
+        {
+            rehash(capacity, bits);
+        }
+    }
+
+    void prefetch(uint64_t id) const { __builtin_prefetch(&slots[home(id)]); }
+
+    T *find(uint64_t id) const
+    {
+        for (size_t i = home(id);; i = (i + 1) & mask)
+        {
+            const Slot &slot = slots[i];
+            if (!slot.value || slot.id == id)
+            {
+                return slot.value;
+            }
+        }
+    }
+
+    bool can_insert(uint64_t id) const { return !find(id); }
+
+    bool insert(uint64_t id, T *value)
+    {
+        if ((count + 1) * 2 > slots.size()) HFT_UNLIKELY
+        {
+            reserve(count + 1);
+        }
+        size_t i = home(id);
+        while (slots[i].value)
+        {
+            if (slots[i].id == id) HFT_UNLIKELY
+            {
+                return false;
+            }
+            i = (i + 1) & mask;
+        }
+        slots[i] = {id, value};
+        ++count;
+        return true;
+    }
+
+    T *extract(uint64_t id)
+    {
+        size_t i = home(id);
+        while (slots[i].value && slots[i].id != id)
+        {
+            i = (i + 1) & mask;
+        }
+        T *value = slots[i].value;
+        if (!value)
+        {
+            return nullptr;
+        }
+
+        // Backward-shift: pull each following entry of the cluster into the
+        // hole unless that would move it in front of its home slot
+        for (size_t j = (i + 1) & mask; slots[j].value; j = (j + 1) & mask)
+        {
+            size_t k = home(slots[j].id);
+            if (((j - k) & mask) >= ((j - i) & mask))
+            {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i].value = nullptr;
+        --count;
+        return value;
+    }
+
+    template <typename Fn>
+    void for_each(Fn fn) const
+    {
+        for (const Slot &slot : slots)
+        {
+            if (slot.value)
+            {
+                fn(slot.id, slot.value);
+            }
+        }
+    }
+
+private:
+    void place(uint64_t id, T *value)
+    {
+        size_t i = home(id);
+        while (slots[i].value)
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i] = {id, value};
+    }
+
+    HFT_COLD void rehash(size_t capacity, unsigned bits)
+    {
+        std::vector<Slot> old(capacity, Slot{0, nullptr});
+        old.swap(slots);
+        mask = capacity - 1;
+        shift = 64 - bits;
+        for (const Slot &slot : old)
+        {
+            if (slot.value)
+            {
+                place(slot.id, slot.value);
+            }
+        }
+    }
+};
+
+// Direct-indexed table for venues that hand out dense sequential ids:
+// the id minus a base is the slot, so every operation is one array access.
+// Memory is proportional to the id range, not the live count, so ids below
+// base or more than max_slots past it are refused rather than grown into.
+template <typename T>
+class DirectOrderIndex
+{
+private:
+    std::vector<T *> slots;
+    uint64_t base;
+    size_t max_slots;
+    size_t count = 0;
+
+public:
+    static constexpr size_t default_max_slots = size_t{1} << 26; // 512 MiB of pointers
+
+    explicit DirectOrderIndex(uint64_t first_id = 0, size_t expected = 1024, size_t limit = default_max_slots)
+        : slots(std::min(expected, limit), nullptr), base(first_id), max_slots(limit) {}
+
+    size_t size() const { return count; }
+
+    // Ids are expected to be dense from base, so n covers [base, base + n)
+    void reserve(size_t n)
+    {
+        n = std::min(n, max_slots);
+        if (n > slots.size())
+        {
+            slots.resize(n, nullptr);
+        }
+    }
+
+    void prefetch(uint64_t id) const
+    {
+        uint64_t i = id - base;
+        if (i < slots.size())
+        {
+            __builtin_prefetch(&slots[i]);
+        }
+    }
+
+    T *find(uint64_t id) const
+    {
+        uint64_t i = id - base;
+        return i < slots.size() ? slots[i] : nullptr;
+    }
+
+    bool can_insert(uint64_t id) const
+    {
+        uint64_t i = id - base;
+        return id >= base && i < max_slots && (i >= slots.size() || !slots[i]);
+    }
+
+    bool insert(uint64_t id, T *value)
+    {
+        if (!can_insert(id)) HFT_UNLIKELY
+        {
+            return false;
+        }
+        uint64_t i = id - base;
+        if (i >= slots.size()) HFT_UNLIKELY
+        {
+            slots.resize(std::min(std::max<size_t>(slots.size() * 2, i + 1), max_slots), nullptr);
+        }
+        slots[i] = value;
+        ++count;
+        return true;
+    }
+
+    T *extract(uint64_t id)
+    {
+        uint64_t i = id - base;
+        if (i >= slots.size() || !slots[i])
+        {
+            return nullptr;
+        }
+        T *value = slots[i];
+        slots[i] = nullptr;
+        --count;
+        return value;
+    }
+
+    template <typename Fn>
+    void for_each(Fn fn) const
+    {
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            if (slots[i])
+            {
+                fn(base + i, slots[i]);
+            }
+        }
+    }
+};
@@ -1,380 +1,2171 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <map>
-#include <unordered_map>
-#include <list>
 #include <memory>
 #include <iostream>
 #include <iomanip>
 #include <chrono>
 #include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <concepts>
+#include <stdexcept>
+
+#include "branch_hints.cpp"
+#include "price.cpp"
+#include "order_index.cpp"
+#include "latency_histogram.cpp"
+#include "seqlock.cpp"
+#include "memory_pool.cpp"
+#include "../SPSC_QUEUES/spsc_q3.cpp"
+
+// What happens to the part of an order that does not fill on entry
+enum class TimeInForce : uint8_t
+{
+    GoodTillCancel,    // Rests in the book
+    ImmediateOrCancel, // Discarded
+    FillOrKill,        // Whole order rejected unless it can fill completely
+};
 
 // Order structure
 struct Order
 {
     uint64_t order_id;
     bool is_buy;
-    double price;
+    Price price;
     uint64_t quantity;
     uint64_t timestamp_ns;
+    TimeInForce time_in_force = TimeInForce::GoodTillCancel;
+    uint64_t display_quantity = 0; // Iceberg peak size; 0 shows the whole order
 };
 
 // Price level aggregation
 struct PriceLevel
 {
-    double price;
+    Price price;
     uint64_t total_quantity;
 };
 
-// Memory pool for efficient allocation
-template <typename T, size_t BlockSize = 4096>
-class MemoryPool
+// Operation counters of a book since construction
+struct BookStats
+{
+    uint64_t orders;   // Adds accepted
+    uint64_t cancels;
+    uint64_t amends;
+    uint64_t killed;   // IOC remainders and rejected FOKs
+    uint64_t rejected; // Orders refused for their id or price
+    uint64_t trades;
+    uint64_t matches;  // Aggressive orders or amends that traded
+
+    bool operator==(const BookStats &) const = default;
+};
+
+// Execution report for a single fill between an aggressive and a resting order
+struct Trade
+{
+    uint64_t aggressor_id;
+    uint64_t resting_id;
+    bool aggressor_is_buy;
+    Price price; // Always the resting order's price
+    uint64_t quantity;
+    uint64_t timestamp_ns;
+};
+
+// Trade callback as a plain function pointer plus context, so emitting a
+// fill never allocates (unlike std::function with a capturing lambda)
+struct TradeSink
+{
+    void (*on_trade)(void *ctx, const Trade &trade) = nullptr;
+    void *ctx = nullptr;
+
+    void operator()(const Trade &trade) const
+    {
+        if (on_trade)
+        {
+            on_trade(ctx, trade);
+        }
+    }
+};
+
+// Venue rules for whether a quantity-only amend keeps time priority. A
+// price change always sends the order to the back of its new level.
+struct PriorityRules
+{
+    bool reduce_keeps_priority = true;
+    bool increase_keeps_priority = false;
+};
+
+// Tagged operation for BasicOrderBook::process_batch. Cancels use only
+// order.order_id; amends also take order.price and order.quantity.
+enum class OpType : uint8_t
+{
+    Add,
+    Cancel,
+    Amend,
+};
+
+struct BookOp
+{
+    OpType type;
+    Order order;
+
+    static BookOp add(const Order &order) { return {OpType::Add, order}; }
+    static BookOp cancel(uint64_t order_id) { return {OpType::Cancel, {order_id, false, {}, 0, 0}}; }
+    static BookOp amend(uint64_t order_id, Price price, uint64_t quantity, uint64_t timestamp_ns = 0)
+    {
+        return {OpType::Amend, {order_id, false, price, quantity, timestamp_ns}};
+    }
+};
+
+// Back the order pool with 2 MiB pages (-DORDERBOOK_HUGE_PAGES). Falls back
+// to normal pages with a transparent huge page hint if none are reserved.
+// This and ORDERBOOK_LATENCY_STATS only set BookPolicy's defaults.
+#ifdef ORDERBOOK_HUGE_PAGES
+inline constexpr bool orderbook_huge_pages = true;
+#else
+inline constexpr bool orderbook_huge_pages = false;
+#endif
+
+// Per-operation latency histograms, compiled in only with
+// -DORDERBOOK_LATENCY_STATS. The disabled specialisation is empty and its
+// Scope does nothing, so instrumented code compiles to the plain path.
+#ifdef ORDERBOOK_LATENCY_STATS
+inline constexpr bool orderbook_latency_stats = true;
+#else
+inline constexpr bool orderbook_latency_stats = false;
+#endif
+
+template <bool Enabled>
+class OpLatencyStats
 {
 private:
-    struct Block
+    LatencyHistogram histograms[3]; // Indexed by OpType
+
+public:
+    static constexpr bool enabled = true;
+
+    // Times the enclosing operation from construction to destruction
+    class Scope
     {
-        alignas(T) char data[sizeof(T) * BlockSize];
-        Block *next;
+    private:
+        LatencyHistogram &histogram;
+        uint64_t start;
+
+    public:
+        Scope(OpLatencyStats &stats, OpType op)
+            : histogram(stats.histograms[static_cast<size_t>(op)]), start(TscClock::now()) {}
+        ~Scope() { histogram.record(TscClock::now() - start); }
     };
 
-    Block *head_block;
-    std::vector<std::unique_ptr<Block>> blocks;
-    std::vector<T *> free_list;
-    size_t current_index;
+    const LatencyHistogram &histogram(OpType op) const { return histograms[static_cast<size_t>(op)]; }
+
+    void reset()
+    {
+        for (LatencyHistogram &h : histograms)
+        {
+            h.reset();
+        }
+    }
+};
 
+template <>
+class OpLatencyStats<false>
+{
 public:
-    MemoryPool() : head_block(nullptr), current_index(BlockSize)
+    static constexpr bool enabled = false;
+
+    struct Scope
+    {
+        Scope(OpLatencyStats &, OpType) {}
+    };
+
+    const LatencyHistogram &histogram(OpType) const
     {
-        allocate_block();
+        static const LatencyHistogram empty;
+        return empty;
     }
 
-    ~MemoryPool() = default;
+    void reset() {}
+};
+
+// Market-by-price update for one level
+enum class DeltaType : uint8_t
+{
+    NewLevel,
+    Change,
+    RemoveLevel,
+};
+
+struct LevelDelta
+{
+    uint64_t sequence; // Consecutive per book; a gap means deltas were dropped
+    Price price;
+    uint64_t total_quantity; // New aggregate; 0 for RemoveLevel
+    bool is_buy;
+    DeltaType type;
+};
+
+// Preallocated SPSC ring carrying deltas from the book thread to a publisher
+using DeltaQueue = Fifo3<LevelDelta>;
+
+// Top of book as published for other threads: up to Depth levels per side,
+// best first. A side with no levels has count 0.
+template <size_t Depth = 1>
+struct TopOfBook
+{
+    static_assert(Depth > 0, "publish at least the best level");
+
+    uint64_t sequence = 0; // Book snapshot_sequence() when published
+    uint32_t bid_count = 0;
+    uint32_t ask_count = 0;
+    PriceLevel bids[Depth] = {};
+    PriceLevel asks[Depth] = {};
+
+    // Same sentinels as BasicOrderBook::best_bid/best_ask for empty sides
+    PriceLevel best_bid() const { return bid_count ? bids[0] : PriceLevel{Price{}, 0}; }
+    PriceLevel best_ask() const { return ask_count ? asks[0] : PriceLevel{Price::max(), 0}; }
+};
+
+// Cross-thread top-of-book slot written by the book's owning thread
+template <size_t Depth = 1>
+using TopOfBookSlot = Seqlock<TopOfBook<Depth>>;
+
+// Binary image of a book for warm restarts, packed like the replay capture
+// format: a header with the counters, then every resting bid and then every
+// resting ask, each side best level first and each level in FIFO order.
+#pragma pack(push, 1)
+struct BookSnapshotHeader
+{
+    char magic[8];        // "OBSNAPS\0"
+    uint32_t version;     // book_snapshot_version
+    uint32_t record_size; // sizeof(SnapshotOrder)
+    int64_t price_scale;  // Price::scale of the writer
+    uint64_t bid_orders;
+    uint64_t ask_orders;
+    uint64_t total_orders;
+    uint64_t total_cancels;
+    uint64_t total_amends;
+    uint64_t total_killed;
+    uint64_t total_rejected;
+    uint64_t total_trades;
+    uint64_t total_matches;
+    uint64_t total_match_ns;
+    uint64_t max_match_ns;
+    uint64_t delta_sequence;
+    uint64_t dropped_deltas;
+};
+
+struct SnapshotOrder
+{
+    uint64_t order_id;
+    int64_t price;             // Raw Price units
+    uint64_t quantity;         // Displayed
+    uint64_t hidden_quantity;  // Iceberg reserve
+    uint64_t display_quantity; // Iceberg peak size, 0 if not an iceberg
+    uint64_t timestamp_ns;
+};
+#pragma pack(pop)
+
+inline constexpr uint32_t book_snapshot_version = 3;
+inline constexpr char book_snapshot_magic[8] = {'O', 'B', 'S', 'N', 'A', 'P', 'S', '\0'};
+
+struct Level;
+
+// Order fields the add-cancel-match loop never reads: the original
+// timestamp and the iceberg sizes. They sit in the pool's cold array,
+// parallel to the nodes, and are read by icebergs, amends, lookups and
+// snapshots.
+struct OrderDetails
+{
+    uint64_t timestamp_ns;
+    uint64_t display_quantity; // Iceberg peak size, 0 if not an iceberg
+    uint64_t hidden;           // Iceberg reserve not yet shown
+};
+
+// Hot part of a resting order. The FIFO links live inside the node as
+// 32-bit pool indices, so unlinking is O(1) and a node is 48 bytes rather
+// than the 96 of one embedding a whole Order: price comes from the level
+// and a resting order is always good-till-cancel.
+struct OrderNode
+{
+    static constexpr uint32_t none = UINT32_MAX;
+
+    uint64_t order_id = 0;
+    uint64_t quantity = 0;  // Displayed remainder
+    uint64_t queue_seq = 0; // Rises with each enqueue, so lower means further ahead
+    Level *level = nullptr; // Owning price level, so removal needs no price lookup
+    uint32_t index = 0;     // Own pool slot, as named by neighbours' links
+    uint32_t prev = none;
+    uint32_t next = none;
+    bool is_buy = false;
+    bool iceberg = false; // Whether the details hold a peak size and reserve
+};
+
+static_assert(sizeof(OrderNode) == 48 && alignof(OrderNode) == 8, "four nodes per three cache lines");
+static_assert(sizeof(OrderDetails) == 24);
+
+// Node storage for a book: hot nodes and their details in parallel arrays
+template <size_t ChunkSize = 4096>
+using OrderNodePool = IndexedPool<OrderNode, OrderDetails, ChunkSize>;
 
-    T *allocate()
+// Intrusive doubly-linked FIFO of OrderNodes; never allocates. Links are
+// pool indices, so each operation takes the pool that resolves them.
+class OrderQueue
+{
+private:
+    uint32_t head = OrderNode::none;
+    uint32_t tail = OrderNode::none;
+
+public:
+    bool empty() const { return head == OrderNode::none; }
+
+    // Only on a non-empty queue
+    template <typename Nodes>
+    auto *front(Nodes &nodes) const
+    {
+        return nodes.at(head);
+    }
+
+    template <typename Nodes>
+    void push_back(OrderNode *node, Nodes &nodes)
     {
-        if (!free_list.empty())
+        node->prev = tail;
+        node->next = OrderNode::none;
+        if (tail != OrderNode::none)
         {
-            T *ptr = free_list.back();
-            free_list.pop_back();
-            return ptr;
+            nodes.at(tail)->next = node->index;
         }
-
-        if (current_index >= BlockSize)
+        else
         {
-            allocate_block();
+            head = node->index;
         }
+        tail = node->index;
+    }
 
-        return reinterpret_cast<T *>(&head_block->data[sizeof(T) * current_index++]);
+    template <typename Nodes>
+    void pop_front(Nodes &nodes)
+    {
+        erase(nodes.at(head), nodes);
     }
 
-    void deallocate(T *ptr)
+    template <typename Nodes>
+    void erase(OrderNode *node, Nodes &nodes)
     {
-        if (ptr)
+        if (node->prev != OrderNode::none)
+        {
+            nodes.at(node->prev)->next = node->next;
+        }
+        else
+        {
+            head = node->next;
+        }
+        if (node->next != OrderNode::none)
+        {
+            nodes.at(node->next)->prev = node->prev;
+        }
+        else
         {
-            ptr->~T();
-            free_list.push_back(ptr);
+            tail = node->prev;
         }
+        node->prev = node->next = OrderNode::none;
     }
 
-private:
-    void allocate_block()
+    // Visit every order, front of the queue first
+    template <typename Nodes, typename Fn>
+    void for_each(Nodes &nodes, Fn fn) const
     {
-        auto new_block = std::make_unique<Block>();
-        new_block->next = head_block;
-        head_block = new_block.get();
-        blocks.push_back(std::move(new_block));
-        current_index = 0;
+        for (uint32_t index = head; index != OrderNode::none;)
+        {
+            auto *node = nodes.at(index);
+            index = node->next;
+            fn(node);
+        }
     }
 };
 
-// Internal order representation with list iterator for O(1) removal
-struct OrderNode
+// Price level with FIFO order queue
+struct Level
 {
-    Order order;
-    std::list<OrderNode *>::iterator level_iterator;
+    Price price;
+    uint64_t total_quantity;  // Displayed quantity, as published
+    uint64_t hidden_quantity; // Iceberg reserves, executable but not shown
+    uint32_t tracked;         // Orders here followed by track_order
+    OrderQueue orders;        // FIFO queue
 
-    OrderNode(const Order &o) : order(o) {}
+    Level(Price p = {}) : price(p), total_quantity(0), hidden_quantity(0), tracked(0) {}
 };
 
-// Price level with FIFO order queue
-struct Level
+// Configuration for the map backend
+struct MapLevelsConfig
 {
-    double price;
-    uint64_t total_quantity;
-    std::list<OrderNode *> orders; // FIFO queue
-
-    Level(double p) : price(p), total_quantity(0) {}
+    size_t spare_levels = 256; // Tree nodes kept for recycling, per side
 };
 
-class OrderBook
+// Tree-backed side: any price, O(log n) level lookup. Emptied levels are
+// extracted rather than freed and their nodes re-keyed for the next new
+// price, so levels flickering around the touch never reach the heap.
+template <typename Compare>
+class MapSide
 {
 private:
-    // Memory pool for order allocation
-    MemoryPool<OrderNode, 1024> order_pool;
+    using LevelMap = std::map<Price, Level, Compare>;
+
+    LevelMap levels;
+    std::vector<typename LevelMap::node_type> spares;
+    size_t max_spares;
 
-    // Price levels sorted by price (descending for bids, ascending for asks)
-    std::map<double, Level, std::greater<double>> bid_levels; // Highest first
-    std::map<double, Level, std::less<double>> ask_levels;    // Lowest first
+public:
+    using Config = MapLevelsConfig;
 
-    // O(1) order lookup
-    std::unordered_map<uint64_t, OrderNode *> order_lookup;
+    explicit MapSide(const Config &config = {}) : max_spares(config.spare_levels)
+    {
+        // Node handles can only come out of a map, so fill the spares once
+        spares.reserve(max_spares);
+        for (size_t i = 0; i < max_spares; ++i)
+        {
+            levels.try_emplace(levels.end(), Price::from_raw(static_cast<int64_t>(i)));
+        }
+        while (!levels.empty())
+        {
+            spares.push_back(levels.extract(levels.begin()));
+        }
+    }
 
-    // Statistics
-    mutable uint64_t total_orders = 0;
-    mutable uint64_t total_cancels = 0;
-    mutable uint64_t total_amends = 0;
+    bool empty() const { return levels.empty(); }
+    size_t size() const { return levels.size(); }
 
-public:
-    OrderBook() = default;
+    // Whether price a has strictly higher priority than price b on this side
+    bool better(Price a, Price b) const { return levels.key_comp()(a, b); }
 
-    ~OrderBook()
+    // Any price has its own level, and the map grows one node at a time
+    bool on_grid(Price) const { return true; }
+    bool in_reach(Price) const { return true; }
+
+    Level *best() { return levels.empty() ? nullptr : &levels.begin()->second; }
+    const Level *best() const { return levels.empty() ? nullptr : &levels.begin()->second; }
+
+    // nodes resolves queue links, which a map never needs to rewrite
+    template <typename Nodes>
+    Level &get_or_create(Price price, Nodes &)
     {
-        // Clean up all orders
-        for (auto &[id, node] : order_lookup)
+        auto it = levels.lower_bound(price);
+        if (it != levels.end() && it->first == price)
+        {
+            return it->second;
+        }
+        if (spares.empty()) HFT_UNLIKELY
         {
-            order_pool.deallocate(node);
+            return levels.emplace_hint(it, price, price)->second;
         }
+
+        typename LevelMap::node_type node = std::move(spares.back());
+        spares.pop_back();
+        node.key() = price;
+        node.mapped() = Level(price);
+        return levels.insert(it, std::move(node))->second;
     }
 
-    // Insert a new order into the book
-    void add_order(const Order &order)
+    Level *find(Price price)
     {
-        // Allocate new order node from pool
-        OrderNode *node = order_pool.allocate();
-        new (node) OrderNode(order);
+        auto it = levels.find(price);
+        return it == levels.end() ? nullptr : &it->second;
+    }
 
-        // Add to lookup table
-        order_lookup[order.order_id] = node;
+    const Level *find(Price price) const
+    {
+        auto it = levels.find(price);
+        return it == levels.end() ? nullptr : &it->second;
+    }
 
-        // Add to appropriate side
-        if (order.is_buy)
+    // Tree nodes cannot be located without the walk itself
+    void prefetch(Price) const {}
+
+    // Drop a level whose queue has emptied, keeping its node if there is
+    // room among the spares
+    void erase(Level &level)
+    {
+        if (spares.size() < max_spares)
         {
-            add_to_side(bid_levels, node);
+            spares.push_back(levels.extract(level.price));
         }
         else
         {
-            add_to_side(ask_levels, node);
+            levels.erase(level.price);
         }
+    }
 
-        total_orders++;
+    // Visit up to depth levels, best first
+    template <typename Fn>
+    void for_each(size_t depth, Fn fn) const
+    {
+        for (auto it = levels.begin(); it != levels.end() && depth > 0; ++it, --depth)
+        {
+            fn(it->second);
+        }
     }
 
-    // Cancel an existing order by its ID
-    bool cancel_order(uint64_t order_id)
+    // Visit levels best first for as long as fn returns true
+    template <typename Fn>
+    void walk(Fn fn) const
     {
-        auto it = order_lookup.find(order_id);
-        if (it == order_lookup.end())
+        for (auto it = levels.begin(); it != levels.end() && fn(it->second); ++it)
         {
-            return false;
         }
+    }
+};
 
-        OrderNode *node = it->second;
+// Configuration for the tick ladder backend
+struct TickLadderConfig
+{
+    Price tick_size = Price::from_raw(Price::scale / 100);
+    size_t capacity = 4096;                // Levels per side; rounded up to a power of two
+    Price centre = {};                     // Initial window centre; 0 centres on the first order
+    size_t max_capacity = size_t{1} << 20; // Most levels the ring may grow to; likewise rounded
+};
 
-        // Remove from appropriate side
-        if (node->order.is_buy)
+// Flat side for fixed-tick instruments. Prices map to integer ticks (a
+// multiply by the tick size's Reciprocal, not a divide) and each tick to a
+// slot of a contiguous ring of Levels (slot = tick & mask), covering the
+// window [base_tick, base_tick + capacity). A bitmap of non-empty slots
+// finds the next level when the best one empties.
+//
+// Because a tick always lands in the same slot, moving the window centre
+// only changes base_tick; levels are physically moved only when the live
+// range outgrows the ring, which doubles it up to max_capacity. A price
+// that would stretch the live range past that is refused (in_reach), so
+// one far-off order cannot grow the ring without bound.
+template <bool IsBid>
+class TickLadder
+{
+private:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    int64_t tick_size;      // In price units
+    Reciprocal tick_divider; // Price units to ticks without a divide
+    size_t mask;
+    size_t max_slots;
+    int64_t base_tick = 0;
+    int64_t best_tick = 0;
+    size_t count = 0;
+    bool anchored = false;
+    std::vector<Level> slots;
+    std::vector<uint64_t> bitmap;
+
+public:
+    using Config = TickLadderConfig;
+
+    explicit TickLadder(const Config &config = {})
+        : tick_size(config.tick_size.raw), tick_divider(static_cast<uint64_t>(checked_tick(config.tick_size)))
+    {
+        size_t capacity = 64;
+        while (capacity < config.capacity)
         {
-            remove_from_side(bid_levels, node);
+            capacity <<= 1;
         }
-        else
+        mask = capacity - 1;
+        max_slots = capacity;
+        while (max_slots < config.max_capacity)
         {
-            remove_from_side(ask_levels, node);
+            max_slots <<= 1;
         }
+        slots.resize(capacity);
+        bitmap.resize(capacity / 64);
 
-        // Remove from lookup and deallocate
-        order_lookup.erase(it);
-        order_pool.deallocate(node);
-
-        total_cancels++;
-        return true;
+        if (config.centre > Price{})
+        {
+            anchor(to_tick(config.centre));
+        }
     }
 
-    // Amend an existing order's price or quantity
-    bool amend_order(uint64_t order_id, double new_price, uint64_t new_quantity)
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    bool better(Price a, Price b) const { return IsBid ? a > b : a < b; }
+
+    // Whether price is a whole number of ticks. Off-grid prices have no
+    // level: rounding them onto one would move a limit through itself.
+    bool on_grid(Price price) const { return to_tick(price) * tick_size == price.raw; }
+
+    // Whether a level at price fits in the ring together with every live
+    // level without growing it past max_capacity
+    bool in_reach(Price price) const
     {
-        auto it = order_lookup.find(order_id);
-        if (it == order_lookup.end())
+        int64_t tick = to_tick(price);
+        if (count == 0 || in_window(tick))
         {
-            return false;
+            return true;
         }
+        int64_t lo = std::min(tick, find_up(base_tick));
+        int64_t hi = std::max(tick, find_down(top_tick()));
+        return static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo) < max_slots;
+    }
 
-        OrderNode *node = it->second;
+    Level *best() { return count ? &slots[slot(best_tick)] : nullptr; }
+    const Level *best() const { return count ? &slots[slot(best_tick)] : nullptr; }
 
-        // If price changes, treat as cancel + add
-        if (std::abs(node->order.price - new_price) > 1e-9)
+    // nodes resolves queue links, for re-pointing nodes if the ring grows
+    template <typename Nodes>
+    Level &get_or_create(Price price, Nodes &nodes)
+    {
+        int64_t tick = to_tick(price);
+        if (!in_window(tick)) HFT_UNLIKELY
         {
-            Order new_order = node->order;
-            new_order.price = new_price;
-            new_order.quantity = new_quantity;
-            new_order.timestamp_ns = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-
-            cancel_order(order_id);
-            add_order(new_order);
+            recentre(tick, nodes);
         }
-        else
+
+        size_t idx = slot(tick);
+        Level &level = slots[idx];
+        if (!test(idx))
         {
-            // Only quantity changes - update in place
-            if (node->order.is_buy)
-            {
-                update_quantity_in_place(bid_levels, node, new_quantity);
-            }
-            else
+            set(idx);
+            level.price = Price::from_raw(tick * tick_size);
+            if (count++ == 0 || (IsBid ? tick > best_tick : tick < best_tick))
             {
-                update_quantity_in_place(ask_levels, node, new_quantity);
+                best_tick = tick;
             }
         }
+        return level;
+    }
 
-        total_amends++;
-        return true;
+    Level *find(Price price)
+    {
+        int64_t tick = to_tick(price);
+        return in_window(tick) && test(slot(tick)) && on_grid(price) ? &slots[slot(tick)] : nullptr;
     }
 
-    // Get a snapshot of top N bid and ask levels
-    void get_snapshot(size_t depth, std::vector<PriceLevel> &bids, std::vector<PriceLevel> &asks) const
+    const Level *find(Price price) const
     {
-        bids.clear();
-        asks.clear();
+        int64_t tick = to_tick(price);
+        return in_window(tick) && test(slot(tick)) && on_grid(price) ? &slots[slot(tick)] : nullptr;
+    }
+
+    void prefetch(Price price) const
+    {
+        int64_t tick = to_tick(price);
+        if (in_window(tick))
+        {
+            __builtin_prefetch(&slots[slot(tick)]);
+        }
+    }
 
-        // Get top bids
-        size_t count = 0;
-        for (const auto &[price, level] : bid_levels)
+    void erase(Level &level)
+    {
+        size_t idx = static_cast<size_t>(&level - slots.data());
+        clear(idx);
+        if (--count == 0)
         {
-            if (count++ >= depth)
-                break;
-            bids.push_back({price, level.total_quantity});
+            return;
         }
 
-        // Get top asks
-        count = 0;
-        for (const auto &[price, level] : ask_levels)
+        int64_t tick = tick_of(idx);
+        if (tick == best_tick)
         {
-            if (count++ >= depth)
-                break;
-            asks.push_back({price, level.total_quantity});
+            best_tick = IsBid ? find_down(tick - 1) : find_up(tick + 1);
         }
     }
 
-    // Print current state of the order book
-    void print_book(size_t depth = 10) const
+    template <typename Fn>
+    void for_each(size_t depth, Fn fn) const
     {
-        std::vector<PriceLevel> bids, asks;
-        get_snapshot(depth, bids, asks);
-
-        std::cout << "\n========== ORDER BOOK ==========\n";
-        std::cout << std::fixed << std::setprecision(2);
-
-        // Print asks in reverse (highest price first for visual clarity)
-        std::cout << "\n--- ASKS (Sell Orders) ---\n";
-        std::cout << std::setw(12) << "Price" << " | " << std::setw(12) << "Quantity\n";
-        std::cout << "----------------------------\n";
-        for (auto it = asks.rbegin(); it != asks.rend(); ++it)
+        if (count == 0)
         {
-            std::cout << std::setw(12) << it->price << " | "
-                      << std::setw(12) << it->total_quantity << "\n";
+            return;
         }
-
-        // Print spread
-        if (!bids.empty() && !asks.empty())
+        int64_t tick = best_tick;
+        for (size_t n = std::min(depth, count); n > 0; --n)
         {
-            double spread = asks.front().price - bids.front().price;
-            std::cout << "\n   SPREAD: " << spread << "\n";
+            fn(slots[slot(tick)]);
+            if (n > 1)
+            {
+                tick = IsBid ? find_down(tick - 1) : find_up(tick + 1);
+            }
         }
+    }
 
-        // Print bids
-        std::cout << "\n--- BIDS (Buy Orders) ---\n";
-        std::cout << std::setw(12) << "Price" << " | " << std::setw(12) << "Quantity\n";
-        std::cout << "----------------------------\n";
-        for (const auto &level : bids)
+    // Visit levels best first for as long as fn returns true
+    template <typename Fn>
+    void walk(Fn fn) const
+    {
+        int64_t tick = best_tick;
+        for (size_t n = count; n > 0 && fn(slots[slot(tick)]); --n)
         {
-            std::cout << std::setw(12) << level.price << " | "
-                      << std::setw(12) << level.total_quantity << "\n";
+            if (n > 1)
+            {
+                tick = IsBid ? find_down(tick - 1) : find_up(tick + 1);
+            }
         }
-
-        std::cout << "\n================================\n";
-        std::cout << "Total Orders: " << order_lookup.size() << "\n";
-        std::cout << "Bid Levels: " << bid_levels.size() << "\n";
-        std::cout << "Ask Levels: " << ask_levels.size() << "\n";
     }
 
-    // Get best bid and ask prices (for potential matching)
-    std::pair<double, double> get_best_prices() const
+private:
+    static int64_t checked_tick(Price tick)
     {
-        double best_bid = bid_levels.empty() ? 0.0 : bid_levels.begin()->first;
-        double best_ask = ask_levels.empty() ? std::numeric_limits<double>::max() : ask_levels.begin()->first;
-        return {best_bid, best_ask};
+        if (tick.raw <= 0)
+        {
+            throw std::invalid_argument("tick size must be positive");
+        }
+        return tick.raw;
     }
 
-    // Performance statistics
-    void print_stats() const
+    int64_t to_tick(Price price) const { return tick_divider.divide(price.raw); }
+    size_t slot(int64_t tick) const { return static_cast<size_t>(tick) & mask; }
+    size_t capacity() const { return mask + 1; }
+    int64_t top_tick() const { return base_tick + static_cast<int64_t>(mask); }
+    bool in_window(int64_t tick) const { return anchored && tick >= base_tick && tick <= top_tick(); }
+    int64_t tick_of(size_t idx) const
     {
-        std::cout << "\n--- Performance Stats ---\n";
-        std::cout << "Total Orders Added: " << total_orders << "\n";
-        std::cout << "Total Orders Cancelled: " << total_cancels << "\n";
-        std::cout << "Total Orders Amended: " << total_amends << "\n";
+        return base_tick + static_cast<int64_t>((idx - slot(base_tick)) & mask);
     }
 
-private:
-    template <typename MapType>
-    void add_to_side(MapType &side, OrderNode *node)
+    bool test(size_t idx) const { return bitmap[idx >> 6] & (uint64_t{1} << (idx & 63)); }
+    void set(size_t idx) { bitmap[idx >> 6] |= uint64_t{1} << (idx & 63); }
+    void clear(size_t idx) { bitmap[idx >> 6] &= ~(uint64_t{1} << (idx & 63)); }
+
+    void anchor(int64_t centre)
     {
-        auto &level = side[node->order.price];
-        level.price = node->order.price;
-        level.orders.push_back(node);
-        node->level_iterator = std::prev(level.orders.end());
-        level.total_quantity += node->order.quantity;
+        base_tick = centre - static_cast<int64_t>(capacity() / 2);
+        anchored = true;
     }
 
-    template <typename MapType>
-    void remove_from_side(MapType &side, OrderNode *node)
+    // Distance from tick to the first live slot at or above it, looking at
+    // no more than limit slots. Whole bitmap words are skipped at a time.
+    size_t scan_up(int64_t tick, size_t limit) const
     {
-        auto it = side.find(node->order.price);
-        if (it != side.end())
+        size_t dist = 0;
+        size_t pos = slot(tick);
+        while (dist < limit)
         {
-            auto &level = it->second;
-            level.orders.erase(node->level_iterator);
-            level.total_quantity -= node->order.quantity;
-
-            // Remove empty price level
-            if (level.orders.empty())
+            size_t bit = pos & 63;
+            uint64_t word = bitmap[pos >> 6] >> bit;
+            if (word)
             {
-                side.erase(it);
+                size_t found = dist + static_cast<size_t>(__builtin_ctzll(word));
+                return found < limit ? found : npos;
             }
+            dist += 64 - bit;
+            pos = (pos + 64 - bit) & mask;
         }
+        return npos;
     }
 
-    template <typename MapType>
-    void update_quantity_in_place(MapType &side, OrderNode *node, uint64_t new_quantity)
+    // Mirror of scan_up towards lower ticks
+    size_t scan_down(int64_t tick, size_t limit) const
     {
-        auto it = side.find(node->order.price);
-        if (it != side.end())
+        size_t dist = 0;
+        size_t pos = slot(tick);
+        while (dist < limit)
         {
-            auto &level = it->second;
-            level.total_quantity = level.total_quantity - node->order.quantity + new_quantity;
-            node->order.quantity = new_quantity;
+            size_t bit = pos & 63;
+            uint64_t word = bitmap[pos >> 6] << (63 - bit);
+            if (word)
+            {
+                size_t found = dist + static_cast<size_t>(__builtin_clzll(word));
+                return found < limit ? found : npos;
+            }
+            dist += bit + 1;
+            pos = (pos - bit - 1) & mask;
         }
+        return npos;
     }
-};
 
-// Example usage and test harness
-class OrderBookTester
-{
-public:
-    static void run_basic_test()
+    // Lowest live tick >= tick (callers guarantee one exists)
+    int64_t find_up(int64_t tick) const
     {
-        OrderBook book;
-
-        std::cout << "=== Order Book Test ===\n";
+        tick = std::max(tick, base_tick);
+        return tick + static_cast<int64_t>(scan_up(tick, static_cast<size_t>(top_tick() - tick + 1)));
+    }
 
-        // Add some buy orders
-        book.add_order({1001, true, 100.00, 100, 1000000});
-        book.add_order({1002, true, 99.50, 200, 2000000});
-        book.add_order({1003, true, 100.00, 150, 3000000}); // Same price as 1001
-        book.add_order({1004, true, 98.00, 300, 4000000});
+    // Highest live tick <= tick (callers guarantee one exists)
+    int64_t find_down(int64_t tick) const
+    {
+        tick = std::min(tick, top_tick());
+        return tick - static_cast<int64_t>(scan_down(tick, static_cast<size_t>(tick - base_tick + 1)));
+    }
 
-        // Add some sell orders
-        book.add_order({2001, false, 101.00, 100, 5000000});
-        book.add_order({2002, false, 102.00, 200, 6000000});
-        book.add_order({2003, false, 101.00, 150, 7000000}); // Same price as 2001
-        book.add_order({2004, false, 103.50, 300, 8000000});
+    // Move the window so it covers tick as well as every live level,
+    // doubling the ring when they no longer fit
+    template <typename Nodes>
+    HFT_COLD void recentre(int64_t tick, Nodes &nodes)
+    {
+        if (count == 0)
+        {
+            anchor(tick);
+            return;
+        }
+
+        int64_t lo = std::min(tick, find_up(base_tick));
+        int64_t hi = std::max(tick, find_down(top_tick()));
+        while (static_cast<size_t>(hi - lo) >= capacity())
+        {
+            grow(nodes);
+        }
+
+        // Centre on the new tick, clamped so no live level falls outside
+        int64_t span = static_cast<int64_t>(mask);
+        base_tick = std::clamp(tick - span / 2, hi - span, lo);
+    }
+
+    template <typename Nodes>
+    HFT_COLD void grow(Nodes &nodes)
+    {
+        size_t old_capacity = capacity();
+        std::vector<Level> old_slots(old_capacity * 2);
+        std::vector<uint64_t> old_bitmap(old_capacity * 2 / 64);
+        old_slots.swap(slots);
+        old_bitmap.swap(bitmap);
+        int64_t old_base = base_tick;
+        size_t old_mask = mask;
+        mask = old_capacity * 2 - 1;
+
+        for (size_t i = 0; i < old_capacity; ++i)
+        {
+            if (!(old_bitmap[i >> 6] & (uint64_t{1} << (i & 63))))
+            {
+                continue;
+            }
+            int64_t t = old_base + static_cast<int64_t>((i - (static_cast<size_t>(old_base) & old_mask)) & old_mask);
+            size_t idx = slot(t);
+            slots[idx] = std::move(old_slots[i]);
+            set(idx);
+            Level *level = &slots[idx];
+            level->orders.for_each(nodes, [level](OrderNode *node)
+                                   { node->level = level; });
+        }
+    }
+};
+
+// Level backends, selected at compile time through BookPolicy::Levels
+struct MapLevels
+{
+    using Config = MapLevelsConfig;
+    using Bids = MapSide<std::greater<Price>>; // Highest first
+    using Asks = MapSide<std::less<Price>>;    // Lowest first
+};
+
+struct TickLadderLevels
+{
+    using Config = TickLadderConfig;
+    using Bids = TickLadder<true>;
+    using Asks = TickLadder<false>;
+};
+
+// Cached top-N levels of one side. Quantity changes inside the window are
+// patched in place; a level appearing or disappearing inside it marks the
+// cache stale, and only the top N levels are re-read on the next snapshot.
+struct DepthCache
+{
+    std::vector<PriceLevel> levels; // Best first, at most the cached depth
+    bool stale = true;
+};
+
+// Compile-time configuration of a BasicOrderBook. Every choice is a type or
+// a constant, so each combination is its own fully inlined book and the
+// hot path never branches on configuration. A policy for an instrument
+// class derives from BookPolicy and overrides what differs:
+//
+//   struct LiquidFuturesPolicy : BookPolicy<TickLadderLevels, DirectOrderIndex<OrderNode>>
+//   {
+//       using Pool = OrderNodePool<16384>;
+//       static constexpr bool latency_stats = true;
+//   };
+//   using LiquidFuturesBook = BasicOrderBook<LiquidFuturesPolicy>;
+//
+// Side ordering belongs to the level backend (MapSide's Compare,
+// TickLadder's IsBid), which the matching path reaches through better().
+// The price type is the library-wide Price (ORDERBOOK_PRICE_SCALE), since
+// Order, Trade, deltas and snapshots are shared by every book.
+template <typename LevelBackend = MapLevels, typename OrderIndex = FlatOrderIndex<OrderNode>>
+struct BookPolicy
+{
+    using Levels = LevelBackend;              // Bids, Asks and their Config
+    using Index = OrderIndex;                 // Order id -> node (order_index.cpp)
+    using Pool = OrderNodePool<>;             // Nodes and details, owner thread only
+    static constexpr bool huge_pages = orderbook_huge_pages;
+    static constexpr bool latency_stats = orderbook_latency_stats;
+};
+
+template <typename Policy>
+concept OrderBookPolicy = requires(typename Policy::Pool &pool, uint32_t index, Arena &arena) {
+    typename Policy::Levels::Config;
+    typename Policy::Levels::Bids;
+    typename Policy::Levels::Asks;
+    typename Policy::Index;
+    { pool.allocate() } -> std::same_as<uint32_t>;
+    { pool.at(index) } -> std::same_as<OrderNode *>;
+    { pool.cold(index) } -> std::same_as<OrderDetails &>;
+    pool.deallocate(index);
+    pool.reserve(size_t{});
+    pool.set_arena(&arena);
+    { Policy::huge_pages } -> std::convertible_to<bool>;
+    { Policy::latency_stats } -> std::convertible_to<bool>;
+};
+
+template <OrderBookPolicy Policy = BookPolicy<>>
+class BasicOrderBook
+{
+private:
+    using Levels = typename Policy::Levels;
+    using Index = typename Policy::Index;
+
+    // Order nodes and their details, named by 32-bit index
+    typename Policy::Pool order_pool;
+
+    // Price levels in priority order (descending for bids, ascending for asks)
+    typename Levels::Bids bid_levels;
+    typename Levels::Asks ask_levels;
+
+    // O(1) order lookup (see order_index.cpp for the available indexes)
+    Index order_lookup;
+
+    // Receives every fill produced by the matching path
+    TradeSink trade_sink;
+
+    // Incrementally maintained top-of-book view served by get_snapshot.
+    // depth_sequence moves only when a level inside the window changes.
+    size_t cache_depth = 10;
+    mutable DepthCache bid_cache;
+    mutable DepthCache ask_cache;
+    uint64_t depth_sequence = 0;
+
+    // Optional market-by-price stream; nullptr disables it
+    DeltaQueue *delta_queue = nullptr;
+    uint64_t delta_sequence = 0;
+
+    // Levels touched inside process_batch; cache patches and deltas for
+    // them are applied once, with their final state, when the batch ends
+    struct TouchedLevel
+    {
+        Price price;
+        bool is_buy;
+        bool existed_before;
+    };
+    static constexpr size_t batch_chunk = 64;
+    static constexpr size_t index_prefetch_distance = 8;
+    static constexpr size_t node_prefetch_distance = 4;
+    bool in_batch = false;
+    std::vector<TouchedLevel> batch_touched;
+
+    // Orders whose queue position is kept up to date (see track_order).
+    // Expected to be a handful, so lookups scan; levels without one pay a
+    // single branch per change.
+    struct TrackedOrder
+    {
+        uint64_t order_id;
+        OrderNode *node;
+        uint64_t ahead; // Displayed quantity in front of node at its level
+    };
+    std::vector<TrackedOrder> tracked_orders;
+    uint64_t queue_clock = 0;
+
+    PriorityRules priority_rules;
+
+    // Optional seqlock slot refreshed when an outermost operation leaves
+    // the cached window changed; publish_top knows the slot's depth
+    void *top_slot = nullptr;
+    void (*publish_top)(const BasicOrderBook &book, void *slot) = nullptr;
+    uint64_t published_sequence = 0;
+    unsigned mutation_nesting = 0;
+
+    // Marks a public mutation; the outermost one publishes on exit, so
+    // amends and batches never expose their intermediate states
+    class PublishScope
+    {
+    private:
+        BasicOrderBook &book;
+
+    public:
+        explicit PublishScope(BasicOrderBook &b) : book(b) { ++book.mutation_nesting; }
+        ~PublishScope()
+        {
+            if (--book.mutation_nesting == 0 && book.publish_top &&
+                book.published_sequence != book.depth_sequence)
+            {
+                book.published_sequence = book.depth_sequence;
+                book.publish_top(book, book.top_slot);
+            }
+        }
+    };
+
+    // Statistics
+    mutable uint64_t total_orders = 0;
+    mutable uint64_t total_cancels = 0;
+    mutable uint64_t total_amends = 0;
+    mutable uint64_t total_killed = 0; // IOC remainders and rejected FOKs
+    mutable uint64_t total_rejected = 0; // Live or unindexable ids; prices off the grid or out of reach
+    mutable uint64_t total_trades = 0;
+    mutable uint64_t total_matches = 0;
+    mutable uint64_t total_match_ns = 0;
+    mutable uint64_t max_match_ns = 0;
+    mutable uint64_t dropped_deltas = 0;
+    OpLatencyStats<Policy::latency_stats> op_latency;
+
+public:
+    using Config = typename Levels::Config;
+
+    explicit BasicOrderBook(TradeSink sink = {}, const Config &config = {})
+        : order_pool(Policy::huge_pages), bid_levels(config), ask_levels(config), trade_sink(sink)
+    {
+        batch_touched.reserve(batch_chunk * 2);
+    }
+
+    explicit BasicOrderBook(const Config &config) : BasicOrderBook(TradeSink{}, config) {}
+
+    void set_trade_sink(TradeSink sink) { trade_sink = sink; }
+
+    // Publish level changes into queue, which the caller owns and drains.
+    // Deltas are dropped (and counted) when it is full; the sequence still
+    // advances so the consumer sees the gap.
+    void set_delta_queue(DeltaQueue *queue) { delta_queue = queue; }
+
+    // Publish the top Depth levels into slot after every operation that
+    // changes them, for readers on other threads (slot->load()). Widens the
+    // snapshot cache to Depth if needed; nullptr stops publishing.
+    template <size_t Depth>
+    void set_top_slot(TopOfBookSlot<Depth> *slot)
+    {
+        if (slot && cache_depth < Depth)
+        {
+            set_snapshot_depth(Depth);
+        }
+        top_slot = slot;
+        publish_top = slot ? &store_top<Depth> : nullptr;
+        if (slot)
+        {
+            published_sequence = depth_sequence;
+            store_top<Depth>(*this, slot);
+        }
+    }
+
+    // Bytes write_snapshot needs for the current state
+    size_t snapshot_size() const
+    {
+        return sizeof(BookSnapshotHeader) + order_lookup.size() * sizeof(SnapshotOrder);
+    }
+
+    // Serialise every resting order and the counters into out, which may be
+    // a file buffer or a shared-memory region. Returns the bytes written, or
+    // 0 if out is smaller than snapshot_size().
+    size_t write_snapshot(std::span<std::byte> out) const
+    {
+        size_t bytes = snapshot_size();
+        if (out.size() < bytes)
+        {
+            return 0;
+        }
+
+        BookSnapshotHeader header{};
+        std::memcpy(header.magic, book_snapshot_magic, sizeof(book_snapshot_magic));
+        header.version = book_snapshot_version;
+        header.record_size = sizeof(SnapshotOrder);
+        header.price_scale = Price::scale;
+        header.total_orders = total_orders;
+        header.total_cancels = total_cancels;
+        header.total_amends = total_amends;
+        header.total_killed = total_killed;
+        header.total_rejected = total_rejected;
+        header.total_trades = total_trades;
+        header.total_matches = total_matches;
+        header.total_match_ns = total_match_ns;
+        header.max_match_ns = max_match_ns;
+        header.delta_sequence = delta_sequence;
+        header.dropped_deltas = dropped_deltas;
+
+        std::byte *record = out.data() + sizeof(header);
+        header.bid_orders = write_side(bid_levels, record);
+        header.ask_orders = write_side(ask_levels, record + header.bid_orders * sizeof(SnapshotOrder));
+        std::memcpy(out.data(), &header, sizeof(header));
+        return bytes;
+    }
+
+    // Rebuild an empty book from write_snapshot output in one pass: nodes
+    // are carved from the pool in priority order, appended straight onto
+    // their level queues and inserted into a pre-sized index, with no
+    // matching or per-order cache work. No deltas are published; the delta
+    // sequence resumes where the snapshot left it. Returns false, leaving
+    // the book untouched, if it is not empty or in is not a valid snapshot.
+    bool restore_snapshot(std::span<const std::byte> in)
+    {
+        BookSnapshotHeader header;
+        if (order_lookup.size() != 0 || in.size() < sizeof(header))
+        {
+            return false;
+        }
+        std::memcpy(&header, in.data(), sizeof(header));
+        // Each count is checked on its own, since their sum can wrap
+        size_t records = (in.size() - sizeof(header)) / sizeof(SnapshotOrder);
+        if (std::memcmp(header.magic, book_snapshot_magic, sizeof(book_snapshot_magic)) != 0 ||
+            header.version != book_snapshot_version || header.record_size != sizeof(SnapshotOrder) ||
+            header.price_scale != Price::scale || header.bid_orders > records ||
+            header.ask_orders > records - header.bid_orders)
+        {
+            return false;
+        }
+
+        PublishScope publish(*this);
+        const std::byte *record = in.data() + sizeof(header);
+        total_rejected = header.total_rejected; // Records skipped below add to it
+        order_lookup.reserve(header.bid_orders + header.ask_orders);
+        restore_side(bid_levels, true, record, header.bid_orders);
+        restore_side(ask_levels, false, record + header.bid_orders * sizeof(SnapshotOrder), header.ask_orders);
+
+        total_orders = header.total_orders;
+        total_cancels = header.total_cancels;
+        total_amends = header.total_amends;
+        total_killed = header.total_killed;
+        total_trades = header.total_trades;
+        total_matches = header.total_matches;
+        total_match_ns = header.total_match_ns;
+        max_match_ns = header.max_match_ns;
+        delta_sequence = header.delta_sequence;
+        dropped_deltas = header.dropped_deltas;
+
+        bid_cache.stale = ask_cache.stale = true;
+        ++depth_sequence;
+        return true;
+    }
+
+    void set_priority_rules(const PriorityRules &rules) { priority_rules = rules; }
+
+    // Take order-node storage from arena from now on (e.g. huge pages bound
+    // to the book thread's NUMA node); call before reserve and adding orders
+    void set_arena(Arena &arena) { order_pool.set_arena(&arena); }
+
+    // Pre-size the order index and pre-fault pool blocks for the expected
+    // number of live orders, so the session starts without page faults
+    void reserve(size_t orders)
+    {
+        order_lookup.reserve(orders);
+        order_pool.reserve(orders);
+    }
+
+    // Number of levels per side kept in the snapshot cache
+    void set_snapshot_depth(size_t depth)
+    {
+        cache_depth = depth;
+        bid_cache.stale = ask_cache.stale = true;
+        ++depth_sequence;
+    }
+
+    // Changes whenever the cached top-of-book window changes
+    uint64_t snapshot_sequence() const { return depth_sequence; }
+
+    // Number of resting orders
+    size_t order_count() const { return order_lookup.size(); }
+
+    BookStats stats() const
+    {
+        return {total_orders, total_cancels, total_amends, total_killed, total_rejected, total_trades, total_matches};
+    }
+
+    // Resting order by id, if present, reassembled from its node and
+    // details. quantity is the displayed part for icebergs.
+    std::optional<Order> find_order(uint64_t order_id) const
+    {
+        const OrderNode *node = order_lookup.find(order_id);
+        return node ? std::optional<Order>(order_of(node)) : std::nullopt;
+    }
+
+    // Visit the resting orders at one price in queue order
+    template <typename Fn>
+    void for_each_in_queue(bool is_buy, Price price, Fn fn) const
+    {
+        const Level *level = is_buy ? bid_levels.find(price) : ask_levels.find(price);
+        if (level)
+        {
+            level->orders.for_each(order_pool, [&](const OrderNode *node)
+                                   { fn(order_of(node)); });
+        }
+    }
+
+    // Keep order_id's queue position current so queue_ahead answers without
+    // walking the level. Costs one walk of the queue ahead of it now.
+    // Tracking ends when the order fills or is cancelled; a price amend
+    // carries it to the new level. Returns false if it is not resting.
+    bool track_order(uint64_t order_id)
+    {
+        OrderNode *node = order_lookup.find(order_id);
+        if (!node)
+        {
+            return false;
+        }
+        if (find_tracked(node))
+        {
+            return true;
+        }
+        // At the back of the queue everything else at the level is ahead
+        bool last = node->next == OrderNode::none;
+        uint64_t ahead = last ? node->level->total_quantity - node->quantity : 0;
+        for (OrderNode *n = last ? node : node->level->orders.front(order_pool); n != node; n = order_pool.at(n->next))
+        {
+            ahead += n->quantity;
+        }
+        tracked_orders.push_back({order_id, node, ahead});
+        node->level->tracked++;
+        return true;
+    }
+
+    void untrack_order(uint64_t order_id)
+    {
+        OrderNode *node = order_lookup.find(order_id);
+        if (node)
+        {
+            untrack(node);
+        }
+    }
+
+    // Displayed quantity queued in front of a tracked order at its price.
+    // Returns false if order_id is not (or no longer) tracked.
+    bool queue_ahead(uint64_t order_id, uint64_t &ahead) const
+    {
+        for (const TrackedOrder &tracked : tracked_orders)
+        {
+            if (tracked.order_id == order_id)
+            {
+                ahead = tracked.ahead;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Insert a new order into the book, matching it first against the
+    // opposite side with price-time priority. Only a good-till-cancel
+    // remainder rests; an iceberg rests showing at most display_quantity.
+    // Returns false, without trading, if the id is already resting or the
+    // index cannot hold it, or the price is off the level backend's grid or
+    // beyond its reach.
+    bool add_order(const Order &order)
+    {
+        typename decltype(op_latency)::Scope timer(op_latency, OpType::Add);
+        if (!order_lookup.can_insert(order.order_id) || !priceable(order.is_buy, order.price)) HFT_UNLIKELY
+        {
+            total_rejected++;
+            return false;
+        }
+        PublishScope publish(*this);
+        total_orders++;
+
+        // FOK feasibility comes from the level aggregates alone
+        if (order.time_in_force == TimeInForce::FillOrKill &&
+            !(order.is_buy ? can_fill(ask_levels, order) : can_fill(bid_levels, order)))
+        {
+            total_killed++;
+            return true;
+        }
+
+        uint64_t remaining = order.quantity;
+        if (order.is_buy ? crosses(ask_levels, order) : crosses(bid_levels, order))
+        {
+            remaining = match(order);
+        }
+
+        if (remaining == 0)
+        {
+            return true;
+        }
+        if (order.time_in_force != TimeInForce::GoodTillCancel)
+        {
+            total_killed++;
+            return true;
+        }
+
+        // Allocate new order node from pool
+        OrderNode *node = make_node(order);
+        set_remaining(node, remaining);
+
+        // Add to lookup table
+        order_lookup.insert(order.order_id, node);
+
+        // Add to appropriate side
+        if (order.is_buy)
+        {
+            add_to_side(bid_levels, node, order.price);
+        }
+        else
+        {
+            add_to_side(ask_levels, node, order.price);
+        }
+        return true;
+    }
+
+    // Cancel an existing order by its ID
+    bool cancel_order(uint64_t order_id)
+    {
+        typename decltype(op_latency)::Scope timer(op_latency, OpType::Cancel);
+        PublishScope publish(*this);
+
+        // Find and unlink from the index in a single probe
+        OrderNode *node = order_lookup.extract(order_id);
+        if (!node) HFT_UNLIKELY
+        {
+            return false;
+        }
+        if (node->level->tracked)
+        {
+            untrack(node);
+        }
+
+        // Remove from appropriate side
+        if (node->is_buy)
+        {
+            remove_from_side(bid_levels, node);
+        }
+        else
+        {
+            remove_from_side(ask_levels, node);
+        }
+
+        order_pool.deallocate(node->index);
+
+        total_cancels++;
+        return true;
+    }
+
+    // Apply one tagged operation; returns whether it succeeded
+    bool apply(const BookOp &op)
+    {
+        switch (op.type)
+        {
+        case OpType::Add:
+            return add_order(op.order);
+        case OpType::Cancel:
+            return cancel_order(op.order.order_id);
+        case OpType::Amend:
+            return amend_order(op.order.order_id, op.order.price, op.order.quantity, op.order.timestamp_ns);
+        }
+        return false;
+    }
+
+    // Apply a packet of operations in order. Index slots, nodes and ladder
+    // levels for upcoming operations are prefetched while the current one
+    // runs, and repeated changes to the same level are coalesced so the
+    // depth cache and delta stream see one update per level per chunk.
+    // Returns the number of operations that succeeded.
+    size_t process_batch(std::span<const BookOp> ops)
+    {
+        PublishScope publish(*this);
+        size_t applied = 0;
+        in_batch = true;
+
+        for (size_t i = 0; i < ops.size(); ++i)
+        {
+            if (i + index_prefetch_distance < ops.size())
+            {
+                prefetch_slots(ops[i + index_prefetch_distance]);
+            }
+            if (i + node_prefetch_distance < ops.size())
+            {
+                prefetch_node(ops[i + node_prefetch_distance]);
+            }
+
+            applied += apply(ops[i]);
+
+            // Bound the coalescing scan; flushing early only splits updates
+            if (batch_touched.size() >= batch_chunk)
+            {
+                flush_batch();
+            }
+        }
+
+        flush_batch();
+        in_batch = false;
+        return applied;
+    }
+
+    // Amend an existing order's price or quantity (the whole remainder for
+    // an iceberg). The node is moved, not reallocated: a price change puts
+    // it at the back of its new level, and a quantity change keeps or loses
+    // priority per the PriorityRules. An order that loses priority takes
+    // timestamp_ns unless it is 0. An amend that crosses the spread
+    // matches with the same node and rests whatever is left at the new
+    // price. Quantity 0 is a cancel.
+    bool amend_order(uint64_t order_id, Price new_price, uint64_t new_quantity, uint64_t timestamp_ns = 0)
+    {
+        if (new_quantity == 0)
+        {
+            return cancel_order(order_id);
+        }
+        typename decltype(op_latency)::Scope timer(op_latency, OpType::Amend);
+        PublishScope publish(*this);
+
+        OrderNode *node = order_lookup.find(order_id);
+        if (!node) HFT_UNLIKELY
+        {
+            return false;
+        }
+        if (!priceable(node->is_buy, new_price)) HFT_UNLIKELY
+        {
+            total_rejected++;
+            return false;
+        }
+        total_amends++;
+
+        if (node->level->price != new_price)
+        {
+            Order moved = order_of(node);
+            moved.price = new_price;
+            moved.quantity = new_quantity;
+            moved.timestamp_ns = timestamp_ns ? timestamp_ns : moved.timestamp_ns;
+
+            if (moved.is_buy ? crosses(ask_levels, moved) : crosses(bid_levels, moved))
+            {
+                if (moved.is_buy)
+                {
+                    amend_through(bid_levels, node, moved);
+                }
+                else
+                {
+                    amend_through(ask_levels, node, moved);
+                }
+            }
+            else if (moved.is_buy)
+            {
+                move_order(bid_levels, node, moved);
+            }
+            else
+            {
+                move_order(ask_levels, node, moved);
+            }
+            return true;
+        }
+
+        uint64_t remaining = node->quantity + hidden_of(node);
+        bool keeps = new_quantity == remaining ||
+                     (new_quantity < remaining ? priority_rules.reduce_keeps_priority
+                                               : priority_rules.increase_keeps_priority);
+        if (keeps)
+        {
+            update_quantity_in_place(node, new_quantity);
+        }
+        else
+        {
+            requeue(node, new_quantity, timestamp_ns);
+        }
+        return true;
+    }
+
+    // Get a snapshot of top N bid and ask levels. Depths within the cached
+    // window are copied from the cache instead of walking the sides.
+    void get_snapshot(size_t depth, std::vector<PriceLevel> &bids, std::vector<PriceLevel> &asks) const
+    {
+        bids.clear();
+        asks.clear();
+
+        if (depth > cache_depth)
+        {
+            bid_levels.for_each(depth, [&](const Level &level)
+                                { bids.push_back({level.price, level.total_quantity}); });
+            ask_levels.for_each(depth, [&](const Level &level)
+                                { asks.push_back({level.price, level.total_quantity}); });
+            return;
+        }
+
+        refresh_cache(bid_levels, bid_cache);
+        refresh_cache(ask_levels, ask_cache);
+        bids.assign(bid_cache.levels.begin(), bid_cache.levels.begin() + std::min(depth, bid_cache.levels.size()));
+        asks.assign(ask_cache.levels.begin(), ask_cache.levels.begin() + std::min(depth, ask_cache.levels.size()));
+    }
+
+    // Snapshot only if the window changed since last_sequence, which is
+    // updated on copy. Returns false, leaving the outputs untouched, otherwise.
+    bool get_snapshot_if_changed(size_t depth, std::vector<PriceLevel> &bids, std::vector<PriceLevel> &asks,
+                                 uint64_t &last_sequence) const
+    {
+        if (last_sequence == depth_sequence)
+        {
+            return false;
+        }
+        get_snapshot(depth, bids, asks);
+        last_sequence = depth_sequence;
+        return true;
+    }
+
+    // Print current state of the order book
+    void print_book(size_t depth = 10) const
+    {
+        std::vector<PriceLevel> bids, asks;
+        get_snapshot(depth, bids, asks);
+
+        std::cout << "\n========== ORDER BOOK ==========\n";
+        std::cout << std::fixed << std::setprecision(2);
+
+        // Print asks in reverse (highest price first for visual clarity)
+        std::cout << "\n--- ASKS (Sell Orders) ---\n";
+        std::cout << std::setw(12) << "Price" << " | " << std::setw(12) << "Quantity\n";
+        std::cout << "----------------------------\n";
+        for (auto it = asks.rbegin(); it != asks.rend(); ++it)
+        {
+            std::cout << std::setw(12) << it->price.to_double() << " | "
+                      << std::setw(12) << it->total_quantity << "\n";
+        }
+
+        // Print spread
+        if (!bids.empty() && !asks.empty())
+        {
+            double spread = (asks.front().price - bids.front().price).to_double();
+            std::cout << "\n   SPREAD: " << spread << "\n";
+        }
+
+        // Print bids
+        std::cout << "\n--- BIDS (Buy Orders) ---\n";
+        std::cout << std::setw(12) << "Price" << " | " << std::setw(12) << "Quantity\n";
+        std::cout << "----------------------------\n";
+        for (const auto &level : bids)
+        {
+            std::cout << std::setw(12) << level.price.to_double() << " | "
+                      << std::setw(12) << level.total_quantity << "\n";
+        }
+
+        std::cout << "\n================================\n";
+        std::cout << "Total Orders: " << order_lookup.size() << "\n";
+        std::cout << "Bid Levels: " << bid_levels.size() << "\n";
+        std::cout << "Ask Levels: " << ask_levels.size() << "\n";
+    }
+
+    // Get best bid and ask prices (for potential matching)
+    std::pair<Price, Price> get_best_prices() const
+    {
+        Price best_bid = bid_levels.empty() ? Price{} : bid_levels.best()->price;
+        Price best_ask = ask_levels.empty() ? Price::max() : ask_levels.best()->price;
+        return {best_bid, best_ask};
+    }
+
+    // Best level of each side with its aggregate quantity; an empty side
+    // reports the same sentinel price as get_best_prices and no quantity
+    PriceLevel best_bid() const
+    {
+        const Level *level = bid_levels.best();
+        return level ? PriceLevel{level->price, level->total_quantity} : PriceLevel{Price{}, 0};
+    }
+
+    PriceLevel best_ask() const
+    {
+        const Level *level = ask_levels.best();
+        return level ? PriceLevel{level->price, level->total_quantity} : PriceLevel{Price::max(), 0};
+    }
+
+    // Latency distribution of one operation type; always empty unless built
+    // with ORDERBOOK_LATENCY_STATS
+    const LatencyHistogram &latency(OpType op) const { return op_latency.histogram(op); }
+
+    // Start a new measurement interval
+    void reset_latency() { op_latency.reset(); }
+
+    // Performance statistics
+    void print_stats() const
+    {
+        std::cout << "\n--- Performance Stats ---\n";
+        std::cout << "Total Orders Added: " << total_orders << "\n";
+        std::cout << "Total Orders Cancelled: " << total_cancels << "\n";
+        std::cout << "Total Orders Amended: " << total_amends << "\n";
+        std::cout << "Total Orders Killed (IOC/FOK): " << total_killed << "\n";
+        std::cout << "Total Orders Rejected (id/price): " << total_rejected << "\n";
+        std::cout << "Total Trades: " << total_trades << "\n";
+        std::cout << "Total Matches: " << total_matches << "\n";
+        if (total_matches > 0)
+        {
+            std::cout << "Average Match Latency: " << total_match_ns / total_matches << " ns\n";
+            std::cout << "Max Match Latency: " << max_match_ns << " ns\n";
+        }
+        if (delta_queue)
+        {
+            std::cout << "Deltas Published: " << delta_sequence - dropped_deltas << "\n";
+            std::cout << "Deltas Dropped: " << dropped_deltas << "\n";
+        }
+        if constexpr (decltype(op_latency)::enabled)
+        {
+            static const char *const names[] = {"Add", "Cancel", "Amend"};
+            for (OpType op : {OpType::Add, OpType::Cancel, OpType::Amend})
+            {
+                const LatencyHistogram &h = latency(op);
+                if (h.count() == 0)
+                {
+                    continue;
+                }
+                std::cout << names[static_cast<size_t>(op)] << " Latency (ns): n=" << h.count()
+                          << " p50=" << h.percentile_ns(0.50) << " p99=" << h.percentile_ns(0.99)
+                          << " p99.9=" << h.percentile_ns(0.999) << " max=" << h.max_ns() << "\n";
+            }
+        }
+    }
+
+private:
+    // Whether the levels can hold an order on side is_buy at price: on the
+    // tick grid, and close enough to the live levels for the ladder to reach
+    bool priceable(bool is_buy, Price price) const
+    {
+        return bid_levels.on_grid(price) && (is_buy ? bid_levels.in_reach(price) : ask_levels.in_reach(price));
+    }
+
+    // An order crosses when its limit is at or through the opposite best,
+    // i.e. when it does not have strictly better priority than that level.
+    template <typename Side>
+    static bool crosses(const Side &side, const Order &order)
+    {
+        const Level *best = side.best();
+        return best && !side.better(order.price, best->price);
+    }
+
+    // Whether the crossing levels hold enough displayed plus hidden
+    // quantity to fill order completely; never walks an order queue
+    template <typename Side>
+    static bool can_fill(const Side &side, const Order &order)
+    {
+        uint64_t available = 0;
+        side.walk([&](const Level &level)
+                  {
+                      if (side.better(order.price, level.price))
+                      {
+                          return false;
+                      }
+                      available += level.total_quantity + level.hidden_quantity;
+                      return available < order.quantity; });
+        return available >= order.quantity;
+    }
+
+    // Match a crossing order against the opposite side, timing the match;
+    // returns the unfilled quantity
+    uint64_t match(const Order &order)
+    {
+        uint64_t start = TscClock::now();
+        uint64_t remaining = order.is_buy ? match_against(ask_levels, order) : match_against(bid_levels, order);
+        auto elapsed = static_cast<uint64_t>(TscClock::to_ns(TscClock::now() - start));
+        total_matches++;
+        total_match_ns += elapsed;
+        max_match_ns = std::max(max_match_ns, elapsed);
+        return remaining;
+    }
+
+    // Walk the opposite side best level first, each level in FIFO order,
+    // filling against resting orders until the aggressor is exhausted or no
+    // longer crosses. Returns the unfilled quantity.
+    template <typename Side>
+    uint64_t match_against(Side &side, const Order &order)
+    {
+        uint64_t remaining = order.quantity;
+
+        while (remaining > 0 && crosses(side, order))
+        {
+            Level &level = *side.best();
+
+            while (remaining > 0 && !level.orders.empty())
+            {
+                OrderNode *resting = level.orders.front(order_pool);
+                uint64_t fill = std::min(remaining, resting->quantity);
+
+                trade_sink({order.order_id, resting->order_id, order.is_buy,
+                            level.price, fill, order.timestamp_ns});
+                total_trades++;
+
+                remaining -= fill;
+                resting->quantity -= fill;
+                level.total_quantity -= fill;
+                if (level.tracked)
+                {
+                    note_queue_change(level, resting, -static_cast<int64_t>(fill));
+                }
+
+                // Fully filled resting orders leave the book; an iceberg
+                // instead shows its next slice behind the rest of the level
+                if (resting->quantity == 0)
+                {
+                    level.orders.pop_front(order_pool);
+                    uint64_t reserve = hidden_of(resting);
+                    if (reserve > 0)
+                    {
+                        level.hidden_quantity -= reserve;
+                        set_remaining(resting, reserve);
+                        if (TrackedOrder *tracked = level.tracked ? find_tracked(resting) : nullptr)
+                        {
+                            tracked->ahead = level.total_quantity;
+                        }
+                        level.total_quantity += resting->quantity;
+                        level.hidden_quantity += hidden_of(resting);
+                        level.orders.push_back(resting, order_pool);
+                        resting->queue_seq = ++queue_clock;
+                    }
+                    else
+                    {
+                        if (level.tracked)
+                        {
+                            untrack(resting);
+                        }
+                        order_lookup.extract(resting->order_id);
+                        order_pool.deallocate(resting->index);
+                    }
+                }
+            }
+
+            bool emptied = level.orders.empty();
+            note_level_change(!order.is_buy, level.price, level.total_quantity, emptied);
+            if (emptied)
+            {
+                side.erase(level);
+            }
+        }
+
+        return remaining;
+    }
+
+    template <typename Side>
+    void add_to_side(Side &side, OrderNode *node, Price price)
+    {
+        Level &level = side.get_or_create(price, order_pool);
+        bool created = level.orders.empty();
+        level.orders.push_back(node, order_pool);
+        node->level = &level;
+        node->queue_seq = ++queue_clock;
+        level.total_quantity += node->quantity;
+        level.hidden_quantity += hidden_of(node);
+        note_level_change(node->is_buy, level.price, level.total_quantity, created);
+    }
+
+    template <typename Side>
+    void remove_from_side(Side &side, OrderNode *node)
+    {
+        Level &level = *node->level;
+        level.orders.erase(node, order_pool);
+        level.total_quantity -= node->quantity;
+        level.hidden_quantity -= hidden_of(node);
+        if (level.tracked)
+        {
+            note_queue_change(level, node, -static_cast<int64_t>(node->quantity));
+        }
+
+        bool emptied = level.orders.empty();
+        note_level_change(node->is_buy, level.price, level.total_quantity, emptied);
+
+        // Remove empty price level
+        if (emptied)
+        {
+            side.erase(level);
+        }
+    }
+
+    // Unlink node from its level and append it to the level at the amended
+    // price with the amended quantity; index entry and pool slot stay put
+    template <typename Side>
+    void move_order(Side &side, OrderNode *node, const Order &amended)
+    {
+        TrackedOrder *tracked = node->level->tracked ? find_tracked(node) : nullptr;
+        if (tracked)
+        {
+            node->level->tracked--;
+        }
+        remove_from_side(side, node);
+
+        details(node).timestamp_ns = amended.timestamp_ns;
+        set_remaining(node, amended.quantity);
+        add_to_side(side, node, amended.price);
+
+        if (tracked)
+        {
+            tracked->ahead = node->level->total_quantity - node->quantity;
+            node->level->tracked++;
+        }
+    }
+
+    // Amend node to a price that crosses: take it off its level, match it
+    // as the aggressor, and rest any remainder at the amended price with
+    // the same node and index entry. The order counts as amended only, not
+    // cancelled and re-added.
+    template <typename Side>
+    void amend_through(Side &side, OrderNode *node, const Order &amended)
+    {
+        // Tracking is dropped while the node is off the book and matching
+        // may reshuffle tracked_orders; it is taken up again if the order rests
+        bool tracked = node->level->tracked && find_tracked(node);
+        if (tracked)
+        {
+            untrack(node);
+        }
+        remove_from_side(side, node);
+
+        uint64_t remaining = match(amended);
+        if (remaining == 0)
+        {
+            order_lookup.extract(node->order_id);
+            order_pool.deallocate(node->index);
+            return;
+        }
+
+        details(node).timestamp_ns = amended.timestamp_ns;
+        set_remaining(node, remaining);
+        add_to_side(side, node, amended.price);
+        if (tracked)
+        {
+            track_order(node->order_id);
+        }
+    }
+
+    // Send node to the back of its own level with a new quantity. The level
+    // never empties, so this is a plain quantity change to observers.
+    void requeue(OrderNode *node, uint64_t new_quantity, uint64_t timestamp_ns)
+    {
+        Level &level = *node->level;
+        level.orders.erase(node, order_pool);
+        level.total_quantity -= node->quantity;
+        level.hidden_quantity -= hidden_of(node);
+        if (level.tracked)
+        {
+            note_queue_change(level, node, -static_cast<int64_t>(node->quantity));
+        }
+
+        set_remaining(node, new_quantity);
+        if (timestamp_ns)
+        {
+            details(node).timestamp_ns = timestamp_ns;
+        }
+        if (TrackedOrder *tracked = level.tracked ? find_tracked(node) : nullptr)
+        {
+            tracked->ahead = level.total_quantity;
+        }
+        level.orders.push_back(node, order_pool);
+        node->queue_seq = ++queue_clock;
+        level.total_quantity += node->quantity;
+        level.hidden_quantity += hidden_of(node);
+        note_level_change(node->is_buy, level.price, level.total_quantity, false);
+    }
+
+    // For an iceberg new_quantity is the whole remainder, re-split into a
+    // displayed slice and reserve
+    void update_quantity_in_place(OrderNode *node, uint64_t new_quantity)
+    {
+        Level &level = *node->level;
+        uint64_t shown = node->quantity;
+        level.total_quantity -= node->quantity;
+        level.hidden_quantity -= hidden_of(node);
+        set_remaining(node, new_quantity);
+        level.total_quantity += node->quantity;
+        level.hidden_quantity += hidden_of(node);
+        if (level.tracked)
+        {
+            note_queue_change(level, node, static_cast<int64_t>(node->quantity - shown));
+        }
+        note_level_change(node->is_buy, level.price, level.total_quantity, false);
+    }
+
+    // Apply a change of delta displayed units at node to every tracked
+    // order queued behind it at the same level
+    void note_queue_change(const Level &level, const OrderNode *node, int64_t delta)
+    {
+        for (TrackedOrder &tracked : tracked_orders)
+        {
+            if (tracked.node->level == &level && tracked.node->queue_seq > node->queue_seq)
+            {
+                tracked.ahead += static_cast<uint64_t>(delta);
+            }
+        }
+    }
+
+    TrackedOrder *find_tracked(const OrderNode *node)
+    {
+        for (TrackedOrder &tracked : tracked_orders)
+        {
+            if (tracked.node == node)
+            {
+                return &tracked;
+            }
+        }
+        return nullptr;
+    }
+
+    void untrack(OrderNode *node)
+    {
+        if (TrackedOrder *tracked = find_tracked(node))
+        {
+            node->level->tracked--;
+            *tracked = tracked_orders.back();
+            tracked_orders.pop_back();
+        }
+    }
+
+    // Carve a node for order, with its details, ready to be queued
+    OrderNode *make_node(const Order &order)
+    {
+        uint32_t index = order_pool.allocate();
+        OrderNode *node = new (order_pool.at(index)) OrderNode{.order_id = order.order_id,
+                                                               .index = index,
+                                                               .is_buy = order.is_buy,
+                                                               .iceberg = order.display_quantity != 0};
+        order_pool.cold(index) = {order.timestamp_ns, order.display_quantity, 0};
+        return node;
+    }
+
+    OrderDetails &details(const OrderNode *node) { return order_pool.cold(node->index); }
+    const OrderDetails &details(const OrderNode *node) const { return order_pool.cold(node->index); }
+
+    // Iceberg reserve; plain orders never touch their details for it
+    uint64_t hidden_of(const OrderNode *node) const { return node->iceberg ? details(node).hidden : 0; }
+
+    // The resting order as callers see it
+    Order order_of(const OrderNode *node) const
+    {
+        const OrderDetails &d = details(node);
+        return {node->order_id, node->is_buy, node->level->price, node->quantity, d.timestamp_ns,
+                TimeInForce::GoodTillCancel, d.display_quantity};
+    }
+
+    // Split a resting remainder into displayed quantity and reserve
+    void set_remaining(OrderNode *node, uint64_t remaining)
+    {
+        if (!node->iceberg)
+        {
+            node->quantity = remaining;
+            return;
+        }
+        OrderDetails &d = details(node);
+        node->quantity = std::min(d.display_quantity, remaining);
+        d.hidden = remaining - node->quantity;
+    }
+
+    // Keep the depth cache and delta stream in step with a level that
+    // changed quantity, or appeared/disappeared when structural is set
+    void note_level_change(bool is_buy, Price price, uint64_t total_quantity, bool structural)
+    {
+        if (in_batch)
+        {
+            for (const TouchedLevel &touched : batch_touched)
+            {
+                if (touched.price == price && touched.is_buy == is_buy)
+                {
+                    return;
+                }
+            }
+            // First touch creating the level means it was absent before
+            batch_touched.push_back({price, is_buy, !(structural && total_quantity)});
+            return;
+        }
+
+        publish_level_change(is_buy, price, total_quantity, structural);
+    }
+
+    void publish_level_change(bool is_buy, Price price, uint64_t total_quantity, bool structural)
+    {
+        if (delta_queue)
+        {
+            DeltaType type = !structural ? DeltaType::Change
+                                         : (total_quantity ? DeltaType::NewLevel : DeltaType::RemoveLevel);
+            if (!delta_queue->push({++delta_sequence, price, total_quantity, is_buy, type})) HFT_UNLIKELY
+            {
+                dropped_deltas++;
+            }
+        }
+
+        if (is_buy)
+        {
+            patch_cache(bid_levels, bid_cache, price, total_quantity, structural);
+        }
+        else
+        {
+            patch_cache(ask_levels, ask_cache, price, total_quantity, structural);
+        }
+    }
+
+    // Publish the net change of every level touched since the last flush.
+    // Levels created and removed within the batch produce nothing.
+    void flush_batch()
+    {
+        for (const TouchedLevel &touched : batch_touched)
+        {
+            const Level *level = touched.is_buy ? bid_levels.find(touched.price) : ask_levels.find(touched.price);
+            bool exists = level != nullptr;
+            if (exists || touched.existed_before)
+            {
+                publish_level_change(touched.is_buy, touched.price, exists ? level->total_quantity : 0,
+                                     exists != touched.existed_before);
+            }
+        }
+        batch_touched.clear();
+    }
+
+    // Pull in the index slot (and, for adds, the ladder level) an upcoming
+    // operation will touch
+    void prefetch_slots(const BookOp &op) const
+    {
+        order_lookup.prefetch(op.order.order_id);
+        if (op.type == OpType::Add)
+        {
+            if (op.order.is_buy)
+            {
+                bid_levels.prefetch(op.order.price);
+            }
+            else
+            {
+                ask_levels.prefetch(op.order.price);
+            }
+        }
+    }
+
+    // Once its index slot is warm, resolve an upcoming cancel/amend and pull
+    // in the order node itself
+    void prefetch_node(const BookOp &op) const
+    {
+        if (op.type != OpType::Add)
+        {
+            if (const OrderNode *node = order_lookup.find(op.order.order_id))
+            {
+                __builtin_prefetch(node);
+            }
+        }
+    }
+
+    template <typename Side>
+    void patch_cache(const Side &side, DepthCache &cache, Price price, uint64_t total_quantity, bool structural)
+    {
+        // Levels behind a full window cannot change the view
+        if (!cache.stale && cache.levels.size() >= cache_depth && side.better(cache.levels.back().price, price))
+        {
+            return;
+        }
+
+        ++depth_sequence;
+        if (cache.stale)
+        {
+            return;
+        }
+        if (!structural)
+        {
+            for (PriceLevel &cached : cache.levels)
+            {
+                if (cached.price == price)
+                {
+                    cached.total_quantity = total_quantity;
+                    return;
+                }
+            }
+        }
+        cache.stale = true;
+    }
+
+    template <typename Side>
+    uint64_t write_side(const Side &side, std::byte *out) const
+    {
+        uint64_t count = 0;
+        auto write = [&](const OrderNode *node)
+        {
+            const OrderDetails &d = details(node);
+            SnapshotOrder record{node->order_id, node->level->price.raw, node->quantity, hidden_of(node),
+                                 d.display_quantity, d.timestamp_ns};
+            std::memcpy(out + count++ * sizeof(record), &record, sizeof(record));
+        };
+        side.for_each(std::numeric_limits<size_t>::max(), [&](const Level &level)
+                      { level.orders.for_each(order_pool, write); });
+        return count;
+    }
+
+    // Consecutive records at one price belong to one level, already in
+    // FIFO order; the level pointer is only held while the price repeats
+    template <typename Side>
+    void restore_side(Side &side, bool is_buy, const std::byte *records, uint64_t count)
+    {
+        Level *level = nullptr;
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            SnapshotOrder record;
+            std::memcpy(&record, records + i * sizeof(record), sizeof(record));
+            Price price = Price::from_raw(record.price);
+            if (!order_lookup.can_insert(record.order_id) || !side.on_grid(price) || !side.in_reach(price)) HFT_UNLIKELY
+            {
+                total_rejected++;
+                continue; // Duplicate id, or a price this backend cannot hold
+            }
+            if (!level || level->price != price)
+            {
+                level = &side.get_or_create(price, order_pool);
+            }
+
+            OrderNode *node = make_node(Order{record.order_id, is_buy, price, record.quantity, record.timestamp_ns,
+                                              TimeInForce::GoodTillCancel, record.display_quantity});
+            node->quantity = record.quantity;
+            if (node->iceberg)
+            {
+                details(node).hidden = record.hidden_quantity;
+            }
+            level->orders.push_back(node, order_pool);
+            node->level = level;
+            node->queue_seq = ++queue_clock;
+            level->total_quantity += record.quantity;
+            level->hidden_quantity += hidden_of(node);
+            order_lookup.insert(record.order_id, node);
+        }
+    }
+
+    template <size_t Depth>
+    static void store_top(const BasicOrderBook &book, void *slot)
+    {
+        TopOfBook<Depth> top;
+        top.sequence = book.depth_sequence;
+        top.bid_count = copy_top<Depth>(book.bid_levels, book.bid_cache, top.bids);
+        top.ask_count = copy_top<Depth>(book.ask_levels, book.ask_cache, top.asks);
+        static_cast<TopOfBookSlot<Depth> *>(slot)->store(top);
+    }
+
+    // Copy from the cache when it is fresh; otherwise read just Depth
+    // levels rather than rebuilding the whole window
+    template <size_t Depth, typename Side>
+    static uint32_t copy_top(const Side &side, const DepthCache &cache, PriceLevel (&out)[Depth])
+    {
+        uint32_t count = 0;
+        if (!cache.stale)
+        {
+            count = static_cast<uint32_t>(std::min(Depth, cache.levels.size()));
+            std::copy_n(cache.levels.begin(), count, out);
+            return count;
+        }
+        side.for_each(Depth, [&](const Level &level)
+                      { out[count++] = {level.price, level.total_quantity}; });
+        return count;
+    }
+
+    template <typename Side>
+    void refresh_cache(const Side &side, DepthCache &cache) const
+    {
+        if (!cache.stale)
+        {
+            return;
+        }
+        cache.levels.clear();
+        side.for_each(cache_depth, [&](const Level &level)
+                      { cache.levels.push_back({level.price, level.total_quantity}); });
+        cache.stale = false;
+    }
+};
+
+// Default book: std::map levels, any price
+using OrderBook = BasicOrderBook<BookPolicy<MapLevels>>;
+
+// Fixed-tick book: flat tick-indexed ladder, O(1) level access
+using TickOrderBook = BasicOrderBook<BookPolicy<TickLadderLevels>>;
+
+// Fixed-tick book for venues with dense sequential order ids
+using DenseIdTickOrderBook = BasicOrderBook<BookPolicy<TickLadderLevels, DirectOrderIndex<OrderNode>>>;
+
+// Example usage and test harness
+class OrderBookTester
+{
+public:
+    static void run_basic_test()
+    {
+        OrderBook book;
+
+        std::cout << "=== Order Book Test ===\n";
+
+        // Add some buy orders
+        book.add_order({1001, true, 100.00_px, 100, 1000000});
+        book.add_order({1002, true, 99.50_px, 200, 2000000});
+        book.add_order({1003, true, 100.00_px, 150, 3000000}); // Same price as 1001
+        book.add_order({1004, true, 98.00_px, 300, 4000000});
+
+        // Add some sell orders
+        book.add_order({2001, false, 101.00_px, 100, 5000000});
+        book.add_order({2002, false, 102.00_px, 200, 6000000});
+        book.add_order({2003, false, 101.00_px, 150, 7000000}); // Same price as 2001
+        book.add_order({2004, false, 103.50_px, 300, 8000000});
 
         std::cout << "\nInitial Order Book:\n";
         book.print_book();
@@ -386,12 +2177,12 @@ public:
 
         // Test amend (quantity only)
         std::cout << "\nAmending order 1003 quantity to 500...\n";
-        book.amend_order(1003, 100.00, 500);
+        book.amend_order(1003, 100.00_px, 500);
         book.print_book(5);
 
         // Test amend (price change)
         std::cout << "\nAmending order 2001 price to 100.50...\n";
-        book.amend_order(2001, 100.50, 100);
+        book.amend_order(2001, 100.50_px, 100);
         book.print_book(5);
 
         // Get snapshot
@@ -402,24 +2193,768 @@ public:
         std::cout << "Bids: ";
         for (const auto &lvl : bids)
         {
-            std::cout << "[" << lvl.price << ":" << lvl.total_quantity << "] ";
+            std::cout << "[" << lvl.price.to_double() << ":" << lvl.total_quantity << "] ";
         }
         std::cout << "\nAsks: ";
         for (const auto &lvl : asks)
         {
-            std::cout << "[" << lvl.price << ":" << lvl.total_quantity << "] ";
+            std::cout << "[" << lvl.price.to_double() << ":" << lvl.total_quantity << "] ";
         }
         std::cout << "\n";
 
         book.print_stats();
     }
 
-    static void run_performance_test()
+    static void run_matching_test()
+    {
+        struct TradeLog
+        {
+            Trade trades[16];
+            size_t count = 0;
+        } log;
+
+        OrderBook book({[](void *ctx, const Trade &trade)
+                        {
+                            auto *l = static_cast<TradeLog *>(ctx);
+                            if (l->count < 16)
+                                l->trades[l->count++] = trade;
+                        },
+                        &log});
+
+        std::cout << "\n=== Matching Test ===\n";
+
+        book.add_order({2001, false, 101.00_px, 100, 1000000});
+        book.add_order({2002, false, 101.00_px, 150, 2000000}); // Behind 2001 in the queue
+        book.add_order({2003, false, 102.00_px, 200, 3000000});
+        book.add_order({1001, true, 99.00_px, 100, 4000000});
+
+        // Sweeps 2001, 2002 and part of 2003; nothing rests
+        std::cout << "\nBuying 300 @ 102.00...\n";
+        book.add_order({1002, true, 102.00_px, 300, 5000000});
+
+        // Takes the rest of 2003; remaining 150 rests as the new best bid
+        std::cout << "Buying 300 @ 103.00...\n";
+        book.add_order({1003, true, 103.00_px, 300, 6000000});
+
+        std::cout << "\nTrades:\n";
+        for (size_t i = 0; i < log.count; ++i)
+        {
+            const Trade &t = log.trades[i];
+            std::cout << "  " << t.aggressor_id << (t.aggressor_is_buy ? " bought " : " sold ")
+                      << t.quantity << " @ " << t.price.to_double() << " from " << t.resting_id << "\n";
+        }
+
+        book.print_book(5);
+        book.print_stats();
+    }
+
+    // Drive both level backends (and the reference vs flat order index) with
+    // the same flow, including prices far outside the initial ladder window,
+    // and check they agree level by level
+    static void run_order_types_test()
+    {
+        std::cout << "\n=== Order Types Test ===\n";
+
+        // Same script on both backends; fills are logged as (resting id, qty)
+        auto run = [](auto &book)
+        {
+            std::vector<std::pair<uint64_t, uint64_t>> fills;
+            book.set_trade_sink({[](void *ctx, const Trade &trade)
+                                 { static_cast<std::vector<std::pair<uint64_t, uint64_t>> *>(ctx)->push_back(
+                                       {trade.resting_id, trade.quantity}); },
+                                 &fills});
+            bool ok = true;
+            std::vector<PriceLevel> bids, asks;
+
+            // Iceberg of 100 showing 10, a plain 20 behind it, 50 a tick out
+            book.add_order({1, false, 101.00_px, 100, 1, TimeInForce::GoodTillCancel, 10});
+            book.add_order({2, false, 101.00_px, 20, 2});
+            book.add_order({3, false, 101.01_px, 50, 3});
+            book.get_snapshot(1, bids, asks);
+            ok = ok && asks[0].total_quantity == 30;
+
+            // Takes the slice; the refreshed slice queues behind order 2
+            book.add_order({4, true, 101.00_px, 15, 4});
+            book.get_snapshot(1, bids, asks);
+            ok = ok && asks[0].total_quantity == 25;
+
+            // FOK needing more than displayed plus hidden is rejected whole
+            book.add_order({5, true, 101.00_px, 106, 5, TimeInForce::FillOrKill});
+            book.get_snapshot(1, bids, asks);
+            ok = ok && asks[0].total_quantity == 25 && bids.empty();
+
+            // FOK that fits only with the reserve fills completely
+            book.add_order({6, true, 101.00_px, 30, 6, TimeInForce::FillOrKill});
+            book.get_snapshot(1, bids, asks);
+            ok = ok && asks[0].total_quantity == 5 && bids.empty();
+
+            // IOC drains the iceberg at its limit and the rest is discarded
+            book.add_order({7, true, 101.00_px, 100, 7, TimeInForce::ImmediateOrCancel});
+            book.get_snapshot(1, bids, asks);
+            ok = ok && bids.empty() && asks[0].price == 101.01_px && book.order_count() == 1;
+
+            std::vector<std::pair<uint64_t, uint64_t>> expected = {{1, 10}, {2, 5}, {2, 15}, {1, 10}, {1, 5}, {1, 5}};
+            expected.insert(expected.end(), 7, {1, 10});
+            return ok && fills == expected;
+        };
+
+        OrderBook map_book;
+        TickOrderBook tick_book(TickLadderConfig{0.01_px, 64, 100_px});
+        bool ok = run(map_book) && run(tick_book);
+        std::cout << (ok ? "IOC, FOK and iceberg fills match the expected sequence\n"
+                         : "MISMATCH in IOC/FOK/iceberg handling\n");
+    }
+
+    // A second add under a live id must be refused before it can trade, on
+    // every index; the direct index also refuses ids it cannot hold
+    static void run_duplicate_id_test()
+    {
+        std::cout << "\n=== Duplicate Id Test ===\n";
+
+        auto run = [](auto &book)
+        {
+            uint64_t filled = 0;
+            book.set_trade_sink({[](void *ctx, const Trade &trade)
+                                 { *static_cast<uint64_t *>(ctx) += trade.quantity; },
+                                 &filled});
+            bool ok = book.add_order({1, true, 100.00_px, 10, 1});
+            ok = ok && !book.add_order({1, false, 100.00_px, 10, 2}); // Would cross the first
+            ok = ok && filled == 0 && book.order_count() == 1 && book.find_order(1)->quantity == 10;
+            ok = ok && book.cancel_order(1) && !book.cancel_order(1) && book.order_count() == 0;
+            ok = ok && book.add_order({1, false, 100.00_px, 10, 3}); // Free again once gone
+
+            // A refused add does not count as applied in a batch
+            std::vector<BookOp> ops{BookOp::add({2, true, 99.00_px, 10, 4}), BookOp::add({2, true, 99.00_px, 5, 5})};
+            ok = ok && book.process_batch(ops) == 1 && book.order_count() == 2 && book.find_order(2)->quantity == 10;
+            return ok;
+        };
+
+        OrderBook flat_book;
+        BasicOrderBook<BookPolicy<MapLevels, StdOrderIndex<OrderNode>>> std_book;
+        DenseIdTickOrderBook dense_book(TickLadderConfig{0.01_px, 64, 100_px});
+        bool ok = run(flat_book) && run(std_book) && run(dense_book);
+        ok = ok && !dense_book.add_order({uint64_t{1} << 40, true, 99.00_px, 10, 4}) && dense_book.order_count() == 2;
+
+        int a = 0, b = 0;
+        DirectOrderIndex<int> index(100, 16, 1024);
+        ok = ok && !index.insert(50, &a) && index.insert(100, &a) && !index.insert(100, &b) &&
+             index.insert(1123, &b) && !index.insert(1124, &b) && index.size() == 2 && index.find(100) == &a;
+
+        std::cout << (ok ? "Duplicate and out-of-range ids are rejected\n" : "MISMATCH in duplicate id handling\n");
+    }
+
+    // The tick ladder refuses prices between ticks instead of rounding
+    // them onto a level, which could rest or fill an order through its limit
+    static void run_off_tick_test()
+    {
+        std::cout << "\n=== Off-Tick Price Test ===\n";
+
+        uint64_t filled = 0;
+        TickOrderBook book(TickLadderConfig{0.01_px, 64, 100_px});
+        book.set_trade_sink({[](void *ctx, const Trade &trade)
+                             { *static_cast<uint64_t *>(ctx) += trade.quantity; },
+                             &filled});
+        bool ok = book.add_order({1, true, 100.00_px, 10, 1});
+        ok = ok && !book.add_order({2, false, 100.005_px, 10, 2}) && filled == 0; // Would sell below its limit
+        ok = ok && !book.amend_order(1, 99.995_px, 10) && book.find_order(1)->price == 100.00_px;
+        ok = ok && book.add_order({3, false, 100.01_px, 10, 3}) && book.order_count() == 2;
+
+        OrderBook map_book;
+        ok = ok && map_book.add_order({2, false, 100.005_px, 10, 2});
+
+        // A fat-finger price a hundred million ticks out is refused rather
+        // than doubling the ring until it covers it
+        TickOrderBook far_book(TickLadderConfig{0.01_px, 4096, 100_px});
+        ok = ok && far_book.add_order({1, false, 100.01_px, 10, 1});
+        ok = ok && !far_book.add_order({2, false, 1000000.00_px, 10, 2}) && far_book.stats().rejected == 1;
+        ok = ok && far_book.add_order({3, true, 99.99_px, 10, 3});
+        ok = ok && !far_book.amend_order(1, 1000000.00_px, 10) && far_book.find_order(1)->price == 100.01_px;
+        ok = ok && far_book.stats().rejected == 2 && far_book.order_count() == 2;
+
+        bool threw = false;
+        try
+        {
+            TickOrderBook bad(TickLadderConfig{Price{}, 64, 100_px});
+        }
+        catch (const std::invalid_argument &)
+        {
+            threw = true;
+        }
+        ok = ok && threw;
+
+        std::cout << (ok ? "Off-tick and out-of-reach prices are rejected by the tick ladder\n"
+                         : "MISMATCH in off-tick handling\n");
+    }
+
+    static void run_amend_priority_test()
+    {
+        std::cout << "\n=== Amend Priority Test ===\n";
+
+        auto queue = [](const auto &book, Price price)
+        {
+            std::vector<uint64_t> ids;
+            book.for_each_in_queue(true, price, [&](const Order &order)
+                                   { ids.push_back(order.order_id); });
+            return ids;
+        };
+
+        uint64_t filled = 0;
+        OrderBook book({[](void *ctx, const Trade &trade)
+                        { *static_cast<uint64_t *>(ctx) += trade.quantity; },
+                        &filled});
+        book.add_order({1, true, 100.00_px, 10, 1});
+        book.add_order({2, true, 100.00_px, 10, 2});
+        book.add_order({3, true, 100.00_px, 10, 3});
+        book.add_order({9, false, 100.05_px, 10, 4});
+
+        // Default rules: reductions keep priority, increases lose it
+        book.amend_order(1, 100.00_px, 5, 10);
+        book.amend_order(2, 100.00_px, 20, 11);
+        bool ok = queue(book, 100.00_px) == std::vector<uint64_t>{1, 3, 2} && book.find_order(1)->timestamp_ns == 1 &&
+                  book.find_order(2)->timestamp_ns == 11;
+
+        // A venue where increases keep priority too
+        book.set_priority_rules({true, true});
+        book.amend_order(3, 100.00_px, 30, 12);
+        ok = ok && queue(book, 100.00_px) == std::vector<uint64_t>{1, 3, 2};
+
+        // Price changes move the node to the back of the new level
+        book.add_order({4, true, 99.99_px, 10, 5});
+        book.amend_order(1, 99.99_px, 5, 13);
+        ok = ok && queue(book, 99.99_px) == std::vector<uint64_t>{4, 1} && queue(book, 100.00_px).size() == 2 &&
+             book.find_order(1)->timestamp_ns == 13;
+
+        // Amending through the spread trades like a new order, but stays an
+        // amend: no cancel or add is counted
+        BookStats before = book.stats();
+        book.amend_order(4, 100.05_px, 15, 14);
+        BookStats after = book.stats();
+        ok = ok && filled == 10 && book.find_order(4)->quantity == 5 && !book.find_order(9);
+        ok = ok && after.orders == before.orders && after.cancels == before.cancels &&
+             after.amends == before.amends + 1 && after.matches == before.matches + 1;
+
+        // Fully filled by a crossing amend, the order leaves the book
+        book.add_order({10, false, 100.10_px, 5, 15});
+        book.amend_order(4, 100.10_px, 5, 16);
+        ok = ok && filled == 15 && !book.find_order(4) && !book.find_order(10);
+
+        // Amending to quantity 0 cancels rather than leaving an empty order
+        book.amend_order(3, 100.00_px, 0, 17);
+        ok = ok && !book.find_order(3) && book.stats().cancels == after.cancels + 1;
+        book.add_order({11, false, 100.00_px, 100, 18});
+        ok = ok && filled == 35 && book.find_order(11)->quantity == 80; // Only order 2 is left at 100.00
+
+        std::cout << (ok ? "Amends follow the priority rules\n" : "MISMATCH in amend priority handling\n");
+    }
+
+    static void run_queue_position_test()
+    {
+        std::cout << "\n=== Queue Position Test ===\n";
+
+        uint64_t seed = 19;
+        auto next = [&seed]()
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            return seed >> 33;
+        };
+
+        TickOrderBook book(TickLadderConfig{0.01_px, 64, 100_px});
+        std::vector<uint64_t> own;
+        bool consistent = true;
+        uint64_t checks = 0;
+
+        for (uint64_t id = 1; id <= 30000; ++id)
+        {
+            uint64_t action = next() % 10;
+            if (action < 6)
+            {
+                bool is_buy = next() % 2 == 0;
+                Price offset = Price::from_raw(static_cast<int64_t>(next() % 8) * (Price::scale / 100));
+                Price price = is_buy ? 100_px - offset + 0.01_px : 100_px + offset;
+                uint64_t display = next() % 8 == 0 ? 5 : 0;
+                book.add_order({id, is_buy, price, 1 + next() % 50, id, TimeInForce::GoodTillCancel, display});
+                if (next() % 20 == 0 && book.track_order(id))
+                {
+                    own.push_back(id);
+                }
+            }
+            else if (action < 9)
+            {
+                book.cancel_order(1 + next() % id);
+            }
+            else
+            {
+                uint64_t target = next() % 3 == 0 && !own.empty() ? own[next() % own.size()] : 1 + next() % id;
+                Price price = next() % 2 ? 100_px : 100_px - 0.02_px;
+                book.amend_order(target, price, 1 + next() % 50);
+            }
+
+            // Every tracked order must agree with a walk of its queue
+            for (size_t i = 0; i < own.size();)
+            {
+                uint64_t ahead;
+                if (!book.queue_ahead(own[i], ahead))
+                {
+                    own[i] = own.back();
+                    own.pop_back();
+                    continue;
+                }
+                std::optional<Order> order = book.find_order(own[i]);
+                uint64_t walked = 0;
+                bool behind = false;
+                book.for_each_in_queue(order->is_buy, order->price, [&](const Order &queued)
+                                       {
+                                           behind = behind || queued.order_id == order->order_id;
+                                           walked += behind ? 0 : queued.quantity; });
+                consistent = consistent && walked == ahead;
+                ++checks;
+                ++i;
+            }
+        }
+
+        std::cout << (consistent ? "Tracked queue positions match a queue walk"
+                                 : "MISMATCH between tracked queue position and queue walk")
+                  << " (" << checks << " checks)\n";
+    }
+
+    static void run_backend_consistency_test()
+    {
+        // The map book's order nodes come from an arena, the tick book's
+        // from its own pool blocks
+        Arena arena(ArenaConfig{size_t{64} << 20});
+        BasicOrderBook<BookPolicy<MapLevels, StdOrderIndex<OrderNode>>> map_book;
+        map_book.set_arena(arena);
+        const Price tick = 0.01_px;
+        TickOrderBook tick_book(TickLadderConfig{tick, 64, 100_px});
+
+        // The map book walks its levels for depth 20; the tick book serves
+        // the same depth from its incrementally maintained cache
+        tick_book.set_snapshot_depth(20);
+
+        std::cout << "\n=== Backend Consistency Test ===\n";
+
+        uint64_t seed = 42;
+        auto next = [&seed]()
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            return seed >> 33;
+        };
+
+        bool consistent = true;
+        std::vector<PriceLevel> map_bids, map_asks, tick_bids, tick_asks;
+        for (uint64_t id = 1; id <= 20000 && consistent; ++id)
+        {
+            uint64_t action = next() % 10;
+            if (action < 6)
+            {
+                bool is_buy = next() % 2 == 0;
+                // Drift the mid so the ladder has to slide and grow
+                Price mid = 100_px + Price::from_raw(static_cast<int64_t>(id / 2000) * Price::scale);
+                Price offset = Price::from_raw(static_cast<int64_t>(next() % 200) * tick.raw);
+                Price price = is_buy ? mid - offset : mid + tick + offset;
+                Order order{id, is_buy, price, 1 + next() % 100, id};
+                map_book.add_order(order);
+                tick_book.add_order(order);
+            }
+            else if (action < 9)
+            {
+                uint64_t victim = 1 + next() % id;
+                consistent = map_book.cancel_order(victim) == tick_book.cancel_order(victim);
+            }
+            else
+            {
+                uint64_t victim = 1 + next() % id;
+                uint64_t quantity = 1 + next() % 100;
+                consistent = map_book.amend_order(victim, 100_px, quantity) ==
+                             tick_book.amend_order(victim, 100_px, quantity);
+            }
+
+            map_book.get_snapshot(20, map_bids, map_asks);
+            tick_book.get_snapshot(20, tick_bids, tick_asks);
+            consistent = consistent && map_bids.size() == tick_bids.size() && map_asks.size() == tick_asks.size();
+            for (size_t i = 0; consistent && i < map_bids.size(); ++i)
+            {
+                consistent = map_bids[i].price == tick_bids[i].price &&
+                             map_bids[i].total_quantity == tick_bids[i].total_quantity;
+            }
+            for (size_t i = 0; consistent && i < map_asks.size(); ++i)
+            {
+                consistent = map_asks[i].price == tick_asks[i].price &&
+                             map_asks[i].total_quantity == tick_asks[i].total_quantity;
+            }
+        }
+
+        std::cout << (consistent ? "Map and tick ladder books agree\n"
+                                 : "MISMATCH between map and tick ladder books\n");
+    }
+
+    // Rebuild the book on the consumer side purely from deltas and check it
+    // matches a full snapshot of the real book
+    static void run_delta_stream_test()
     {
+        DeltaQueue queue(1 << 16);
         OrderBook book;
+        book.set_delta_queue(&queue);
+
+        std::cout << "\n=== Delta Stream Test ===\n";
+
+        uint64_t seed = 7;
+        auto next = [&seed]()
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            return seed >> 33;
+        };
+
+        std::map<Price, uint64_t> replica_bids, replica_asks;
+        uint64_t expected_sequence = 1;
+        bool consistent = true;
+        LevelDelta delta;
+
+        for (uint64_t id = 1; id <= 5000; ++id)
+        {
+            uint64_t action = next() % 10;
+            if (action < 6)
+            {
+                bool is_buy = next() % 2 == 0;
+                Price offset = Price::from_raw(static_cast<int64_t>(next() % 50) * (Price::scale / 100));
+                // Let a slice of the flow cross so fills show up in the stream
+                Price price = is_buy ? 100_px - offset + 0.05_px : 100_px + offset;
+                book.add_order({id, is_buy, price, 1 + next() % 100, id});
+            }
+            else if (action < 9)
+            {
+                book.cancel_order(1 + next() % id);
+            }
+            else
+            {
+                book.amend_order(1 + next() % id, 100_px, 1 + next() % 100);
+            }
+
+            // Consume on the fly like a publisher thread would
+            while (queue.pop(delta))
+            {
+                consistent = consistent && delta.sequence == expected_sequence++;
+                auto &replica = delta.is_buy ? replica_bids : replica_asks;
+                if (delta.type == DeltaType::RemoveLevel)
+                {
+                    replica.erase(delta.price);
+                }
+                else
+                {
+                    replica[delta.price] = delta.total_quantity;
+                }
+            }
+        }
+
+        std::vector<PriceLevel> bids, asks;
+        book.get_snapshot(std::numeric_limits<size_t>::max(), bids, asks);
+        consistent = consistent && bids.size() == replica_bids.size() && asks.size() == replica_asks.size();
+        auto bid = replica_bids.rbegin();
+        for (size_t i = 0; consistent && i < bids.size(); ++i, ++bid)
+        {
+            consistent = bids[i].price == bid->first && bids[i].total_quantity == bid->second;
+        }
+        auto ask = replica_asks.begin();
+        for (size_t i = 0; consistent && i < asks.size(); ++i, ++ask)
+        {
+            consistent = asks[i].price == ask->first && asks[i].total_quantity == ask->second;
+        }
+
+        std::cout << (consistent ? "Delta replica matches the book\n"
+                                 : "MISMATCH between delta replica and book\n");
+    }
+
+    // Published top of book must always match the book it came from
+    static void run_top_publish_test()
+    {
+        TopOfBookSlot<5> slot;
+        TickOrderBook book(TickLadderConfig{Price::from_raw(Price::scale / 100), 256, 100_px});
+        book.set_top_slot(&slot);
+
+        std::cout << "\n=== Top-of-Book Publish Test ===\n";
+
+        // A reader on another thread must only ever see ordered, uncrossed
+        // levels and a non-decreasing sequence
+        std::atomic<bool> done{false};
+        std::atomic<bool> reader_ok{true};
+        std::thread reader([&]
+                           {
+                               uint64_t last = 0;
+                               while (!done.load(std::memory_order_relaxed))
+                               {
+                                   TopOfBook<5> top = slot.load();
+                                   bool ok = top.sequence >= last && top.bid_count <= 5 && top.ask_count <= 5;
+                                   for (uint32_t i = 1; ok && i < top.bid_count; ++i)
+                                   {
+                                       ok = top.bids[i].price < top.bids[i - 1].price;
+                                   }
+                                   for (uint32_t i = 1; ok && i < top.ask_count; ++i)
+                                   {
+                                       ok = top.asks[i].price > top.asks[i - 1].price;
+                                   }
+                                   ok = ok && !(top.bid_count && top.ask_count && top.bids[0].price >= top.asks[0].price);
+                                   last = top.sequence;
+                                   if (!ok)
+                                   {
+                                       reader_ok.store(false);
+                                   }
+                               } });
+
+        uint64_t seed = 13;
+        auto next = [&seed]()
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            return seed >> 33;
+        };
+
+        bool consistent = true;
+        std::vector<PriceLevel> bids, asks;
+        for (uint64_t id = 1; id <= 20000; ++id)
+        {
+            uint64_t action = next() % 10;
+            if (action < 6)
+            {
+                bool is_buy = next() % 2 == 0;
+                Price offset = Price::from_raw(static_cast<int64_t>(next() % 30) * (Price::scale / 100));
+                Price price = is_buy ? 100_px - offset + 0.02_px : 100_px + offset;
+                book.add_order({id, is_buy, price, 1 + next() % 100, id});
+            }
+            else if (action < 9)
+            {
+                book.cancel_order(1 + next() % id);
+            }
+            else
+            {
+                book.amend_order(1 + next() % id, 100_px - 0.01_px, 1 + next() % 100);
+            }
+
+            // On the owning thread the slot always equals a fresh snapshot
+            TopOfBook<5> top = slot.load();
+            book.get_snapshot(5, bids, asks);
+            consistent = consistent && top.sequence == book.snapshot_sequence() && top.bid_count == bids.size() &&
+                         top.ask_count == asks.size();
+            for (size_t i = 0; consistent && i < bids.size(); ++i)
+            {
+                consistent = top.bids[i].price == bids[i].price && top.bids[i].total_quantity == bids[i].total_quantity;
+            }
+            for (size_t i = 0; consistent && i < asks.size(); ++i)
+            {
+                consistent = top.asks[i].price == asks[i].price && top.asks[i].total_quantity == asks[i].total_quantity;
+            }
+        }
+
+        done.store(true);
+        reader.join();
+
+        std::cout << (consistent && reader_ok.load() ? "Published top of book matches the book\n"
+                                                     : "MISMATCH between published top of book and book\n");
+        std::cout << "Slot stores: " << slot.version() << " for " << book.snapshot_sequence() << " window changes\n";
+    }
+
+    static void run_snapshot_restore_test()
+    {
+        std::cout << "\n=== Snapshot Restore Test ===\n";
+
+        uint64_t seed = 17;
+        auto next = [&seed]()
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            return seed >> 33;
+        };
+
+        OrderBook original;
+        for (uint64_t id = 1; id <= 50000; ++id)
+        {
+            uint64_t action = next() % 10;
+            if (action < 6)
+            {
+                bool is_buy = next() % 2 == 0;
+                Price offset = Price::from_raw(static_cast<int64_t>(next() % 40) * (Price::scale / 100));
+                Price price = is_buy ? 100_px - offset + 0.02_px : 100_px + offset;
+                original.add_order({id, is_buy, price, 1 + next() % 100, id});
+            }
+            else if (action < 9)
+            {
+                original.cancel_order(1 + next() % id);
+            }
+            else
+            {
+                original.amend_order(1 + next() % id, 100_px - 0.01_px, 1 + next() % 100);
+            }
+        }
+        original.add_order({50001, true, 99.00_px, 10, 50001});
+        original.add_order({50001, true, 99.00_px, 10, 50002});                                // Rejected
+        original.add_order({50002, true, 100.00_px, 1000000, 50003, TimeInForce::FillOrKill}); // Killed
+
+        std::vector<std::byte> image(original.snapshot_size());
+        size_t written = original.write_snapshot(image);
+
+        // Restore into the other backend too; the image is backend-neutral
+        OrderBook restored;
+        TickOrderBook restored_tick(TickLadderConfig{0.01_px, 64, 100_px});
+        auto start = std::chrono::high_resolution_clock::now();
+        bool ok = written == image.size() && restored.restore_snapshot(image);
+        auto restore_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::high_resolution_clock::now() - start)
+                              .count();
+        ok = ok && restored_tick.restore_snapshot(image) && !restored.restore_snapshot(image);
+        ok = ok && original.stats().killed == 1 && original.stats().rejected == 1 &&
+             restored.stats() == original.stats() && restored_tick.stats() == original.stats();
+
+        // Counts whose sum wraps past the image size are refused
+        std::vector<std::byte> corrupt = image;
+        uint64_t wrapping = uint64_t{1} << 63;
+        std::memcpy(corrupt.data() + offsetof(BookSnapshotHeader, bid_orders), &wrapping, sizeof(wrapping));
+        std::memcpy(corrupt.data() + offsetof(BookSnapshotHeader, ask_orders), &wrapping, sizeof(wrapping));
+        OrderBook rejected;
+        ok = ok && !rejected.restore_snapshot(corrupt) && rejected.order_count() == 0;
+
+        std::vector<PriceLevel> bids, asks, restored_bids, restored_asks, tick_bids, tick_asks;
+        original.get_snapshot(std::numeric_limits<size_t>::max(), bids, asks);
+        restored.get_snapshot(std::numeric_limits<size_t>::max(), restored_bids, restored_asks);
+        restored_tick.get_snapshot(std::numeric_limits<size_t>::max(), tick_bids, tick_asks);
+        auto same = [](const std::vector<PriceLevel> &a, const std::vector<PriceLevel> &b)
+        {
+            return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const PriceLevel &x, const PriceLevel &y)
+                              { return x.price == y.price && x.total_quantity == y.total_quantity; });
+        };
+        ok = ok && same(bids, restored_bids) && same(asks, restored_asks) && same(bids, tick_bids) &&
+             same(asks, tick_asks);
+
+        // Sweeping both sides must fill resting orders in the same FIFO order
+        auto sweep = [&](auto &book)
+        {
+            std::vector<uint64_t> fills;
+            book.set_trade_sink({[](void *ctx, const Trade &trade)
+                                 { static_cast<std::vector<uint64_t> *>(ctx)->push_back(trade.resting_id); },
+                                 &fills});
+            uint64_t ask_total = 0, bid_total = 0;
+            for (const PriceLevel &level : asks)
+                ask_total += level.total_quantity;
+            for (const PriceLevel &level : bids)
+                bid_total += level.total_quantity;
+            book.add_order({1000001, true, asks.empty() ? 100_px : asks.back().price, ask_total, 0});
+            book.add_order({1000002, false, bids.empty() ? 100_px : bids.back().price, bid_total, 0});
+            return fills;
+        };
+        std::vector<uint64_t> original_fills = sweep(original);
+        ok = ok && original_fills == sweep(restored) && original_fills == sweep(restored_tick);
+
+        std::cout << "Restored " << written / 1024 << " KiB (" << original_fills.size() << " fills to sweep) in "
+                  << restore_us << " us\n";
+        std::cout << (ok ? "Restored books match the original\n" : "MISMATCH between restored and original book\n");
+    }
+
+    // Apply the same flow one call at a time and in packets through
+    // process_batch; books must agree and the coalesced delta stream must
+    // still rebuild the batched book
+    static void run_batch_test()
+    {
+        std::cout << "\n=== Batch API Test ===\n";
+
+        uint64_t seed = 11;
+        auto next = [&seed]()
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            return seed >> 33;
+        };
+
+        std::vector<BookOp> ops;
+        for (uint64_t id = 1; id <= 200000; ++id)
+        {
+            uint64_t action = next() % 10;
+            if (action < 5)
+            {
+                bool is_buy = next() % 2 == 0;
+                Price offset = Price::from_raw(static_cast<int64_t>(next() % 20) * (Price::scale / 100));
+                Price price = is_buy ? 100_px - offset + 0.02_px : 100_px + offset;
+                ops.push_back(BookOp::add({id, is_buy, price, 1 + next() % 100, id}));
+            }
+            else if (action < 9)
+            {
+                ops.push_back(BookOp::cancel(1 + next() % id));
+            }
+            else
+            {
+                ops.push_back(BookOp::amend(1 + next() % id, 100_px, 1 + next() % 100));
+            }
+        }
+
+        TickOrderBook single(TickLadderConfig{0.01_px, 256, 100_px});
+        TickOrderBook batched(TickLadderConfig{0.01_px, 256, 100_px});
+        DeltaQueue queue(1 << 12);
+        batched.set_delta_queue(&queue);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const BookOp &op : ops)
+        {
+            if (op.type == OpType::Add)
+                single.add_order(op.order);
+            else if (op.type == OpType::Cancel)
+                single.cancel_order(op.order.order_id);
+            else
+                single.amend_order(op.order.order_id, op.order.price, op.order.quantity);
+        }
+        auto single_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::high_resolution_clock::now() - start)
+                             .count();
+
+        std::map<Price, uint64_t> replica_bids, replica_asks;
+        LevelDelta delta;
+        const size_t packet = 32;
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < ops.size(); i += packet)
+        {
+            batched.process_batch(std::span<const BookOp>(ops).subspan(i, std::min(packet, ops.size() - i)));
+            while (queue.pop(delta))
+            {
+                auto &replica = delta.is_buy ? replica_bids : replica_asks;
+                if (delta.type == DeltaType::RemoveLevel)
+                    replica.erase(delta.price);
+                else
+                    replica[delta.price] = delta.total_quantity;
+            }
+        }
+        auto batched_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::high_resolution_clock::now() - start)
+                              .count();
+
+        std::vector<PriceLevel> single_bids, single_asks, batched_bids, batched_asks;
+        single.get_snapshot(std::numeric_limits<size_t>::max(), single_bids, single_asks);
+        batched.get_snapshot(std::numeric_limits<size_t>::max(), batched_bids, batched_asks);
+
+        bool consistent = single_bids.size() == batched_bids.size() && single_asks.size() == batched_asks.size() &&
+                          batched_bids.size() == replica_bids.size() && batched_asks.size() == replica_asks.size();
+        auto bid = replica_bids.rbegin();
+        for (size_t i = 0; consistent && i < batched_bids.size(); ++i, ++bid)
+        {
+            consistent = single_bids[i].price == batched_bids[i].price &&
+                         single_bids[i].total_quantity == batched_bids[i].total_quantity &&
+                         bid->first == batched_bids[i].price && bid->second == batched_bids[i].total_quantity;
+        }
+        auto ask = replica_asks.begin();
+        for (size_t i = 0; consistent && i < batched_asks.size(); ++i, ++ask)
+        {
+            consistent = single_asks[i].price == batched_asks[i].price &&
+                         single_asks[i].total_quantity == batched_asks[i].total_quantity &&
+                         ask->first == batched_asks[i].price && ask->second == batched_asks[i].total_quantity;
+        }
+
+        std::cout << (consistent ? "Batched book matches single-op book and its delta replica\n"
+                                 : "MISMATCH in batch processing\n");
+        std::cout << "Single ops: " << single_us << " us, batched (packets of " << packet
+                  << ", with deltas): " << batched_us << " us for " << ops.size() << " ops\n";
+    }
+
+    template <typename Book = OrderBook>
+    static void run_performance_test(const char *name = "std::map levels",
+                                     const typename Book::Config &config = {})
+    {
+        Book book(config);
         const int num_orders = 100000;
+        book.reserve(num_orders);
 
-        std::cout << "\n=== Performance Test ===\n";
+        std::cout << "\n=== Performance Test (" << name << ") ===\n";
         std::cout << "Adding " << num_orders << " orders...\n";
 
         auto start = std::chrono::high_resolution_clock::now();
@@ -427,8 +2962,9 @@ public:
         // Add orders
         for (int i = 0; i < num_orders; ++i)
         {
-            double price = 95.0 + (i % 100) * 0.1;
+            // Keep the sides apart so the book builds depth instead of matching
             bool is_buy = i % 2 == 0;
+            Price price = (is_buy ? 95_px : 100_px) + Price::from_raw((i % 50) * (Price::scale / 10));
             book.add_order({static_cast<uint64_t>(i), is_buy, price, 100, static_cast<uint64_t>(i)});
         }
 
@@ -453,6 +2989,20 @@ public:
         std::cout << "Time for 1000 snapshots: " << duration.count() << " microseconds\n";
         std::cout << "Average per snapshot: "
                   << duration.count() / 1000.0 << " microseconds\n";
+
+        // Polling an unchanged book only compares sequence numbers
+        uint64_t last_sequence = 0;
+        size_t copies = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < 1000; ++i)
+        {
+            copies += book.get_snapshot_if_changed(10, bids, asks, last_sequence);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+        std::cout << "Time for 1000 change polls: " << duration.count() << " microseconds ("
+                  << copies << " copied)\n";
     }
 };
 
@@ -461,7 +3011,23 @@ public:
 int main()
 {
     OrderBookTester::run_basic_test();
-    OrderBookTester::run_performance_test();
+    OrderBookTester::run_matching_test();
+    OrderBookTester::run_order_types_test();
+    OrderBookTester::run_queue_position_test();
+    OrderBookTester::run_amend_priority_test();
+    OrderBookTester::run_duplicate_id_test();
+    OrderBookTester::run_off_tick_test();
+    OrderBookTester::run_backend_consistency_test();
+    OrderBookTester::run_delta_stream_test();
+    OrderBookTester::run_batch_test();
+    OrderBookTester::run_top_publish_test();
+    OrderBookTester::run_snapshot_restore_test();
+    OrderBookTester::run_performance_test<BasicOrderBook<BookPolicy<MapLevels, StdOrderIndex<OrderNode>>>>(
+        "std::map levels, std::unordered_map index");
+    OrderBookTester::run_performance_test<OrderBook>();
+    OrderBookTester::run_performance_test<TickOrderBook>("tick ladder", TickLadderConfig{0.1_px, 256, 100_px});
+    OrderBookTester::run_performance_test<DenseIdTickOrderBook>("tick ladder, direct index",
+                                                                TickLadderConfig{0.1_px, 256, 100_px});
     return 0;
 }
 #endif
\ No newline at end of file
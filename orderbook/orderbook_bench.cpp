@@ -0,0 +1,322 @@
+// Order-flow benchmark for OrderBook.
+//
+// Prefills a book to a given depth, warms it up, then drives a configurable
+// mix of cancels, adds and amends whose prices cluster around the touch.
+// Every operation is timed individually with the TSC, so the generator's
+// own bookkeeping is excluded from the reported figures.
+//
+//   orderbook_bench [--mix CANCEL/ADD/AMEND] [--ops N] [--warmup N]
+//                   [--depths 10,100,...] [--cluster TICKS] [--aggressive PCT]
+//                   [--orders-per-level N] [--backend map|tick|all]
+//
+// Defaults: --mix 60/30/10 --ops 1000000 --warmup 100000
+//           --depths 10,100,1000,10000,100000 --cluster 4 --aggressive 2
+//           --orders-per-level 4 --backend all
+
+#include "orderbook.cpp"
+
+#include <cstdlib>
+#include <string>
+#include <cstdio>
+
+struct BenchConfig
+{
+    unsigned cancel_pct = 60;
+    unsigned add_pct = 30;
+    unsigned amend_pct = 10;
+    uint64_t ops = 1000000;
+    uint64_t warmup = 100000;
+    std::vector<size_t> depths = {10, 100, 1000, 10000, 100000};
+    double cluster_ticks = 4.0; // Mean distance from the touch for new prices
+    unsigned aggressive_pct = 2; // Share of adds priced through the touch
+    unsigned orders_per_level = 4;
+    std::string backend = "all";
+};
+
+// Deterministic generator (splitmix64)
+class BenchRng
+{
+private:
+    uint64_t state;
+
+public:
+    explicit BenchRng(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    double uniform() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+    uint64_t below(uint64_t n) { return next() % n; }
+
+    // Geometric distance from the touch with the given mean, capped
+    uint64_t distance(double mean, uint64_t cap)
+    {
+        double d = -std::log(1.0 - uniform()) * mean;
+        return std::min<uint64_t>(static_cast<uint64_t>(d), cap - 1);
+    }
+};
+
+// Drives one book and tracks its live orders (via the trade sink) so
+// cancels and amends always target resting ids
+template <typename Book>
+class FlowDriver
+{
+private:
+    struct LiveOrder
+    {
+        Price price;
+        uint64_t quantity; // 0 when not resting
+        bool is_buy;
+        uint32_t slot; // Position in live_ids
+    };
+
+    static constexpr int64_t mid_ticks = 1000000;
+    static constexpr int64_t tick = Price::scale / 100;
+
+    const BenchConfig &config;
+    size_t depth;
+    Book book;
+    BenchRng rng;
+    std::vector<LiveOrder> orders; // Indexed by order id
+    std::vector<uint64_t> live_ids;
+    uint64_t next_id = 1;
+    uint64_t aggressor_filled = 0;
+
+    LatencyHistogram histograms[3];
+    uint64_t counts[3] = {};
+    uint64_t busy_ticks = 0;
+
+public:
+    FlowDriver(const BenchConfig &cfg, size_t levels, const typename Book::Config &book_config)
+        : config(cfg), depth(levels), book(book_config), rng(levels * 7919 + 1)
+    {
+        book.set_trade_sink({[](void *ctx, const Trade &trade)
+                             { static_cast<FlowDriver *>(ctx)->on_trade(trade); },
+                             this});
+        size_t expected = depth * config.orders_per_level * 2;
+        book.reserve(expected * 2);
+        orders.reserve(expected + config.ops + config.warmup + 1);
+        orders.push_back({});
+        live_ids.reserve(expected * 2);
+    }
+
+    void prefill()
+    {
+        for (size_t level = 0; level < depth; ++level)
+        {
+            for (unsigned n = 0; n < config.orders_per_level; ++n)
+            {
+                add(true, price_at(true, level), 1 + rng.below(100));
+                add(false, price_at(false, level), 1 + rng.below(100));
+            }
+        }
+    }
+
+    void run(uint64_t ops, bool measure)
+    {
+        size_t target = depth * config.orders_per_level * 2;
+        unsigned total_pct = config.cancel_pct + config.add_pct + config.amend_pct;
+        for (uint64_t i = 0; i < ops; ++i)
+        {
+            uint64_t roll = rng.below(total_pct);
+            OpType op = roll < config.cancel_pct                    ? OpType::Cancel
+                        : roll < config.cancel_pct + config.add_pct ? OpType::Add
+                                                                    : OpType::Amend;
+            // Keep the book near its target depth under cancel-heavy mixes
+            if (op != OpType::Add && live_ids.size() < target / 2)
+            {
+                op = OpType::Add;
+            }
+
+            uint64_t ticks = 0;
+            switch (op)
+            {
+            case OpType::Add:
+            {
+                bool is_buy = rng.below(2) == 0;
+                bool aggressive = rng.below(100) < config.aggressive_pct;
+                Price price = aggressive ? price_at(!is_buy, rng.distance(config.cluster_ticks, 3))
+                                         : price_at(is_buy, rng.distance(config.cluster_ticks, depth));
+                ticks = add(is_buy, price, 1 + rng.below(100));
+                break;
+            }
+            case OpType::Cancel:
+            {
+                uint64_t id = live_ids[rng.below(live_ids.size())];
+                uint64_t start = TscClock::now();
+                book.cancel_order(id);
+                ticks = TscClock::now() - start;
+                forget(id);
+                break;
+            }
+            case OpType::Amend:
+            {
+                uint64_t id = live_ids[rng.below(live_ids.size())];
+                LiveOrder &order = orders[id];
+                uint64_t quantity = 1 + rng.below(100);
+                // Most amends are quantity-only; the rest move the price
+                Price price = rng.below(10) < 7 ? order.price
+                                                : price_at(order.is_buy, rng.distance(config.cluster_ticks, depth));
+                uint64_t start = TscClock::now();
+                book.amend_order(id, price, quantity);
+                ticks = TscClock::now() - start;
+                order.price = price;
+                order.quantity = quantity;
+                break;
+            }
+            }
+
+            if (measure)
+            {
+                histograms[static_cast<size_t>(op)].record(ticks);
+                counts[static_cast<size_t>(op)]++;
+                busy_ticks += ticks;
+            }
+        }
+    }
+
+    void report(const char *backend) const
+    {
+        uint64_t total = counts[0] + counts[1] + counts[2];
+        double busy_ns = TscClock::to_ns(busy_ticks);
+
+        std::printf("%-6s depth %-7zu %6.2f Mops/s  live %-8zu", backend, depth,
+                    busy_ns > 0 ? static_cast<double>(total) / busy_ns * 1e3 : 0.0, live_ids.size());
+        static const char *const names[] = {"add", "cancel", "amend"};
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const LatencyHistogram &h = histograms[i];
+            std::printf("  %s n=%lu p50=%.0f p99=%.0f p99.9=%.0f max=%.0f", names[i],
+                        static_cast<unsigned long>(counts[i]), h.percentile_ns(0.50), h.percentile_ns(0.99),
+                        h.percentile_ns(0.999), h.max_ns());
+        }
+        std::printf("  (ns)\n");
+    }
+
+private:
+    Price price_at(bool is_buy, uint64_t distance) const
+    {
+        int64_t ticks = is_buy ? mid_ticks - 1 - static_cast<int64_t>(distance)
+                               : mid_ticks + 1 + static_cast<int64_t>(distance);
+        return Price::from_raw(ticks * tick);
+    }
+
+    uint64_t add(bool is_buy, Price price, uint64_t quantity)
+    {
+        uint64_t id = next_id++;
+        orders.push_back({price, quantity, is_buy, 0});
+        aggressor_filled = 0;
+
+        uint64_t start = TscClock::now();
+        book.add_order({id, is_buy, price, quantity, id});
+        uint64_t ticks = TscClock::now() - start;
+
+        if (aggressor_filled < quantity)
+        {
+            orders[id].quantity = quantity - aggressor_filled;
+            orders[id].slot = static_cast<uint32_t>(live_ids.size());
+            live_ids.push_back(id);
+        }
+        return ticks;
+    }
+
+    void on_trade(const Trade &trade)
+    {
+        aggressor_filled += trade.quantity;
+        LiveOrder &resting = orders[trade.resting_id];
+        resting.quantity -= trade.quantity;
+        if (resting.quantity == 0)
+        {
+            forget(trade.resting_id);
+        }
+    }
+
+    void forget(uint64_t id)
+    {
+        uint32_t slot = orders[id].slot;
+        uint64_t moved = live_ids.back();
+        live_ids[slot] = moved;
+        orders[moved].slot = slot;
+        live_ids.pop_back();
+        orders[id].quantity = 0;
+    }
+};
+
+template <typename Book>
+void run_scenario(const BenchConfig &config, const char *name, size_t depth, const typename Book::Config &book_config)
+{
+    FlowDriver<Book> driver(config, depth, book_config);
+    driver.prefill();
+    driver.run(config.warmup, false);
+    driver.run(config.ops, true);
+    driver.report(name);
+}
+
+static std::vector<size_t> parse_list(const char *arg)
+{
+    std::vector<size_t> values;
+    for (const char *p = arg; *p;)
+    {
+        char *end = nullptr;
+        values.push_back(std::strtoull(p, &end, 10));
+        p = *end ? end + 1 : end;
+    }
+    return values;
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig config;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--mix")
+        {
+            std::sscanf(value, "%u/%u/%u", &config.cancel_pct, &config.add_pct, &config.amend_pct);
+        }
+        else if (flag == "--ops")
+            config.ops = std::strtoull(value, nullptr, 10);
+        else if (flag == "--warmup")
+            config.warmup = std::strtoull(value, nullptr, 10);
+        else if (flag == "--depths")
+            config.depths = parse_list(value);
+        else if (flag == "--cluster")
+            config.cluster_ticks = std::strtod(value, nullptr);
+        else if (flag == "--aggressive")
+            config.aggressive_pct = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        else if (flag == "--orders-per-level")
+            config.orders_per_level = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        else if (flag == "--backend")
+            config.backend = value;
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::printf("mix cancel/add/amend = %u/%u/%u, %lu ops after %lu warm-up, cluster %.1f ticks, %u%% aggressive\n",
+                config.cancel_pct, config.add_pct, config.amend_pct, static_cast<unsigned long>(config.ops),
+                static_cast<unsigned long>(config.warmup), config.cluster_ticks, config.aggressive_pct);
+
+    for (size_t depth : config.depths)
+    {
+        if (config.backend == "all" || config.backend == "map")
+        {
+            run_scenario<OrderBook>(config, "map", depth, {});
+        }
+        if (config.backend == "all" || config.backend == "tick")
+        {
+            TickLadderConfig ladder{Price::from_raw(Price::scale / 100), depth * 4,
+                                    Price::from_raw(1000000 * (Price::scale / 100))};
+            run_scenario<TickOrderBook>(config, "tick", depth, ladder);
+        }
+    }
+    return 0;
+}
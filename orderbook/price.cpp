@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <compare>
+#include <limits>
+
+#include "lookup_tables.cpp"
+
+// Number of price units per 1.0, fixed at compile time. Override with
+// -DORDERBOOK_PRICE_SCALE=... for instruments that need more decimals.
+#ifndef ORDERBOOK_PRICE_SCALE
+#define ORDERBOOK_PRICE_SCALE 10000
+#endif
+
+// Fixed-point price stored as a signed count of 1/Scale units. Comparisons
+// and arithmetic are plain integer operations, so equal prices always
+// compare (and hash) equal. Convert from/to double only at the edges:
+// feed decoding and display.
+template <int64_t Scale>
+struct FixedPrice
+{
+    static_assert(Scale > 0, "price scale must be positive");
+    static constexpr int64_t scale = Scale;
+    static constexpr int decimals = decimal_places(Scale); // -1 unless Scale is a power of ten
+
+    int64_t raw = 0;
+
+    static constexpr FixedPrice from_raw(int64_t raw) { return FixedPrice{raw}; }
+
+    static FixedPrice from_double(double value)
+    {
+        return FixedPrice{std::llround(value * static_cast<double>(Scale))};
+    }
+
+    constexpr double to_double() const { return static_cast<double>(raw) / static_cast<double>(Scale); }
+
+    static constexpr FixedPrice min() { return FixedPrice{std::numeric_limits<int64_t>::min()}; }
+    static constexpr FixedPrice max() { return FixedPrice{std::numeric_limits<int64_t>::max()}; }
+
+    // The same price in another scale, e.g. a feed quoting 1e-8 units
+    // into the book's 1e-4. Both scales are compile-time constants, so this
+    // is one multiply, or a division the compiler turns into a multiply;
+    // converting to a coarser scale truncates towards zero.
+    template <int64_t OtherScale>
+    constexpr FixedPrice<OtherScale> rescale() const
+    {
+        if constexpr (OtherScale % Scale == 0)
+        {
+            return FixedPrice<OtherScale>::from_raw(raw * (OtherScale / Scale));
+        }
+        else if constexpr (Scale % OtherScale == 0)
+        {
+            return FixedPrice<OtherScale>::from_raw(raw / (Scale / OtherScale));
+        }
+        else
+        {
+            return FixedPrice<OtherScale>::from_raw(static_cast<int64_t>(
+                static_cast<__int128>(raw) * OtherScale / Scale));
+        }
+    }
+
+    friend constexpr auto operator<=>(FixedPrice, FixedPrice) = default;
+
+    friend constexpr FixedPrice operator+(FixedPrice a, FixedPrice b) { return FixedPrice{a.raw + b.raw}; }
+    friend constexpr FixedPrice operator-(FixedPrice a, FixedPrice b) { return FixedPrice{a.raw - b.raw}; }
+};
+
+using Price = FixedPrice<ORDERBOOK_PRICE_SCALE>;
+
+static_assert(FixedPrice<100000000>::from_raw(12345678).rescale<10000>().raw == 1234 &&
+              FixedPrice<100>::from_raw(-7).rescale<10000>().raw == -700 &&
+              FixedPrice<250>::from_raw(250).rescale<10000>().raw == 10000);
+
+// Literal for readable prices in tests and examples: 100.25_px
+constexpr Price operator""_px(long double value)
+{
+    long double scaled = value * static_cast<long double>(Price::scale);
+    return Price::from_raw(static_cast<int64_t>(scaled + (scaled < 0 ? -0.5L : 0.5L)));
+}
+
+constexpr Price operator""_px(unsigned long long value)
+{
+    return Price::from_raw(static_cast<int64_t>(value) * Price::scale);
+}
@@ -0,0 +1,415 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "orderbook.cpp"
+
+// Binary capture of order events, packed like MarketData in
+// L1/mocks/MarketFeed.cpp: a fixed header followed by back-to-back
+// fixed-size records with no padding.
+#pragma pack(push, 1)
+struct CaptureHeader
+{
+    char magic[8];        // "OBCAPTR\0"
+    uint32_t version;     // capture_version
+    uint32_t record_size; // sizeof(CaptureEvent)
+    uint64_t count;       // Number of records that follow
+};
+
+struct CaptureEvent
+{
+    uint64_t timestamp_ns; // Exchange time of the event
+    uint64_t order_id;
+    int64_t price;         // Raw Price units
+    uint32_t quantity;
+    uint8_t type;          // OpType
+    uint8_t is_buy;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CaptureHeader) == 24, "capture header must stay packed");
+static_assert(sizeof(CaptureEvent) == 30, "capture record must stay packed");
+
+inline constexpr uint32_t capture_version = 1;
+inline constexpr char capture_magic[8] = {'O', 'B', 'C', 'A', 'P', 'T', 'R', '\0'};
+
+// Read-only memory mapping of a capture file. Records are decoded in
+// place: events() points straight into the page cache.
+class MappedCapture
+{
+private:
+    void *base = MAP_FAILED;
+    size_t length = 0;
+    const CaptureEvent *records = nullptr;
+    uint64_t record_count = 0;
+
+public:
+    MappedCapture() = default;
+    MappedCapture(const MappedCapture &) = delete;
+    MappedCapture &operator=(const MappedCapture &) = delete;
+
+    ~MappedCapture()
+    {
+        if (base != MAP_FAILED)
+        {
+            munmap(base, length);
+        }
+    }
+
+    // Map path and validate its header; prints the reason and returns false
+    // on failure
+    bool open(const char *path)
+    {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            std::perror(path);
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CaptureHeader))
+        {
+            std::fprintf(stderr, "%s: not a capture file\n", path);
+            ::close(fd);
+            return false;
+        }
+
+        length = static_cast<size_t>(st.st_size);
+        base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            std::perror("mmap");
+            return false;
+        }
+        madvise(base, length, MADV_SEQUENTIAL);
+
+        const auto *header = static_cast<const CaptureHeader *>(base);
+        if (std::memcmp(header->magic, capture_magic, sizeof(capture_magic)) != 0 ||
+            header->version != capture_version || header->record_size != sizeof(CaptureEvent) ||
+            header->count > (length - sizeof(CaptureHeader)) / sizeof(CaptureEvent)) // Product could wrap
+        {
+            std::fprintf(stderr, "%s: bad capture header\n", path);
+            return false;
+        }
+
+        records = reinterpret_cast<const CaptureEvent *>(static_cast<const char *>(base) + sizeof(CaptureHeader));
+        record_count = header->count;
+        return true;
+    }
+
+    const CaptureEvent *events() const { return records; }
+    uint64_t size() const { return record_count; }
+};
+
+// Buffered writer used to produce captures (e.g. from a live session or
+// the synthetic generator below)
+class CaptureWriter
+{
+private:
+    FILE *file = nullptr;
+    uint64_t count = 0;
+
+public:
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+    explicit CaptureWriter(const char *path) : file(std::fopen(path, "wb"))
+    {
+        if (file)
+        {
+            CaptureHeader header{};
+            write_header(header);
+        }
+    }
+
+    ~CaptureWriter() { close(); }
+
+    bool ok() const { return file != nullptr; }
+
+    void write(const CaptureEvent &event)
+    {
+        std::fwrite(&event, sizeof(event), 1, file);
+        ++count;
+    }
+
+    // Patch the record count into the header and close the file
+    void close()
+    {
+        if (!file)
+        {
+            return;
+        }
+        CaptureHeader header{};
+        std::fseek(file, 0, SEEK_SET);
+        write_header(header);
+        std::fclose(file);
+        file = nullptr;
+    }
+
+private:
+    void write_header(CaptureHeader &header)
+    {
+        std::memcpy(header.magic, capture_magic, sizeof(capture_magic));
+        header.version = capture_version;
+        header.record_size = sizeof(CaptureEvent);
+        header.count = count;
+        std::fwrite(&header, sizeof(header), 1, file);
+    }
+};
+
+enum class ReplayMode
+{
+    AsFastAsPossible,
+    OriginalTimestamps,
+    Scaled, // Original inter-event gaps divided by the speed factor
+};
+
+struct ReplayResult
+{
+    uint64_t events = 0;
+    uint64_t applied = 0; // Operations the book accepted
+    double elapsed_s = 0.0;
+
+    double messages_per_second() const { return elapsed_s > 0 ? static_cast<double>(events) / elapsed_s : 0.0; }
+};
+
+// Streams a mapped capture into a book. Due events are decoded straight
+// from the mapping into a small BookOp buffer and applied with
+// process_batch; paced modes busy-wait on the wall clock between packets.
+template <typename Book>
+class ReplayEngine
+{
+private:
+    static constexpr size_t packet_size = 32;
+
+    Book &book;
+
+public:
+    explicit ReplayEngine(Book &target) : book(target) {}
+
+    ReplayResult run(const MappedCapture &capture, ReplayMode mode, double speed = 1.0)
+    {
+        ReplayResult result;
+        const CaptureEvent *events = capture.events();
+        const uint64_t count = capture.size();
+        if (count == 0)
+        {
+            return result;
+        }
+
+        if (mode == ReplayMode::OriginalTimestamps)
+        {
+            speed = 1.0;
+        }
+        const uint64_t first_ts = events[0].timestamp_ns;
+        BookOp ops[packet_size];
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t next = 0;
+        while (next < count)
+        {
+            uint64_t end = std::min<uint64_t>(next + packet_size, count);
+            if (mode != ReplayMode::AsFastAsPossible)
+            {
+                // Wait for the first event, then take whatever else is due
+                wait_until(start, static_cast<double>(events[next].timestamp_ns - first_ts) / speed);
+                double now_ns = elapsed_ns(start);
+                uint64_t due = next + 1;
+                while (due < end && static_cast<double>(events[due].timestamp_ns - first_ts) / speed <= now_ns)
+                {
+                    ++due;
+                }
+                end = due;
+            }
+
+            size_t n = 0;
+            for (uint64_t i = next; i < end; ++i)
+            {
+                ops[n++] = decode(events[i]);
+            }
+            result.applied += book.process_batch(std::span<const BookOp>(ops, n));
+            next = end;
+        }
+
+        result.events = count;
+        result.elapsed_s = elapsed_ns(start) * 1e-9;
+        return result;
+    }
+
+    static BookOp decode(const CaptureEvent &event)
+    {
+        Order order{event.order_id, event.is_buy != 0, Price::from_raw(event.price), event.quantity,
+                    event.timestamp_ns};
+        return {static_cast<OpType>(event.type), order};
+    }
+
+private:
+    static double elapsed_ns(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    static void wait_until(std::chrono::steady_clock::time_point start, double offset_ns)
+    {
+        while (elapsed_ns(start) < offset_ns)
+        {
+        }
+    }
+};
+
+// Write a synthetic session: adds around a drifting mid with cancels and
+// amends of live orders, events spaced ~1us apart
+inline bool write_synthetic_capture(const char *path, uint64_t count)
+{
+    CaptureWriter writer(path);
+    if (!writer.ok())
+    {
+        std::perror(path);
+        return false;
+    }
+
+    uint64_t seed = 0x5EED;
+    auto next = [&seed]()
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+
+    const int64_t tick = Price::scale / 100;
+    struct Live
+    {
+        uint64_t id;
+        int64_t price;
+    };
+    std::vector<Live> live;
+    live.reserve(count);
+    uint64_t ts = 34200000000000ULL; // 09:30 in ns since midnight
+    uint64_t next_id = 1;
+    int64_t mid = 100 * Price::scale;
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        ts += 500 + next() % 1000;
+        if (next() % 1000 == 0)
+        {
+            mid += (next() % 2 ? tick : -tick);
+        }
+
+        uint64_t action = next() % 10;
+        CaptureEvent event{};
+        event.timestamp_ns = ts;
+        if (action < 4 || live.size() < 100)
+        {
+            bool is_buy = next() % 2 == 0;
+            int64_t distance = static_cast<int64_t>(next() % 20);
+            event.order_id = next_id++;
+            event.is_buy = is_buy;
+            event.price = is_buy ? mid - tick * (1 + distance) : mid + tick * (1 + distance);
+            event.quantity = static_cast<uint32_t>(1 + next() % 100);
+            event.type = static_cast<uint8_t>(OpType::Add);
+            live.push_back({event.order_id, event.price});
+        }
+        else
+        {
+            size_t victim = next() % live.size();
+            event.order_id = live[victim].id;
+            event.price = live[victim].price;
+            if (action < 9)
+            {
+                event.type = static_cast<uint8_t>(OpType::Cancel);
+                live[victim] = live.back();
+                live.pop_back();
+            }
+            else
+            {
+                // Quantity-only amend at the order's current price
+                event.type = static_cast<uint8_t>(OpType::Amend);
+                event.quantity = static_cast<uint32_t>(1 + next() % 100);
+            }
+        }
+        writer.write(event);
+    }
+    return true;
+}
+
+#ifdef REPLAY_MAIN
+// replay generate <file> <events>
+// replay play <file> [fast|realtime|speed <N>] [map|tick]
+int main(int argc, char **argv)
+{
+    if (argc >= 4 && std::strcmp(argv[1], "generate") == 0)
+    {
+        return write_synthetic_capture(argv[2], std::strtoull(argv[3], nullptr, 10)) ? 0 : 1;
+    }
+
+    if (argc < 3 || std::strcmp(argv[1], "play") != 0)
+    {
+        std::fprintf(stderr, "usage: %s generate <file> <events>\n"
+                             "       %s play <file> [fast|realtime|speed <N>] [map|tick]\n",
+                     argv[0], argv[0]);
+        return 1;
+    }
+
+    MappedCapture capture;
+    if (!capture.open(argv[2]))
+    {
+        return 1;
+    }
+
+    ReplayMode mode = ReplayMode::AsFastAsPossible;
+    double speed = 1.0;
+    int arg = 3;
+    if (arg < argc && std::strcmp(argv[arg], "realtime") == 0)
+    {
+        mode = ReplayMode::OriginalTimestamps;
+        ++arg;
+    }
+    else if (arg + 1 < argc && std::strcmp(argv[arg], "speed") == 0)
+    {
+        mode = ReplayMode::Scaled;
+        speed = std::strtod(argv[arg + 1], nullptr);
+        if (!(speed > 0)) // Also catches NaN
+        {
+            std::fprintf(stderr, "speed must be positive, not %s\n", argv[arg + 1]);
+            return 1;
+        }
+        arg += 2;
+    }
+    else if (arg < argc && std::strcmp(argv[arg], "fast") == 0)
+    {
+        ++arg;
+    }
+    bool tick = arg < argc && std::strcmp(argv[arg], "tick") == 0;
+
+    ReplayResult result;
+    if (tick)
+    {
+        TickOrderBook book(TickLadderConfig{Price::from_raw(Price::scale / 100), 4096, 100_px});
+        book.reserve(capture.size());
+        result = ReplayEngine<TickOrderBook>(book).run(capture, mode, speed);
+        book.print_book(5);
+    }
+    else
+    {
+        OrderBook book;
+        book.reserve(capture.size());
+        result = ReplayEngine<OrderBook>(book).run(capture, mode, speed);
+        book.print_book(5);
+    }
+
+    std::printf("Replayed %lu events (%lu applied) in %.3f s: %.0f msg/s\n",
+                static_cast<unsigned long>(result.events), static_cast<unsigned long>(result.applied),
+                result.elapsed_s, result.messages_per_second());
+    return 0;
+}
+#endif
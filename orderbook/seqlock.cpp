@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
+
+#include "threading.cpp"
+#include "../SPSC_QUEUES/spsc_q3.cpp"
+
+// Single-writer sequence lock for publishing a small trivially copyable
+// value to any number of reader threads. The writer never waits: it bumps
+// the sequence to odd, copies the value in, and bumps it back to even.
+// A reader copies the value out and keeps it only if it saw the same even
+// sequence before and after, so try_load is wait-free and load retries
+// only while a store overlaps it.
+//
+// The payload lives in relaxed atomic words rather than a plain T so that
+// the racing copy is well defined. The slot is aligned and padded to whole
+// cache lines, as Fifo3 pads its cursors, so neighbouring slots never
+// false-share.
+template <typename T>
+class alignas(cache_line_size) Seqlock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "seqlock payload is copied bytewise");
+
+private:
+    static constexpr size_t words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint64_t> data_[words] = {};
+
+public:
+    Seqlock() = default;
+    Seqlock(const Seqlock &) = delete;
+    Seqlock &operator=(const Seqlock &) = delete;
+
+    // Writer thread only
+    void store(const T &value)
+    {
+        uint64_t buffer[words] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < words; ++i)
+        {
+            data_[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    // One attempt; false (leaving out untouched) if a store was in flight
+    bool try_load(T &out) const
+    {
+        uint64_t version;
+        return try_load(out, version);
+    }
+
+    // As above, also giving the number of stores the copy reflects
+    bool try_load(T &out, uint64_t &version) const
+    {
+        uint64_t buffer[words];
+        uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < words; ++i)
+        {
+            buffer[i] = data_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before)
+        {
+            return false;
+        }
+        std::memcpy(&out, buffer, sizeof(T));
+        version = before / 2;
+        return true;
+    }
+
+    T load() const
+    {
+        T value;
+        while (!try_load(value))
+        {
+            cpu_relax();
+        }
+        return value;
+    }
+
+    // Number of completed stores
+    uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+};
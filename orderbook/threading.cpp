@@ -0,0 +1,33 @@
+#pragma once
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Spin-wait hint: lets the sibling hyperthread run and avoids the memory
+// order violation penalty when the awaited store lands
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Pin the calling thread to one core; a negative core leaves it unpinned.
+// Returns false if the kernel refused (e.g. the core is offline).
+inline bool pin_current_thread(int core)
+{
+    if (core < 0)
+    {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
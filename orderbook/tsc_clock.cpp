@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+// Cheap cycle-counter clock for latency measurement. On x86 this reads the
+// invariant TSC (no syscall, ~20 cycles); elsewhere it falls back to
+// steady_clock so ticks are already nanoseconds.
+//
+// Ticks are only meaningful as differences, or after the conversions
+// below, which map them onto CLOCK_MONOTONIC and CLOCK_REALTIME
+// nanoseconds. Those let TSC stamps be compared with timestamps that other
+// processes or the kernel took (market_data_server send times,
+// SO_TIMESTAMPING receive times).
+struct TscClock
+{
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // Whether the TSC ticks at a constant rate across P-states and C-states
+    // (CPUID 0x80000007 EDX bit 8). Without it, ticks don't convert to time
+    // at a fixed ratio and all the conversions below drift.
+    static bool invariant()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned eax, ebx, ecx, edx;
+        return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8));
+#else
+        return true;
+#endif
+    }
+
+    // Nanoseconds per tick, calibrated once against steady_clock over ~10 ms
+    static double ns_per_tick() { return calibration().ns_per_tick; }
+
+    static double to_ns(uint64_t ticks) { return static_cast<double>(ticks) * ns_per_tick(); }
+
+    // Ticks mapped to CLOCK_MONOTONIC nanoseconds, and back. The ratio
+    // comes from a 10 ms calibration, so the mapping drifts by well under a
+    // microsecond per second of uptime; fine for stage gaps, not for
+    // comparing stamps hours apart.
+    static uint64_t to_monotonic_ns(uint64_t ticks)
+    {
+        const Calibration &c = calibration();
+        return c.monotonic_ns + static_cast<uint64_t>(static_cast<double>(static_cast<int64_t>(ticks - c.ticks)) *
+                                                      c.ns_per_tick);
+    }
+
+    static uint64_t from_monotonic_ns(uint64_t ns)
+    {
+        const Calibration &c = calibration();
+        return c.ticks + static_cast<uint64_t>(static_cast<double>(static_cast<int64_t>(ns - c.monotonic_ns)) /
+                                               c.ns_per_tick);
+    }
+
+    // CLOCK_REALTIME is what software receive timestamps and PTP-disciplined
+    // NIC clocks report. The offset is sampled once, so an NTP step after
+    // calibration shows up as a constant error.
+    static uint64_t from_realtime_ns(uint64_t ns) { return from_monotonic_ns(ns - calibration().realtime_offset_ns); }
+
+    // Monotonic nanoseconds now, from the TSC
+    static uint64_t now_ns() { return to_monotonic_ns(now()); }
+
+private:
+    struct Calibration
+    {
+        double ns_per_tick;
+        uint64_t ticks;              // TSC at the end of calibration...
+        uint64_t monotonic_ns;       // ...and CLOCK_MONOTONIC at the same instant
+        uint64_t realtime_offset_ns; // CLOCK_REALTIME - CLOCK_MONOTONIC
+    };
+
+    static const Calibration &calibration()
+    {
+        static const Calibration calibrated = calibrate();
+        return calibrated;
+    }
+
+    static uint64_t read(clockid_t clock)
+    {
+        timespec ts;
+        ::clock_gettime(clock, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    static Calibration calibrate()
+    {
+        Calibration c{};
+#if defined(__x86_64__) || defined(__i386__)
+        uint64_t wall_start = read(CLOCK_MONOTONIC);
+        uint64_t tsc_start = now();
+        uint64_t wall_end = wall_start;
+        while (wall_end - wall_start < 10000000)
+        {
+            wall_end = read(CLOCK_MONOTONIC);
+        }
+        uint64_t tsc_end = now();
+        c.ns_per_tick = static_cast<double>(wall_end - wall_start) / static_cast<double>(tsc_end - tsc_start);
+        c.ticks = tsc_end;
+        c.monotonic_ns = wall_end;
+#else
+        c.ns_per_tick = 1.0;
+        c.ticks = now();
+        c.monotonic_ns = read(CLOCK_MONOTONIC);
+#endif
+        // Bracket the realtime read so the offset is good to a few ns
+        uint64_t before = read(CLOCK_MONOTONIC);
+        uint64_t realtime = read(CLOCK_REALTIME);
+        uint64_t after = read(CLOCK_MONOTONIC);
+        c.realtime_offset_ns = realtime - (before + (after - before) / 2);
+        return c;
+    }
+};